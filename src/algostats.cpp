@@ -0,0 +1,125 @@
+// Copyright (c) 2018-2020 The Verge Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algostats.h>
+
+#include <chain.h>
+#include <pow.h>
+
+#include <algorithm>
+
+CAlgoStats g_algo_stats;
+
+CAlgoStats::CAlgoStats() : m_tip(nullptr)
+{
+    Clear();
+}
+
+std::shared_ptr<const CAlgoStats::Window> CAlgoStats::BuildWindow(const CBlockIndex* pindexTip, int algo)
+{
+    std::vector<const CBlockIndex*> vBlocks;
+    for (const CBlockIndex* pindex = pindexTip ? pindexTip->GetLastOfAlgo(algo) : nullptr;
+         pindex && vBlocks.size() < (size_t)ALGO_STATS_WINDOW + 1; pindex = pindex->pprevSameAlgo) {
+        vBlocks.push_back(pindex);
+    }
+
+    std::shared_ptr<Window> window = std::make_shared<Window>();
+    window->reserve(vBlocks.size());
+    arith_uint256 nCumWork;
+    for (auto it = vBlocks.rbegin(); it != vBlocks.rend(); ++it) {
+        const arith_uint256 nWork = GetBlockProof(**it);
+        nCumWork += nWork;
+        window->push_back(Entry{(*it)->nHeight, (*it)->GetBlockTime(), nWork, nCumWork});
+    }
+    return window;
+}
+
+void CAlgoStats::UpdateTip(const CBlockIndex* pindexNew)
+{
+    if (pindexNew == nullptr) {
+        Clear();
+        return;
+    }
+
+    std::shared_ptr<const Snapshot> snapshot = std::atomic_load(&m_snapshot);
+    std::shared_ptr<Snapshot> next = std::make_shared<Snapshot>(*snapshot);
+    next->nTipHeight = pindexNew->nHeight;
+
+    if (m_tip != nullptr && pindexNew->pprev == m_tip) {
+        // Connected a block: only its algorithm's window moves by one
+        const int algo = pindexNew->GetAlgo();
+        const Window& prev = *snapshot->windows[algo];
+        const size_t nSkip = prev.size() > (size_t)ALGO_STATS_WINDOW ? prev.size() - ALGO_STATS_WINDOW : 0;
+        std::shared_ptr<Window> window = std::make_shared<Window>(prev.begin() + nSkip, prev.end());
+        const arith_uint256 nWork = GetBlockProof(*pindexNew);
+        const arith_uint256 nCumWork = (window->empty() ? arith_uint256() : window->back().nCumWork) + nWork;
+        window->push_back(Entry{pindexNew->nHeight, pindexNew->GetBlockTime(), nWork, nCumWork});
+        next->windows[algo] = window;
+    } else if (m_tip != nullptr && m_tip->pprev == pindexNew) {
+        // Disconnected a block: refill its algorithm's window from the index
+        const int algo = m_tip->GetAlgo();
+        next->windows[algo] = BuildWindow(pindexNew, algo);
+    } else {
+        for (int algo = 0; algo < NUM_ALGOS; algo++)
+            next->windows[algo] = BuildWindow(pindexNew, algo);
+    }
+
+    m_tip = pindexNew;
+    std::atomic_store(&m_snapshot, std::shared_ptr<const Snapshot>(std::move(next)));
+}
+
+void CAlgoStats::Clear()
+{
+    std::shared_ptr<Snapshot> empty = std::make_shared<Snapshot>();
+    empty->nTipHeight = -1;
+    for (int algo = 0; algo < NUM_ALGOS; algo++)
+        empty->windows[algo] = std::make_shared<Window>();
+    m_tip = nullptr;
+    std::atomic_store(&m_snapshot, std::shared_ptr<const Snapshot>(std::move(empty)));
+}
+
+bool CAlgoStats::GetNetworkHashPS(int algo, int lookup, int height, double& dHashPS) const
+{
+    if (algo < 0 || algo >= NUM_ALGOS)
+        return false;
+
+    std::shared_ptr<const Snapshot> snapshot = std::atomic_load(&m_snapshot);
+    if (snapshot->nTipHeight < 0)
+        return false;
+    // Estimates as of an earlier height need blocks the window no longer has
+    if (height >= 0 && height < snapshot->nTipHeight)
+        return false;
+
+    // If lookup is -1, then use blocks since last difficulty change.
+    if (lookup <= 0)
+        lookup = 2;
+    if (lookup > ALGO_STATS_WINDOW)
+        return false;
+
+    const Window& window = *snapshot->windows[algo];
+    if (window.empty() || window.back().nHeight == 0) {
+        dHashPS = 0;
+        return true;
+    }
+
+    // The last block of the algorithm and up to lookup blocks before it
+    const size_t nFirst = window.size() > (size_t)lookup + 1 ? window.size() - lookup - 1 : 0;
+    arith_uint256 workTotal = window.back().nCumWork - window[nFirst].nCumWork + window[nFirst].nWork;
+    int64_t minTime = window.back().nTime;
+    int64_t maxTime = minTime;
+    for (size_t i = nFirst; i < window.size(); i++) {
+        minTime = std::min(window[i].nTime, minTime);
+        maxTime = std::max(window[i].nTime, maxTime);
+    }
+
+    // In case there's a situation where minTime == maxTime, we don't want a divide by zero exception.
+    if (minTime == maxTime) {
+        dHashPS = 0;
+        return true;
+    }
+
+    workTotal /= GetAlgoWeight(algo); // reverse algo weighting
+    dHashPS = workTotal.getdouble() / (maxTime - minTime);
+    return true;
+}
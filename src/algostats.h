@@ -0,0 +1,80 @@
+// Copyright (c) 2018-2020 The Verge Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef VERGE_ALGOSTATS_H
+#define VERGE_ALGOSTATS_H
+
+#include <arith_uint256.h>
+#include <primitives/block.h>
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+class CBlockIndex;
+
+//! Largest number of blocks per algorithm a CAlgoStats lookup can cover
+static const int ALGO_STATS_WINDOW = 360;
+
+/**
+ * Rolling per-algorithm statistics of the active chain, used to answer the
+ * network hashrate RPCs without taking cs_main.
+ *
+ * The validation code moves it along with the chain tip. Every update
+ * publishes a new immutable snapshot; only the window of the algorithm of the
+ * connected or disconnected block is rebuilt, the others are shared with the
+ * previous snapshot. Readers take a reference to the current snapshot and
+ * never wait for block validation.
+ */
+class CAlgoStats
+{
+public:
+    struct Entry
+    {
+        int nHeight;
+        int64_t nTime;
+        arith_uint256 nWork;    //!< GetBlockProof() of this block
+        arith_uint256 nCumWork; //!< running total of nWork, including this block
+    };
+
+    /** The last ALGO_STATS_WINDOW + 1 blocks of one algorithm on the active chain, oldest first. */
+    typedef std::vector<Entry> Window;
+
+    struct Snapshot
+    {
+        int nTipHeight;
+        std::shared_ptr<const Window> windows[NUM_ALGOS];
+    };
+
+private:
+    //! Read and replaced with std::atomic_load/std::atomic_store only
+    std::shared_ptr<const Snapshot> m_snapshot;
+
+    //! Tip of the last update. Only used by the writer, which holds cs_main.
+    const CBlockIndex* m_tip;
+
+    static std::shared_ptr<const Window> BuildWindow(const CBlockIndex* pindexTip, int algo);
+
+public:
+    CAlgoStats();
+
+    /** Move to a new chain tip. Must be called with cs_main held. */
+    void UpdateTip(const CBlockIndex* pindexNew);
+
+    /** Forget everything, e.g. when the block index is unloaded. */
+    void Clear();
+
+    /**
+     * Average hashes per second of algo over its last lookup blocks, or as of
+     * height, with the semantics of the getnetworkhashps RPC. Returns false if
+     * the query reaches beyond the window, in which case the caller has to walk
+     * the block index itself.
+     */
+    bool GetNetworkHashPS(int algo, int lookup, int height, double& dHashPS) const;
+};
+
+/** Statistics of the active chain */
+extern CAlgoStats g_algo_stats;
+
+#endif // VERGE_ALGOSTATS_H
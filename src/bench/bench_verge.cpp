@@ -5,6 +5,9 @@
 
 #include <bench/bench.h>
 
+#include <crypto/pow/Lyra2.h>
+#include <crypto/pow/hashx17.h>
+#include <crypto/pow/scrypt.h>
 #include <crypto/sha256.h>
 #include <key.h>
 #include <random.h>
@@ -55,6 +58,9 @@ int main(int argc, char** argv)
     }
 
     SHA256AutoDetect();
+    scrypt_detect_multi();
+    LYRA2_detect();
+    x17_detect();
     RandomInit();
     ECC_Start();
     SetupEnvironment();
@@ -9,6 +9,7 @@
 #include <validation.h>
 #include <streams.h>
 #include <consensus/validation.h>
+#include <primitives/headerhashcache.h>
 
 namespace block_bench {
 #include <bench/data/block413567.raw.h>
@@ -53,5 +54,75 @@ static void DeserializeAndCheckBlockTest(benchmark::State& state)
     }
 }
 
+// A full headers message as sent in reply to getheaders: MAX_HEADERS_RESULTS
+// CBlocks without transactions, built from the benchmark block's header.
+static CDataStream HeadersMessage()
+{
+    CDataStream stream((const char*)block_bench::block413567,
+            (const char*)&block_bench::block413567[sizeof(block_bench::block413567)],
+            SER_NETWORK, PROTOCOL_VERSION);
+    CBlock block;
+    stream >> block;
+
+    std::vector<CBlock> vHeaders(MAX_HEADERS_RESULTS, CBlock(block.GetBlockHeader()));
+    for (unsigned int i = 0; i < vHeaders.size(); i++)
+        vHeaders[i].nNonce += i;
+
+    CDataStream msg(SER_NETWORK, PROTOCOL_VERSION);
+    msg << vHeaders;
+    char a = '\0';
+    msg.write(&a, 1); // Prevent compaction
+    return msg;
+}
+
+static void ReadHeadersMessage(CDataStream& msg, std::vector<CBlockHeader>& headers)
+{
+    std::vector<CBlock> blocks;
+    msg.SetType(SER_NETWORK | SER_BLOCKHEADERONLY);
+    blocks.resize(ReadCompactSize(msg));
+    for (CBlock& block : blocks) {
+        msg >> block;
+        ReadCompactSize(msg);
+    }
+    headers.assign(blocks.begin(), blocks.end());
+}
+
+// Deserializing a headers message no longer hashes anything.
+static void DeserializeHeadersTest(benchmark::State& state)
+{
+    CDataStream msg = HeadersMessage();
+    const size_t nSize = msg.size() - 1;
+
+    while (state.KeepRunning()) {
+        std::vector<CBlockHeader> headers;
+        ReadHeadersMessage(msg, headers);
+        assert(msg.Rewind(nSize));
+    }
+}
+
+// Re-checking a headers message whose headers we already know (the cache is
+// warm, as it is for anything in the block index) must not touch scrypt.
+static void DeserializeAndHashKnownHeadersTest(benchmark::State& state)
+{
+    CDataStream msg = HeadersMessage();
+    const size_t nSize = msg.size() - 1;
+
+    std::vector<CBlockHeader> headers;
+    ReadHeadersMessage(msg, headers);
+    assert(msg.Rewind(nSize));
+    assert(HeaderHashCache().MaxEntries() >= headers.size());
+    for (const CBlockHeader& header : headers)
+        header.GetHash();
+
+    while (state.KeepRunning()) {
+        ReadHeadersMessage(msg, headers);
+        assert(msg.Rewind(nSize));
+        for (const CBlockHeader& header : headers)
+            header.GetHash();
+    }
+}
+
 BENCHMARK(DeserializeBlockTest, 130);
 BENCHMARK(DeserializeAndCheckBlockTest, 160);
+BENCHMARK(DeserializeHeadersTest, 1500);
+BENCHMARK(DeserializeAndHashKnownHeadersTest, 450);
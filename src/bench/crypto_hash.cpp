@@ -16,6 +16,8 @@
 #include <crypto/sha256.h>
 #include <crypto/sha512.h>
 #include <crypto/siphash.h>
+#include <crypto/pow/Lyra2RE.h>
+#include <crypto/pow/scrypt.h>
 
 /* Number of bytes to hash per iteration */
 static const uint64_t BUFFER_SIZE = 1000*1000;
@@ -79,6 +81,44 @@ static void SipHash_32b(benchmark::State& state)
     }
 }
 
+static void SCRYPT_1024_1_1_256(benchmark::State& state)
+{
+    std::vector<char> in(80, 0);
+    char hash[32];
+    while (state.KeepRunning()) {
+        scrypt_1024_1_1_256(in.data(), hash);
+        in[76]++;
+    }
+}
+
+static void LYRA2RE2(benchmark::State& state)
+{
+    std::vector<char> in(80, 0);
+    char hash[32];
+    while (state.KeepRunning()) {
+        lyra2re2_hash(in.data(), hash);
+        in[76]++;
+    }
+}
+
+/* One iteration hashes a batch of 8 distinct headers */
+static void SCRYPT_1024_1_1_256_MULTI_8(benchmark::State& state)
+{
+    std::vector<char> in(8 * 80, 0), out(8 * 32);
+    const char* pin[8];
+    char* pout[8];
+    for (int i = 0; i < 8; i++) {
+        in[i * 80] = i;
+        pin[i] = &in[i * 80];
+        pout[i] = &out[i * 32];
+    }
+    while (state.KeepRunning()) {
+        scrypt_1024_1_1_256_multi(pin, pout, 8);
+        for (int i = 0; i < 8; i++)
+            in[i * 80 + 76]++;
+    }
+}
+
 static void FastRandom_32bit(benchmark::State& state)
 {
     FastRandomContext rng(true);
@@ -105,5 +145,8 @@ BENCHMARK(SHA512, 330);
 BENCHMARK(SHA256_32b, 4700 * 1000);
 BENCHMARK(SipHash_32b, 40 * 1000 * 1000);
 BENCHMARK(SHA256D64_1024, 7400);
+BENCHMARK(SCRYPT_1024_1_1_256, 3500);
+BENCHMARK(SCRYPT_1024_1_1_256_MULTI_8, 1200);
+BENCHMARK(LYRA2RE2, 40 * 1000);
 BENCHMARK(FastRandom_32bit, 110 * 1000 * 1000);
 BENCHMARK(FastRandom_1bit, 440 * 1000 * 1000);
@@ -0,0 +1,84 @@
+// Copyright (c) 2018-2020 The Verge Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <flatfile.h>
+#include <fs.h>
+#include <random.h>
+
+#include <assert.h>
+#include <stdio.h>
+#include <vector>
+
+// Time to read a block-sized record at random out of a flat file sequence
+// that fits the page cache, as serving blocks, rescans and verifychain do:
+//  - FlatFileReadStdio: open, seek, read and close the file for every
+//    record, as ReadBlockFromDisk did;
+//  - FlatFileReadMapped: copy the record out of a FlatFileMapPool mapping.
+// The difference is the cost of those calls; they are not counted here.
+
+static const int BENCH_FILES = 4;
+static const int BENCH_RECORDS_PER_FILE = 64;
+static const size_t BENCH_RECORD_SIZE = 64 * 1024;
+
+/** A temporary block file sequence filled with random records */
+struct BenchFlatFiles
+{
+    fs::path dir;
+    FlatFileSeq seq;
+
+    BenchFlatFiles() :
+        dir(fs::temp_directory_path() / fs::unique_path("bench_flatfile_%%%%%%%%")),
+        seq(dir, "blk", 1 << 24)
+    {
+        std::vector<unsigned char> record(BENCH_RECORD_SIZE);
+        for (int nFile = 0; nFile < BENCH_FILES; nFile++) {
+            FILE* file = seq.Open(FlatFilePos(nFile, 0));
+            assert(file);
+            for (int i = 0; i < BENCH_RECORDS_PER_FILE; i++) {
+                GetRandBytes(record.data(), record.size());
+                assert(fwrite(record.data(), 1, record.size(), file) == record.size());
+            }
+            fclose(file);
+        }
+    }
+
+    ~BenchFlatFiles()
+    {
+        fs::remove_all(dir);
+    }
+
+    static FlatFilePos RandomRecord(FastRandomContext& rng)
+    {
+        return FlatFilePos(rng.randrange(BENCH_FILES), rng.randrange(BENCH_RECORDS_PER_FILE) * BENCH_RECORD_SIZE);
+    }
+};
+
+static void FlatFileReadStdio(benchmark::State& state)
+{
+    BenchFlatFiles files;
+    FastRandomContext rng(true);
+    std::vector<unsigned char> record(BENCH_RECORD_SIZE);
+    while (state.KeepRunning()) {
+        FILE* file = files.seq.Open(BenchFlatFiles::RandomRecord(rng), true);
+        assert(file);
+        assert(fread(record.data(), 1, record.size(), file) == record.size());
+        fclose(file);
+    }
+}
+
+static void FlatFileReadMapped(benchmark::State& state)
+{
+    BenchFlatFiles files;
+    FastRandomContext rng(true);
+    FlatFileMapPool maps(BENCH_FILES);
+    std::vector<unsigned char> record(BENCH_RECORD_SIZE);
+    while (state.KeepRunning()) {
+        assert(maps.Read(files.seq, BenchFlatFiles::RandomRecord(rng), record.data(), record.size()));
+    }
+}
+
+BENCHMARK(FlatFileReadStdio, 60 * 1000);
+BENCHMARK(FlatFileReadMapped, 150 * 1000);
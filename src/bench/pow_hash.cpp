@@ -0,0 +1,170 @@
+// Copyright (c) 2018-2020 The Verge Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <chainparams.h>
+#include <checkqueue.h>
+#include <crypto/pow/Lyra2RE.h>
+#include <crypto/pow/hashblake.h>
+#include <crypto/pow/hashgroestl.h>
+#include <crypto/pow/hashx17.h>
+#include <crypto/pow/scrypt.h>
+#include <primitives/block.h>
+#include <primitives/headerhashcache.h>
+#include <util/strencodings.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <boost/thread/thread.hpp>
+
+// Proof-of-work hashing of 80-byte block headers, for every algorithm:
+//  - POW_<algo>: one header at a time, the latency of a single header check
+//    (scrypt and lyra2re have theirs in crypto_hash.cpp, SCRYPT_1024_1_1_256
+//    and LYRA2RE2);
+//  - POW_<algo>_THREADS: a headers message worth of headers spread over a
+//    CCheckQueue with a thread per core, the throughput of header sync;
+//  - GETPOWHASH_<algo>: the same header through CBlockHeader::GetPoWHash(),
+//    which adds the algorithm dispatch;
+//  - GETPOWHASH_CACHED: the PoWHashCache() lookup that replaces hashing when
+//    validation checks a header the header sync already hashed.
+// Each iteration bumps the nonce, so no cache ever answers for the hash.
+
+static const int MIN_CORES = 2;
+static const unsigned int QUEUE_BATCH_SIZE = 128;
+
+/** The mainnet genesis header, relabelled with the version bits of algo */
+static CBlockHeader SampleHeader(int algo)
+{
+    static const int32_t versions[NUM_ALGOS] = {BLOCK_VERSION_SCRYPT, BLOCK_VERSION_X17, BLOCK_VERSION_LYRA2RE, BLOCK_VERSION_BLAKE, BLOCK_VERSION_GROESTL};
+    CBlockHeader header = CreateChainParams(CBaseChainParams::MAIN)->GenesisBlock().GetBlockHeader();
+    header.hash.SetNull();
+    header.nVersion = BLOCK_VERSION_STEALTH | versions[algo];
+    assert(header.GetAlgo() == algo);
+    return header;
+}
+
+/** The hash function behind GetPoWHash(algo), without the dispatch */
+static uint256 RawPoWHash(const CBlockHeader& header, int algo)
+{
+    uint256 hash;
+    switch (algo) {
+    case ALGO_GROESTL:
+        return HashGroestl(BEGIN(header.nVersion), END(header.nNonce));
+    case ALGO_BLAKE:
+        return HashBlake(BEGIN(header.nVersion), END(header.nNonce));
+    case ALGO_X17:
+        return HashX17(BEGIN(header.nVersion), END(header.nNonce));
+    case ALGO_LYRA2RE:
+        lyra2re2_hash(BEGIN(header.nVersion), BEGIN(hash));
+        return hash;
+    default:
+        scrypt_1024_1_1_256(BEGIN(header.nVersion), BEGIN(hash));
+        return hash;
+    }
+}
+
+static void PoWHash(benchmark::State& state, int algo)
+{
+    CBlockHeader header = SampleHeader(algo);
+    while (state.KeepRunning()) {
+        header.nNonce++;
+        RawPoWHash(header, algo);
+    }
+}
+
+static void PoWHashThreads(benchmark::State& state, int algo)
+{
+    struct PoWHashJob {
+        const CBlockHeader* header;
+        int algo;
+        PoWHashJob() : header(nullptr), algo(ALGO_SCRYPT) {}
+        PoWHashJob(const CBlockHeader* headerIn, int algoIn) : header(headerIn), algo(algoIn) {}
+        bool operator()()
+        {
+            RawPoWHash(*header, algo);
+            return true;
+        }
+        void swap(PoWHashJob& x)
+        {
+            std::swap(header, x.header);
+            std::swap(algo, x.algo);
+        }
+    };
+    CCheckQueue<PoWHashJob> queue {QUEUE_BATCH_SIZE};
+    boost::thread_group tg;
+    for (auto x = 0; x < std::max(MIN_CORES, GetNumCores()); ++x) {
+        tg.create_thread([&]{queue.Thread();});
+    }
+
+    std::vector<CBlockHeader> headers(MAX_HEADERS_RESULTS, SampleHeader(algo));
+    uint32_t nNonce = 0;
+    while (state.KeepRunning()) {
+        std::vector<PoWHashJob> vChecks;
+        vChecks.reserve(headers.size());
+        for (CBlockHeader& header : headers) {
+            header.nNonce = nNonce++;
+            vChecks.emplace_back(&header, algo);
+        }
+        CCheckQueueControl<PoWHashJob> control(&queue);
+        control.Add(vChecks);
+        control.Wait();
+    }
+    tg.interrupt_all();
+    tg.join_all();
+}
+
+static void GetPoWHash(benchmark::State& state, int algo)
+{
+    CBlockHeader header = SampleHeader(algo);
+    while (state.KeepRunning()) {
+        header.nNonce++;
+        header.GetPoWHash(algo);
+    }
+}
+
+// A header whose hash the header sync already put in the cache
+static void GetPoWHashCached(benchmark::State& state)
+{
+    CBlockHeader header = SampleHeader(ALGO_X17);
+    PoWHashCache().Insert(header.GetHeaderCacheKey(), RawPoWHash(header, ALGO_X17));
+    uint256 hash;
+    while (state.KeepRunning()) {
+        PoWHashCache().Lookup(header.GetHeaderCacheKey(), hash);
+    }
+}
+
+static void POW_GROESTL(benchmark::State& state) { PoWHash(state, ALGO_GROESTL); }
+static void POW_X17(benchmark::State& state) { PoWHash(state, ALGO_X17); }
+static void POW_BLAKE(benchmark::State& state) { PoWHash(state, ALGO_BLAKE); }
+
+static void POW_SCRYPT_THREADS(benchmark::State& state) { PoWHashThreads(state, ALGO_SCRYPT); }
+static void POW_GROESTL_THREADS(benchmark::State& state) { PoWHashThreads(state, ALGO_GROESTL); }
+static void POW_X17_THREADS(benchmark::State& state) { PoWHashThreads(state, ALGO_X17); }
+static void POW_BLAKE_THREADS(benchmark::State& state) { PoWHashThreads(state, ALGO_BLAKE); }
+static void POW_LYRA2RE_THREADS(benchmark::State& state) { PoWHashThreads(state, ALGO_LYRA2RE); }
+
+static void GETPOWHASH_SCRYPT(benchmark::State& state) { GetPoWHash(state, ALGO_SCRYPT); }
+static void GETPOWHASH_GROESTL(benchmark::State& state) { GetPoWHash(state, ALGO_GROESTL); }
+static void GETPOWHASH_X17(benchmark::State& state) { GetPoWHash(state, ALGO_X17); }
+static void GETPOWHASH_BLAKE(benchmark::State& state) { GetPoWHash(state, ALGO_BLAKE); }
+static void GETPOWHASH_LYRA2RE(benchmark::State& state) { GetPoWHash(state, ALGO_LYRA2RE); }
+static void GETPOWHASH_CACHED(benchmark::State& state) { GetPoWHashCached(state); }
+
+BENCHMARK(POW_GROESTL, 200 * 1000);
+BENCHMARK(POW_X17, 30 * 1000);
+BENCHMARK(POW_BLAKE, 2 * 1000 * 1000);
+
+BENCHMARK(POW_SCRYPT_THREADS, 4);
+BENCHMARK(POW_GROESTL_THREADS, 200);
+BENCHMARK(POW_X17_THREADS, 30);
+BENCHMARK(POW_BLAKE_THREADS, 1000);
+BENCHMARK(POW_LYRA2RE_THREADS, 40);
+
+BENCHMARK(GETPOWHASH_SCRYPT, 3000);
+BENCHMARK(GETPOWHASH_GROESTL, 180 * 1000);
+BENCHMARK(GETPOWHASH_X17, 28 * 1000);
+BENCHMARK(GETPOWHASH_BLAKE, 1000 * 1000);
+BENCHMARK(GETPOWHASH_LYRA2RE, 38 * 1000);
+BENCHMARK(GETPOWHASH_CACHED, 2 * 1000 * 1000);
@@ -0,0 +1,118 @@
+// Copyright (c) 2018-2020 The Verge Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <ringsig.h>
+#include <uint256.h>
+
+#include <assert.h>
+#include <string.h>
+#include <vector>
+
+// Ring signature verification by ring size:
+//  - RingSigVerify_<n>: one signature over n keys, the cost a node pays per
+//    anonymous input;
+//  - RingSigABVerify_<n>: the same for the shorter RING_SIG_2 signatures;
+//  - RingSigBatchVerify: a block's worth of signatures over rings drawn
+//    from a common set of outputs, through CRingSigBatch.
+
+/** A signature over a ring of fresh keys, signed by the first member */
+struct BenchRing
+{
+    int nRingSize;
+    std::vector<uint8_t> vPubkeys;
+    ec_point keyImage;
+    uint256 txnHash;
+    std::vector<uint8_t> vSigc, vSigr;
+    data_chunk sigC;
+    std::vector<uint8_t> vSigS;
+
+    explicit BenchRing(int nRingSizeIn, const std::vector<uint8_t>* pKeys = nullptr, int nFirst = 0)
+        : nRingSize(nRingSizeIn), txnHash(uint256S("d6b5e8f2b7e3a5e0c2a0b3c6f6f9e3d8a7b1c2d3e4f5a6b7c8d9e0f1a2b3c4d5")),
+          vSigc(nRingSize * ec_secret_size), vSigr(nRingSize * ec_secret_size), vSigS(nRingSize * ec_secret_size)
+    {
+        ec_secret secret;
+        ec_point pubkey;
+        assert(GenerateRandomSecret(secret) == 0 && SecretToPublicKey(secret, pubkey) == 0);
+        vPubkeys = pubkey;
+        for (int i = 1; i < nRingSize; ++i) {
+            if (pKeys) {
+                size_t nKeys = pKeys->size() / ec_compressed_size, k = (nFirst + i) % nKeys;
+                vPubkeys.insert(vPubkeys.end(), pKeys->begin() + k * ec_compressed_size, pKeys->begin() + (k + 1) * ec_compressed_size);
+                continue;
+            }
+            ec_secret decoy;
+            assert(GenerateRandomSecret(decoy) == 0 && SecretToPublicKey(decoy, pubkey) == 0);
+            vPubkeys.insert(vPubkeys.end(), pubkey.begin(), pubkey.end());
+        }
+
+        pubkey.assign(vPubkeys.begin(), vPubkeys.begin() + ec_compressed_size);
+        assert(generateKeyImage(pubkey, secret, keyImage) == 0);
+        assert(generateRingSignature(keyImage, txnHash, nRingSize, 0, secret, vPubkeys.data(), vSigc.data(), vSigr.data()) == 0);
+        if (nRingSize < 200)
+            assert(generateRingSignatureAB(keyImage, txnHash, nRingSize, 0, secret, vPubkeys.data(), sigC, vSigS.data()) == 0);
+    }
+};
+
+static void RingSigVerify(benchmark::State& state, int nRingSize)
+{
+    BenchRing ring(nRingSize);
+    while (state.KeepRunning()) {
+        int rv = verifyRingSignature(ring.keyImage, ring.txnHash, nRingSize, ring.vPubkeys.data(), ring.vSigc.data(), ring.vSigr.data());
+        assert(rv == 0);
+    }
+}
+
+static void RingSigABVerify(benchmark::State& state, int nRingSize)
+{
+    BenchRing ring(nRingSize);
+    while (state.KeepRunning()) {
+        int rv = verifyRingSignatureAB(ring.keyImage, ring.txnHash, nRingSize, ring.vPubkeys.data(), ring.sigC, ring.vSigS.data());
+        assert(rv == 0);
+    }
+}
+
+static void RingSigBatchVerify(benchmark::State& state)
+{
+    // 20 signatures with rings of 10 out of 50 shared outputs
+    std::vector<uint8_t> vKeys;
+    for (int i = 0; i < 50; ++i) {
+        ec_secret secret;
+        ec_point pubkey;
+        assert(GenerateRandomSecret(secret) == 0 && SecretToPublicKey(secret, pubkey) == 0);
+        vKeys.insert(vKeys.end(), pubkey.begin(), pubkey.end());
+    }
+    std::vector<BenchRing> vRings;
+    CRingSigBatch batch;
+    for (int n = 0; n < 20; ++n)
+        vRings.emplace_back(10, &vKeys, n * 7);
+    for (const BenchRing& ring : vRings)
+        batch.Add(ring.keyImage, ring.txnHash, ring.nRingSize, ring.vPubkeys.data(), ring.vSigc.data(), ring.vSigr.data());
+
+    std::vector<int> vResults;
+    while (state.KeepRunning()) {
+        bool fValid = batch.Verify(vResults);
+        assert(fValid);
+    }
+}
+
+static void RingSigVerify_3(benchmark::State& state) { RingSigVerify(state, 3); }
+static void RingSigVerify_10(benchmark::State& state) { RingSigVerify(state, 10); }
+static void RingSigVerify_32(benchmark::State& state) { RingSigVerify(state, 32); }
+static void RingSigVerify_100(benchmark::State& state) { RingSigVerify(state, 100); }
+static void RingSigVerify_200(benchmark::State& state) { RingSigVerify(state, 200); }
+static void RingSigABVerify_3(benchmark::State& state) { RingSigABVerify(state, 3); }
+static void RingSigABVerify_32(benchmark::State& state) { RingSigABVerify(state, 32); }
+static void RingSigABVerify_199(benchmark::State& state) { RingSigABVerify(state, 199); }
+
+BENCHMARK(RingSigVerify_3, 1600);
+BENCHMARK(RingSigVerify_10, 500);
+BENCHMARK(RingSigVerify_32, 150);
+BENCHMARK(RingSigVerify_100, 50);
+BENCHMARK(RingSigVerify_200, 25);
+BENCHMARK(RingSigABVerify_3, 1600);
+BENCHMARK(RingSigABVerify_32, 150);
+BENCHMARK(RingSigABVerify_199, 25);
+BENCHMARK(RingSigBatchVerify, 25);
@@ -0,0 +1,66 @@
+// Copyright (c) 2018-2020 The Verge Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <crypto/sha256.h>
+#include <stealth.h>
+
+#include <assert.h>
+#include <string.h>
+
+// Stealth address key derivation:
+//  - SecretToPublicKey: the ephemeral key of every stealth output sent;
+//  - StealthSecret: the sender deriving the one-time key, and the wallet
+//    scanning each ephemeral key of a block against its scan key;
+//  - StealthSecretSpend: the wallet deriving the spend secret of a match.
+
+static ec_secret SampleSecret(const char* label)
+{
+    ec_secret secret;
+    CSHA256().Write((const unsigned char*)label, strlen(label)).Finalize(secret.e);
+    return secret;
+}
+
+static void StealthSecretToPublicKey(benchmark::State& state)
+{
+    ec_secret secret = SampleSecret("ephem");
+    ec_point pubkey;
+    while (state.KeepRunning()) {
+        int rv = SecretToPublicKey(secret, pubkey);
+        assert(rv == 0);
+        secret.e[0]++;
+    }
+}
+
+static void StealthSecretScan(benchmark::State& state)
+{
+    ec_secret scanSecret = SampleSecret("scan"), spendSecret = SampleSecret("spend"), ephemSecret = SampleSecret("ephem");
+    ec_point ephemPubkey, spendPubkey, pkOut;
+    SecretToPublicKey(spendSecret, spendPubkey);
+    SecretToPublicKey(ephemSecret, ephemPubkey);
+    ec_secret sharedS;
+    while (state.KeepRunning()) {
+        int rv = StealthSecret(scanSecret, ephemPubkey, spendPubkey, sharedS, pkOut);
+        assert(rv == 0);
+        scanSecret.e[0]++;
+    }
+}
+
+static void StealthSecretSpendKey(benchmark::State& state)
+{
+    ec_secret scanSecret = SampleSecret("scan"), spendSecret = SampleSecret("spend"), ephemSecret = SampleSecret("ephem");
+    ec_point ephemPubkey;
+    SecretToPublicKey(ephemSecret, ephemPubkey);
+    ec_secret secretOut;
+    while (state.KeepRunning()) {
+        int rv = StealthSecretSpend(scanSecret, ephemPubkey, spendSecret, secretOut);
+        assert(rv == 0);
+        scanSecret.e[0]++;
+    }
+}
+
+BENCHMARK(StealthSecretToPublicKey, 25 * 1000);
+BENCHMARK(StealthSecretScan, 8 * 1000);
+BENCHMARK(StealthSecretSpendKey, 8 * 1000);
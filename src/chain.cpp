@@ -114,10 +114,61 @@ CBlockIndex* CBlockIndex::GetAncestor(int height)
     return const_cast<CBlockIndex*>(static_cast<const CBlockIndex*>(this)->GetAncestor(height));
 }
 
+const CBlockIndex* CBlockIndex::GetLastOfAlgo(int algo) const
+{
+    // Blocks of the different algorithms are interleaved, so this is usually
+    // only a few steps.
+    const CBlockIndex* pindexWalk = this;
+    while (pindexWalk && pindexWalk->GetAlgo() != algo)
+        pindexWalk = pindexWalk->pprev;
+    return pindexWalk;
+}
+
+CBlockIndex* CBlockIndex::GetLastOfAlgo(int algo)
+{
+    return const_cast<CBlockIndex*>(static_cast<const CBlockIndex*>(this)->GetLastOfAlgo(algo));
+}
+
+const CBlockIndex* CBlockIndex::GetAncestorSameAlgo(int algoHeight) const
+{
+    if (algoHeight > nAlgoHeight || algoHeight < 0) {
+        return nullptr;
+    }
+
+    // Same walk as GetAncestor(), over the chain of blocks of this algorithm.
+    const CBlockIndex* pindexWalk = this;
+    int heightWalk = nAlgoHeight;
+    while (heightWalk > algoHeight) {
+        int heightSkip = GetSkipHeight(heightWalk);
+        int heightSkipPrev = GetSkipHeight(heightWalk - 1);
+        if (pindexWalk->pskipSameAlgo != nullptr &&
+            (heightSkip == algoHeight ||
+             (heightSkip > algoHeight && !(heightSkipPrev < heightSkip - 2 &&
+                                           heightSkipPrev >= algoHeight)))) {
+            pindexWalk = pindexWalk->pskipSameAlgo;
+            heightWalk = heightSkip;
+        } else {
+            assert(pindexWalk->pprevSameAlgo);
+            pindexWalk = pindexWalk->pprevSameAlgo;
+            heightWalk--;
+        }
+    }
+    return pindexWalk;
+}
+
+CBlockIndex* CBlockIndex::GetAncestorSameAlgo(int algoHeight)
+{
+    return const_cast<CBlockIndex*>(static_cast<const CBlockIndex*>(this)->GetAncestorSameAlgo(algoHeight));
+}
+
 void CBlockIndex::BuildSkip()
 {
     if (pprev)
         pskip = pprev->GetAncestor(GetSkipHeight(nHeight));
+
+    pprevSameAlgo = pprev ? pprev->GetLastOfAlgo(GetAlgo()) : nullptr;
+    nAlgoHeight = pprevSameAlgo ? pprevSameAlgo->nAlgoHeight + 1 : 0;
+    pskipSameAlgo = pprevSameAlgo ? pprevSameAlgo->GetAncestorSameAlgo(GetSkipHeight(nAlgoHeight)) : nullptr;
 }
 
 arith_uint256 GetBlockProof(const CBlockIndex& block)
@@ -72,6 +72,10 @@ public:
     unsigned int nHeightLast;  //!< highest height of block in file
     uint64_t nTimeFirst;       //!< earliest time of block in file
     uint64_t nTimeLast;        //!< latest time of block in file
+    uint32_t nFlags;           //!< BLOCK_FILE_* flags of the file
+
+    //! Some blocks in the file are stored LZ4 compressed
+    static const uint32_t BLOCK_FILE_COMPRESSED = 1;
 
     ADD_SERIALIZE_METHODS;
 
@@ -84,6 +88,14 @@ public:
         READWRITE(VARINT(nHeightLast));
         READWRITE(VARINT(nTimeFirst));
         READWRITE(VARINT(nTimeLast));
+        // Only written when set, so files without flags keep the old record
+        if (ser_action.ForRead()) {
+            nFlags = 0;
+            if (s.size() > 0)
+                READWRITE(VARINT(nFlags));
+        } else if (nFlags != 0) {
+            READWRITE(VARINT(nFlags));
+        }
     }
 
      void SetNull() {
@@ -94,6 +106,7 @@ public:
          nHeightLast = 0;
          nTimeFirst = 0;
          nTimeLast = 0;
+         nFlags = 0;
      }
 
      CBlockFileInfo() {
@@ -173,6 +186,15 @@ public:
     //! pointer to the index of some further predecessor of this block
     CBlockIndex* pskip;
 
+    //! (memory only) pointer to the index of the nearest predecessor mined with the same algorithm
+    CBlockIndex* pprevSameAlgo;
+
+    //! (memory only) pointer to the index of some further predecessor mined with the same algorithm
+    CBlockIndex* pskipSameAlgo;
+
+    //! (memory only) number of predecessors mined with the same algorithm
+    int nAlgoHeight;
+
     //! height of the entry in the chain. The genesis block has height 0
     int nHeight;
 
@@ -218,6 +240,9 @@ public:
         phashBlock = nullptr;
         pprev = nullptr;
         pskip = nullptr;
+        pprevSameAlgo = nullptr;
+        pskipSameAlgo = nullptr;
+        nAlgoHeight = 0;
         nHeight = 0;
         nFile = 0;
         nDataPos = 0;
@@ -280,6 +305,8 @@ public:
         block.nTime          = nTime;
         block.nBits          = nBits;
         block.nNonce         = nNonce;
+        if (phashBlock)
+            block.hash = *phashBlock;
         return block;
     }
 
@@ -374,12 +401,20 @@ public:
         return nHeight;
     }
 
-    //! Build the skiplist pointer for this entry.
+    //! Build the skiplist pointers for this entry, including the same-algorithm ones.
     void BuildSkip();
 
     //! Efficiently find an ancestor of this block.
     CBlockIndex* GetAncestor(int height);
     const CBlockIndex* GetAncestor(int height) const;
+
+    //! Find the last block mined with algo, starting at this one. Returns nullptr if there is none.
+    CBlockIndex* GetLastOfAlgo(int algo);
+    const CBlockIndex* GetLastOfAlgo(int algo) const;
+
+    //! Efficiently find the same-algorithm ancestor of this block with the given nAlgoHeight.
+    CBlockIndex* GetAncestorSameAlgo(int algoHeight);
+    const CBlockIndex* GetAncestorSameAlgo(int algoHeight) const;
 };
 
 arith_uint256 GetBlockProof(const CBlockIndex& block);
@@ -457,6 +492,9 @@ public:
 
     uint256 GetBlockHash() const
     {
+        if (!hashBlockShared.IsNull())
+            return hashBlockShared;
+
         CBlockHeader block;
         block.nVersion        = nVersion;
         block.hashPrevBlock   = hashPrev;
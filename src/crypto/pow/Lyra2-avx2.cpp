@@ -0,0 +1,283 @@
+// Copyright (c) 2018-2020 The Verge Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// LYRA2 from Lyra2.c with the 16-word Blake2b sponge state kept in four AVX2
+// registers: the column step of a round is one G on whole registers, the
+// diagonal step the same after rotating the lanes of three of them.
+
+#ifdef ENABLE_AVX2
+
+#include <crypto/pow/Lyra2.h>
+
+#include <stdint.h>
+#include <string.h>
+#if defined(_MSC_VER)
+#include <immintrin.h>
+#elif defined(__GNUC__)
+#include <x86intrin.h>
+#endif
+
+namespace {
+
+static const uint64_t blake2b_IV[8] =
+{
+  0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+  0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+  0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+  0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+inline __m256i RotR32(__m256i x) { return _mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)); }
+inline __m256i RotR24(__m256i x)
+{
+    const __m256i r24 = _mm256_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,
+                                         3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+    return _mm256_shuffle_epi8(x, r24);
+}
+inline __m256i RotR16(__m256i x)
+{
+    const __m256i r16 = _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+                                         2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+    return _mm256_shuffle_epi8(x, r16);
+}
+inline __m256i RotR63(__m256i x) { return _mm256_or_si256(_mm256_srli_epi64(x, 63), _mm256_add_epi64(x, x)); }
+
+/** Sponge state: words 0-3, 4-7, 8-11 and 12-15. The first three hold the bitrate. */
+struct State
+{
+    __m256i s[4];
+
+    void Init()
+    {
+        s[0] = _mm256_setzero_si256();
+        s[1] = _mm256_setzero_si256();
+        s[2] = _mm256_loadu_si256((const __m256i*)&blake2b_IV[0]);
+        s[3] = _mm256_loadu_si256((const __m256i*)&blake2b_IV[4]);
+    }
+
+    /** Four G functions side by side, as G(r,0..3) or G(r,4..7) of ROUND_LYRA */
+    static inline void G4(__m256i& a, __m256i& b, __m256i& c, __m256i& d)
+    {
+        a = _mm256_add_epi64(a, b);
+        d = RotR32(_mm256_xor_si256(d, a));
+        c = _mm256_add_epi64(c, d);
+        b = RotR24(_mm256_xor_si256(b, c));
+        a = _mm256_add_epi64(a, b);
+        d = RotR16(_mm256_xor_si256(d, a));
+        c = _mm256_add_epi64(c, d);
+        b = RotR63(_mm256_xor_si256(b, c));
+    }
+
+    inline void Round()
+    {
+        G4(s[0], s[1], s[2], s[3]);
+        s[1] = _mm256_permute4x64_epi64(s[1], _MM_SHUFFLE(0, 3, 2, 1));
+        s[2] = _mm256_permute4x64_epi64(s[2], _MM_SHUFFLE(1, 0, 3, 2));
+        s[3] = _mm256_permute4x64_epi64(s[3], _MM_SHUFFLE(2, 1, 0, 3));
+        G4(s[0], s[1], s[2], s[3]);
+        s[1] = _mm256_permute4x64_epi64(s[1], _MM_SHUFFLE(2, 1, 0, 3));
+        s[2] = _mm256_permute4x64_epi64(s[2], _MM_SHUFFLE(1, 0, 3, 2));
+        s[3] = _mm256_permute4x64_epi64(s[3], _MM_SHUFFLE(0, 3, 2, 1));
+    }
+
+    void FullRounds()
+    {
+        for (int r = 0; r < 12; r++)
+            Round();
+    }
+
+    uint64_t Word0() const
+    {
+        uint64_t w;
+        _mm_storel_epi64((__m128i*)&w, _mm256_castsi256_si128(s[0]));
+        return w;
+    }
+};
+
+inline __m256i Load(const uint64_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+inline void Store(uint64_t* p, __m256i x) { _mm256_storeu_si256((__m256i*)p, x); }
+
+/** rotW(rand): the 12 bitrate words rotated up by one, word 11 moving to word 0 */
+inline void RotW(const __m256i r[3], __m256i out[3])
+{
+    const __m256i t0 = _mm256_permute4x64_epi64(r[0], _MM_SHUFFLE(2, 1, 0, 3));
+    const __m256i t1 = _mm256_permute4x64_epi64(r[1], _MM_SHUFFLE(2, 1, 0, 3));
+    const __m256i t2 = _mm256_permute4x64_epi64(r[2], _MM_SHUFFLE(2, 1, 0, 3));
+    out[0] = _mm256_blend_epi32(t0, t2, 0x03);
+    out[1] = _mm256_blend_epi32(t1, t0, 0x03);
+    out[2] = _mm256_blend_epi32(t2, t1, 0x03);
+}
+
+void ReducedSqueezeRow0(State& st, uint64_t* rowOut, uint64_t nCols)
+{
+    uint64_t* ptrWord = rowOut + (nCols - 1) * BLOCK_LEN_INT64;
+    for (uint64_t i = 0; i < nCols; i++) {
+        for (int k = 0; k < 3; k++)
+            Store(ptrWord + 4 * k, st.s[k]);
+        ptrWord -= BLOCK_LEN_INT64;
+        st.Round();
+    }
+}
+
+void ReducedDuplexRow1(State& st, const uint64_t* rowIn, uint64_t* rowOut, uint64_t nCols)
+{
+    const uint64_t* ptrWordIn = rowIn;
+    uint64_t* ptrWordOut = rowOut + (nCols - 1) * BLOCK_LEN_INT64;
+    for (uint64_t i = 0; i < nCols; i++) {
+        __m256i in[3];
+        for (int k = 0; k < 3; k++) {
+            in[k] = Load(ptrWordIn + 4 * k);
+            st.s[k] = _mm256_xor_si256(st.s[k], in[k]);
+        }
+        st.Round();
+        for (int k = 0; k < 3; k++)
+            Store(ptrWordOut + 4 * k, _mm256_xor_si256(in[k], st.s[k]));
+        ptrWordIn += BLOCK_LEN_INT64;
+        ptrWordOut -= BLOCK_LEN_INT64;
+    }
+}
+
+void ReducedDuplexRowSetup(State& st, const uint64_t* rowIn, uint64_t* rowInOut, uint64_t* rowOut, uint64_t nCols)
+{
+    const uint64_t* ptrWordIn = rowIn;
+    uint64_t* ptrWordInOut = rowInOut;
+    uint64_t* ptrWordOut = rowOut + (nCols - 1) * BLOCK_LEN_INT64;
+    for (uint64_t i = 0; i < nCols; i++) {
+        __m256i in[3], inout[3], rot[3];
+        for (int k = 0; k < 3; k++) {
+            in[k] = Load(ptrWordIn + 4 * k);
+            inout[k] = Load(ptrWordInOut + 4 * k);
+            st.s[k] = _mm256_xor_si256(st.s[k], _mm256_add_epi64(in[k], inout[k]));
+        }
+        st.Round();
+        RotW(st.s, rot);
+        for (int k = 0; k < 3; k++) {
+            Store(ptrWordOut + 4 * k, _mm256_xor_si256(in[k], st.s[k]));
+            Store(ptrWordInOut + 4 * k, _mm256_xor_si256(inout[k], rot[k]));
+        }
+        ptrWordInOut += BLOCK_LEN_INT64;
+        ptrWordIn += BLOCK_LEN_INT64;
+        ptrWordOut -= BLOCK_LEN_INT64;
+    }
+}
+
+void ReducedDuplexRow(State& st, const uint64_t* rowIn, uint64_t* rowInOut, uint64_t* rowOut, uint64_t nCols)
+{
+    const uint64_t* ptrWordIn = rowIn;
+    uint64_t* ptrWordInOut = rowInOut;
+    uint64_t* ptrWordOut = rowOut;
+    for (uint64_t i = 0; i < nCols; i++) {
+        __m256i rot[3];
+        for (int k = 0; k < 3; k++)
+            st.s[k] = _mm256_xor_si256(st.s[k], _mm256_add_epi64(Load(ptrWordIn + 4 * k), Load(ptrWordInOut + 4 * k)));
+        st.Round();
+        RotW(st.s, rot);
+        // rowOut and rowInOut may be the same row, so reload between the two updates
+        for (int k = 0; k < 3; k++)
+            Store(ptrWordOut + 4 * k, _mm256_xor_si256(Load(ptrWordOut + 4 * k), st.s[k]));
+        for (int k = 0; k < 3; k++)
+            Store(ptrWordInOut + 4 * k, _mm256_xor_si256(Load(ptrWordInOut + 4 * k), rot[k]));
+        ptrWordOut += BLOCK_LEN_INT64;
+        ptrWordInOut += BLOCK_LEN_INT64;
+        ptrWordIn += BLOCK_LEN_INT64;
+    }
+}
+
+void Squeeze(State& st, unsigned char* out, uint64_t len)
+{
+    alignas(32) uint64_t block[12];
+    while (true) {
+        for (int k = 0; k < 3; k++)
+            _mm256_store_si256((__m256i*)&block[4 * k], st.s[k]);
+        if (len < BLOCK_LEN_BYTES)
+            break;
+        memcpy(out, block, BLOCK_LEN_BYTES);
+        st.FullRounds();
+        out += BLOCK_LEN_BYTES;
+        len -= BLOCK_LEN_BYTES;
+    }
+    memcpy(out, block, len);
+}
+
+} // namespace
+
+extern "C" int LYRA2_avx2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols)
+{
+    int64_t row = 2;
+    int64_t prev = 1;
+    int64_t rowa = 0;
+    int64_t step = 1;
+    int64_t window = 2;
+    int64_t gap = 1;
+
+    lyra2_memory mem;
+    if (lyra2_memory_acquire(&mem, nRows, nCols) != 0)
+        return -1;
+    uint64_t* wholeMatrix = mem.wholeMatrix;
+    uint64_t** memMatrix = mem.memMatrix;
+
+    // pad(pwd || salt || basil), exactly as in LYRA2()
+    const uint64_t nBlocksInput = ((saltlen + pwdlen + 6 * sizeof(uint64_t)) / BLOCK_LEN_BLAKE2_SAFE_BYTES) + 1;
+    unsigned char* ptrByte = (unsigned char*)wholeMatrix;
+    memset(ptrByte, 0, nBlocksInput * BLOCK_LEN_BLAKE2_SAFE_BYTES);
+    memcpy(ptrByte, pwd, pwdlen);
+    ptrByte += pwdlen;
+    memcpy(ptrByte, salt, saltlen);
+    ptrByte += saltlen;
+    const uint64_t basil[6] = {kLen, pwdlen, saltlen, timeCost, nRows, nCols};
+    memcpy(ptrByte, basil, sizeof(basil));
+    ptrByte += sizeof(basil);
+    *ptrByte = 0x80;
+    ((unsigned char*)wholeMatrix)[nBlocksInput * BLOCK_LEN_BLAKE2_SAFE_BYTES - 1] ^= 0x01;
+
+    State st;
+    st.Init();
+
+    // Setup phase
+    const uint64_t* ptrWord = wholeMatrix;
+    for (uint64_t i = 0; i < nBlocksInput; i++) {
+        st.s[0] = _mm256_xor_si256(st.s[0], Load(ptrWord));
+        st.s[1] = _mm256_xor_si256(st.s[1], Load(ptrWord + 4));
+        st.FullRounds();
+        ptrWord += BLOCK_LEN_BLAKE2_SAFE_INT64;
+    }
+
+    ReducedSqueezeRow0(st, memMatrix[0], nCols);
+    ReducedDuplexRow1(st, memMatrix[0], memMatrix[1], nCols);
+
+    do {
+        ReducedDuplexRowSetup(st, memMatrix[prev], memMatrix[rowa], memMatrix[row], nCols);
+        rowa = (rowa + step) & (window - 1);
+        prev = row;
+        row++;
+        if (rowa == 0) {
+            step = window + gap;
+            window *= 2;
+            gap = -gap;
+        }
+    } while (row < (int64_t)nRows);
+
+    // Wandering phase
+    row = 0;
+    for (int64_t tau = 1; tau <= (int64_t)timeCost; tau++) {
+        step = (tau % 2 == 0) ? -1 : (int64_t)nRows / 2 - 1;
+        do {
+            rowa = st.Word0() % nRows;
+            ReducedDuplexRow(st, memMatrix[prev], memMatrix[rowa], memMatrix[row], nCols);
+            prev = row;
+            row = (row + step) % nRows;
+        } while (row != 0);
+    }
+
+    // Wrap-up phase
+    for (int k = 0; k < 3; k++)
+        st.s[k] = _mm256_xor_si256(st.s[k], Load(memMatrix[rowa] + 4 * k));
+    st.FullRounds();
+    Squeeze(st, (unsigned char*)K, kLen);
+
+    lyra2_memory_release(&mem);
+    return 0;
+}
+
+#endif
@@ -17,6 +17,10 @@
  * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
+#if defined(HAVE_CONFIG_H)
+#include "config/verge-config.h"
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -24,6 +28,68 @@
 #include "Lyra2.h"
 #include "Sponge.h"
 
+#if defined(_MSC_VER)
+#define LYRA2_THREAD_LOCAL __declspec(thread)
+#define LYRA2_CACHE_ALIGN __declspec(align(64))
+#else
+#define LYRA2_THREAD_LOCAL __thread
+#define LYRA2_CACHE_ALIGN __attribute__ ((aligned(64)))
+#endif
+
+//Largest matrix kept in the per-thread workspace: enough for Lyra2RE (8x8) and Lyra2REv2 (4x4)
+#define LYRA2_WORKSPACE_ROWS 8
+#define LYRA2_WORKSPACE_COLS 8
+
+typedef struct {
+    uint64_t matrix[LYRA2_WORKSPACE_ROWS * LYRA2_WORKSPACE_COLS * BLOCK_LEN_INT64];
+    uint64_t *rows[LYRA2_WORKSPACE_ROWS];
+    uint64_t state[16];
+} lyra2_workspace;
+
+//Hashing runs on many threads (validation, RPC, miners), so each gets its own cache-aligned workspace
+static LYRA2_THREAD_LOCAL LYRA2_CACHE_ALIGN lyra2_workspace lyra2_ws;
+
+int lyra2_memory_acquire(lyra2_memory *mem, uint64_t nRows, uint64_t nCols) {
+    const uint64_t ROW_LEN_INT64 = BLOCK_LEN_INT64 * nCols;
+    const size_t matrixBytes = (size_t) (nRows * ROW_LEN_INT64 * 8);
+    uint64_t i;
+
+    if (nRows <= LYRA2_WORKSPACE_ROWS && nCols <= LYRA2_WORKSPACE_COLS) {
+      mem->wholeMatrix = lyra2_ws.matrix;
+      mem->memMatrix = lyra2_ws.rows;
+      mem->state = lyra2_ws.state;
+      mem->onHeap = 0;
+    } else {
+      mem->wholeMatrix = malloc(matrixBytes);
+      mem->memMatrix = malloc(nRows * sizeof (uint64_t*));
+      mem->state = malloc(16 * sizeof (uint64_t));
+      mem->onHeap = 1;
+      if (mem->wholeMatrix == NULL || mem->memMatrix == NULL || mem->state == NULL) {
+        lyra2_memory_release(mem);
+        return -1;
+      }
+    }
+    memset(mem->wholeMatrix, 0, matrixBytes);
+
+    //Places the pointers in the correct positions
+    for (i = 0; i < nRows; i++) {
+      mem->memMatrix[i] = mem->wholeMatrix + i * ROW_LEN_INT64;
+    }
+    return 0;
+}
+
+void lyra2_memory_release(lyra2_memory *mem) {
+    //Wiping out the sponge's internal state
+    if (mem->state != NULL) {
+      memset(mem->state, 0, 16 * sizeof (uint64_t));
+    }
+    if (mem->onHeap) {
+      free(mem->memMatrix);
+      free(mem->wholeMatrix);
+      free(mem->state);
+    }
+}
+
 /**
  * Executes Lyra2 based on the G function from Blake2b. This version supports salts and passwords
  * whose combined length is smaller than the size of the memory matrix, (i.e., (nRows x nCols x b) bits,
@@ -43,7 +109,7 @@
  *
  * @return 0 if the key is generated correctly; -1 if there is an error (usually due to lack of memory for allocation)
  */
-int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols) {
+static int LYRA2_generic(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols) {
 
     //============================= Basic variables ============================//
     int64_t row = 2; //index of row to be processed
@@ -57,30 +123,14 @@ int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *
     //==========================================================================/
 
     //========== Initializing the Memory Matrix and pointers to it =============//
-    //Tries to allocate enough space for the whole memory matrix
-
-
-    const int64_t ROW_LEN_INT64 = BLOCK_LEN_INT64 * nCols;
-    const int64_t ROW_LEN_BYTES = ROW_LEN_INT64 * 8;
-
-    i = (int64_t) ((int64_t) nRows * (int64_t) ROW_LEN_BYTES);
-    uint64_t *wholeMatrix = malloc(i);
-    if (wholeMatrix == NULL) {
-      return -1;
-    }
-	memset(wholeMatrix, 0, i);
-
-    //Allocates pointers to each row of the matrix
-    uint64_t **memMatrix = malloc(nRows * sizeof (uint64_t*));
-    if (memMatrix == NULL) {
+    //Takes this thread's workspace, or allocates the memory matrix if it does not fit in it
+    lyra2_memory mem;
+    if (lyra2_memory_acquire(&mem, nRows, nCols) != 0) {
       return -1;
     }
-    //Places the pointers in the correct positions
-    uint64_t *ptrWord = wholeMatrix;
-    for (i = 0; i < (int64_t) nRows; i++) {
-      memMatrix[i] = ptrWord;
-      ptrWord += ROW_LEN_INT64;
-    }
+    uint64_t *wholeMatrix = mem.wholeMatrix;
+    uint64_t **memMatrix = mem.memMatrix;
+    uint64_t *ptrWord;
     //==========================================================================/
 
     //============= Getting the password + salt + basil padded with 10*1 ===============//
@@ -123,10 +173,7 @@ int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *
 
     //======================= Initializing the Sponge State ====================//
     //Sponge state: 16 uint64_t, BLOCK_LEN_INT64 words of them for the bitrate (b) and the remainder for the capacity (c)
-    uint64_t *state = malloc(16 * sizeof (uint64_t));
-    if (state == NULL) {
-      return -1;
-    }
+    uint64_t *state = mem.state;
     initState(state);
     //==========================================================================/
 
@@ -201,17 +248,67 @@ int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *
     //==========================================================================/
 
     //========================= Freeing the memory =============================//
-    free(memMatrix);
-    free(wholeMatrix);
-
-    //Wiping out the sponge's internal state before freeing it
-    memset(state, 0, 16 * sizeof (uint64_t));
-    free(state);
+    lyra2_memory_release(&mem);
     //==========================================================================/
 
     return 0;
 }
 
+#if defined(ENABLE_AVX2) && !defined(BUILD_VERGE_INTERNAL) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+#define USE_LYRA2_AVX2 1
+//Lyra2-avx2.cpp: the same algorithm with the sponge state held in four AVX2 registers
+int LYRA2_avx2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols);
+
+static void lyra2_cpuid(uint32_t leaf, uint32_t subleaf, uint32_t *a, uint32_t *b, uint32_t *c, uint32_t *d) {
+    __asm__ ("cpuid" : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d) : "0"(leaf), "2"(subleaf));
+}
+
+//Whether the CPU has AVX2 and the OS saves the YMM registers
+static int lyra2_have_avx2(void) {
+    uint32_t eax, ebx, ecx, edx, xcr0_lo, xcr0_hi;
+    lyra2_cpuid(0, 0, &eax, &ebx, &ecx, &edx);
+    if (eax < 7) return 0;
+    lyra2_cpuid(1, 0, &eax, &ebx, &ecx, &edx);
+    if (!((ecx >> 27) & 1)) return 0; //OSXSAVE
+    __asm__ ("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 6) != 6) return 0; //XMM and YMM state
+    lyra2_cpuid(7, 0, &eax, &ebx, &ecx, &edx);
+    return (ebx >> 5) & 1;
+}
+#endif
+
+//Generic sponge until LYRA2_detect() is called
+static int (*LYRA2_selected)(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols) = &LYRA2_generic;
+
+int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols) {
+    return LYRA2_selected(K, kLen, pwd, pwdlen, salt, saltlen, timeCost, nRows, nCols);
+}
+
+const char *LYRA2_detect(void) {
+#if defined(USE_LYRA2_AVX2)
+    if (lyra2_have_avx2()) {
+      //Only switch over if the AVX2 sponge agrees with the generic one, for both matrix sizes in use
+      unsigned char pwd[32], expected[32], result[32];
+      int ok = 1;
+      uint64_t n;
+      for (n = 0; n < 32; n++) {
+        pwd[n] = (unsigned char) n;
+      }
+      for (n = 4; n <= 8; n += 4) {
+        LYRA2_generic(expected, 32, pwd, 32, pwd, 32, 1, n, n);
+        LYRA2_avx2(result, 32, pwd, 32, pwd, 32, 1, n, n);
+        ok &= memcmp(expected, result, 32) == 0;
+      }
+      if (ok) {
+        LYRA2_selected = &LYRA2_avx2;
+        return "avx2";
+      }
+    }
+#endif
+    LYRA2_selected = &LYRA2_generic;
+    return "generic";
+}
+
 int LYRA2_old(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols) {
 
     //============================= Basic variables ============================//
@@ -226,30 +323,14 @@ int LYRA2_old(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const vo
     //==========================================================================/
 
     //========== Initializing the Memory Matrix and pointers to it =============//
-    //Tries to allocate enough space for the whole memory matrix
-
-
-    const int64_t ROW_LEN_INT64 = BLOCK_LEN_INT64 * nCols;
-    const int64_t ROW_LEN_BYTES = ROW_LEN_INT64 * 8;
-
-    i = (int64_t) ((int64_t) nRows * (int64_t) ROW_LEN_BYTES);
-    uint64_t *wholeMatrix = malloc(i);
-    if (wholeMatrix == NULL) {
-      return -1;
-    }
-	memset(wholeMatrix, 0, i);
-
-    //Allocates pointers to each row of the matrix
-    uint64_t **memMatrix = malloc(nRows * sizeof (uint64_t*));
-    if (memMatrix == NULL) {
+    //Takes this thread's workspace, or allocates the memory matrix if it does not fit in it
+    lyra2_memory mem;
+    if (lyra2_memory_acquire(&mem, nRows, nCols) != 0) {
       return -1;
     }
-    //Places the pointers in the correct positions
-    uint64_t *ptrWord = wholeMatrix;
-    for (i = 0; i < (int64_t) nRows; i++) {
-      memMatrix[i] = ptrWord;
-      ptrWord += ROW_LEN_INT64;
-    }
+    uint64_t *wholeMatrix = mem.wholeMatrix;
+    uint64_t **memMatrix = mem.memMatrix;
+    uint64_t *ptrWord;
     //==========================================================================/
 
     //============= Getting the password + salt + basil padded with 10*1 ===============//
@@ -292,10 +373,7 @@ int LYRA2_old(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const vo
 
     //======================= Initializing the Sponge State ====================//
     //Sponge state: 16 uint64_t, BLOCK_LEN_INT64 words of them for the bitrate (b) and the remainder for the capacity (c)
-    uint64_t *state = malloc(16 * sizeof (uint64_t));
-    if (state == NULL) {
-      return -1;
-    }
+    uint64_t *state = mem.state;
     initState(state);
     //==========================================================================/
 
@@ -370,12 +448,7 @@ int LYRA2_old(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const vo
     //==========================================================================/
 
     //========================= Freeing the memory =============================//
-    free(memMatrix);
-    free(wholeMatrix);
-
-    //Wiping out the sponge's internal state before freeing it
-    memset(state, 0, 16 * sizeof (uint64_t));
-    free(state);
+    lyra2_memory_release(&mem);
     //==========================================================================/
 
     return 0;
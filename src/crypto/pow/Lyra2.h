@@ -37,8 +37,31 @@ typedef unsigned char byte;
         #define BLOCK_LEN_BYTES (BLOCK_LEN_INT64 * 8)    //Block length, in bytes
 #endif
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Memory matrix, row pointers and sponge state of one LYRA2 evaluation
+typedef struct {
+    uint64_t *wholeMatrix;
+    uint64_t **memMatrix;
+    uint64_t *state;
+    int onHeap;
+} lyra2_memory;
+
+//Zeroed memory for an nRows x nCols matrix: the calling thread's workspace if it fits, the heap otherwise
+int lyra2_memory_acquire(lyra2_memory *mem, uint64_t nRows, uint64_t nCols);
+void lyra2_memory_release(lyra2_memory *mem);
+
 int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols);
 
 int LYRA2_old(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols);
 
+//Switches LYRA2 to the fastest sponge implementation that passes a self-test, returns its name
+const char *LYRA2_detect(void);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif // VERGE_CRYPTO_POW_LYRA2_H
@@ -0,0 +1,242 @@
+// Copyright (c) 2018-2020 The Verge Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include <config/verge-config.h>
+#endif
+
+#include <crypto/pow/hashx17.h>
+
+#include <crypto/pow/sph_blake.h>
+#include <crypto/pow/sph_bmw.h>
+#include <crypto/pow/sph_cubehash.h>
+#include <crypto/pow/sph_echo.h>
+#include <crypto/pow/sph_fugue.h>
+#include <crypto/pow/sph_groestl.h>
+#include <crypto/pow/sph_hamsi.h>
+#include <crypto/pow/sph_haval.h>
+#include <crypto/pow/sph_jh.h>
+#include <crypto/pow/sph_keccak.h>
+#include <crypto/pow/sph_luffa.h>
+#include <crypto/pow/sph_sha2.h>
+#include <crypto/pow/sph_shabal.h>
+#include <crypto/pow/sph_shavite.h>
+#include <crypto/pow/sph_simd.h>
+#include <crypto/pow/sph_skein.h>
+#include <crypto/pow/sph_whirlpool.h>
+
+#include <stdint.h>
+#include <string.h>
+
+namespace {
+
+/** The context of every X17 stage right after its init call */
+struct X17Contexts
+{
+    sph_blake512_context      blake;
+    sph_bmw512_context        bmw;
+    sph_groestl512_context    groestl;
+    sph_skein512_context      skein;
+    sph_jh512_context         jh;
+    sph_keccak512_context     keccak;
+    sph_luffa512_context      luffa;
+    sph_cubehash512_context   cubehash;
+    sph_shavite512_context    shavite;
+    sph_simd512_context       simd;
+    sph_echo512_context       echo;
+    sph_hamsi512_context      hamsi;
+    sph_fugue512_context      fugue;
+    sph_shabal512_context     shabal;
+    sph_whirlpool_context     whirlpool;
+    sph_sha512_context        sha2;
+    sph_haval256_5_context    haval;
+
+    X17Contexts()
+    {
+        sph_blake512_init(&blake);
+        sph_bmw512_init(&bmw);
+        sph_groestl512_init(&groestl);
+        sph_skein512_init(&skein);
+        sph_jh512_init(&jh);
+        sph_keccak512_init(&keccak);
+        sph_luffa512_init(&luffa);
+        sph_cubehash512_init(&cubehash);
+        sph_shavite512_init(&shavite);
+        sph_simd512_init(&simd);
+        sph_echo512_init(&echo);
+        sph_hamsi512_init(&hamsi);
+        sph_fugue512_init(&fugue);
+        sph_shabal512_init(&shabal);
+        sph_whirlpool_init(&whirlpool);
+        sph_sha512_init(&sha2);
+        sph_haval256_5_init(&haval);
+    }
+};
+
+/** Built on first use and never written again, so all threads can copy from it */
+const X17Contexts& InitialContexts()
+{
+    static const X17Contexts contexts;
+    return contexts;
+}
+
+void Cubehash512Generic(const unsigned char* in, unsigned char* out)
+{
+    sph_cubehash512_context ctx = InitialContexts().cubehash;
+    sph_cubehash512(&ctx, in, 64);
+    sph_cubehash512_close(&ctx, out);
+}
+
+void Shavite512Generic(const unsigned char* in, unsigned char* out)
+{
+    sph_shavite512_context ctx = InitialContexts().shavite;
+    sph_shavite512(&ctx, in, 64);
+    sph_shavite512_close(&ctx, out);
+}
+
+void Echo512Generic(const unsigned char* in, unsigned char* out)
+{
+    sph_echo512_context ctx = InitialContexts().echo;
+    sph_echo512(&ctx, in, 64);
+    sph_echo512_close(&ctx, out);
+}
+
+} // namespace
+
+#if defined(ENABLE_AESNI) && !defined(BUILD_VERGE_INTERNAL) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+#define USE_X17_AESNI 1
+namespace x17_aesni
+{
+void Cubehash512_64(const unsigned char* in, unsigned char* out);
+void Echo512_64(const unsigned char* in, unsigned char* out);
+void Shavite512_64(const unsigned char* in, unsigned char* out);
+}
+
+static inline void x17_cpuid(uint32_t leaf, uint32_t subleaf, uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d)
+{
+    __asm__ ("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "0"(leaf), "2"(subleaf));
+}
+
+/** Whether the CPU has AES-NI. */
+static bool x17_have_aesni()
+{
+    uint32_t eax, ebx, ecx, edx;
+    x17_cpuid(1, 0, eax, ebx, ecx, edx);
+    return (ecx >> 25) & 1;
+}
+#endif
+
+// The sph code until x17_detect() is called. All take a 64-byte message.
+// Groestl and SIMD stay on sph: each is under a tenth of an X17 hash, and
+// their vector forms (a transposed AES-NI state, a vector NTT) are whole
+// rewrites that would save a few percent at best.
+static void (*x17_cubehash512_64)(const unsigned char* in, unsigned char* out) = &Cubehash512Generic;
+static void (*x17_shavite512_64)(const unsigned char* in, unsigned char* out) = &Shavite512Generic;
+static void (*x17_echo512_64)(const unsigned char* in, unsigned char* out) = &Echo512Generic;
+
+uint256 HashX17(const void* data, size_t len)
+{
+    const X17Contexts& z = InitialContexts();
+    uint512 hash[17];
+
+    sph_blake512_context ctx_blake = z.blake;
+    sph_blake512(&ctx_blake, data, len);
+    sph_blake512_close(&ctx_blake, static_cast<void*>(&hash[0]));
+
+    sph_bmw512_context ctx_bmw = z.bmw;
+    sph_bmw512(&ctx_bmw, static_cast<const void*>(&hash[0]), 64);
+    sph_bmw512_close(&ctx_bmw, static_cast<void*>(&hash[1]));
+
+    sph_groestl512_context ctx_groestl = z.groestl;
+    sph_groestl512(&ctx_groestl, static_cast<const void*>(&hash[1]), 64);
+    sph_groestl512_close(&ctx_groestl, static_cast<void*>(&hash[2]));
+
+    sph_skein512_context ctx_skein = z.skein;
+    sph_skein512(&ctx_skein, static_cast<const void*>(&hash[2]), 64);
+    sph_skein512_close(&ctx_skein, static_cast<void*>(&hash[3]));
+
+    sph_jh512_context ctx_jh = z.jh;
+    sph_jh512(&ctx_jh, static_cast<const void*>(&hash[3]), 64);
+    sph_jh512_close(&ctx_jh, static_cast<void*>(&hash[4]));
+
+    sph_keccak512_context ctx_keccak = z.keccak;
+    sph_keccak512(&ctx_keccak, static_cast<const void*>(&hash[4]), 64);
+    sph_keccak512_close(&ctx_keccak, static_cast<void*>(&hash[5]));
+
+    sph_luffa512_context ctx_luffa = z.luffa;
+    sph_luffa512(&ctx_luffa, static_cast<const void*>(&hash[5]), 64);
+    sph_luffa512_close(&ctx_luffa, static_cast<void*>(&hash[6]));
+
+    x17_cubehash512_64(hash[6].begin(), hash[7].begin());
+
+    x17_shavite512_64(hash[7].begin(), hash[8].begin());
+
+    sph_simd512_context ctx_simd = z.simd;
+    sph_simd512(&ctx_simd, static_cast<const void*>(&hash[8]), 64);
+    sph_simd512_close(&ctx_simd, static_cast<void*>(&hash[9]));
+
+    x17_echo512_64(hash[9].begin(), hash[10].begin());
+
+    sph_hamsi512_context ctx_hamsi = z.hamsi;
+    sph_hamsi512(&ctx_hamsi, static_cast<const void*>(&hash[10]), 64);
+    sph_hamsi512_close(&ctx_hamsi, static_cast<void*>(&hash[11]));
+
+    sph_fugue512_context ctx_fugue = z.fugue;
+    sph_fugue512(&ctx_fugue, static_cast<const void*>(&hash[11]), 64);
+    sph_fugue512_close(&ctx_fugue, static_cast<void*>(&hash[12]));
+
+    sph_shabal512_context ctx_shabal = z.shabal;
+    sph_shabal512(&ctx_shabal, static_cast<const void*>(&hash[12]), 64);
+    sph_shabal512_close(&ctx_shabal, static_cast<void*>(&hash[13]));
+
+    sph_whirlpool_context ctx_whirlpool = z.whirlpool;
+    sph_whirlpool(&ctx_whirlpool, static_cast<const void*>(&hash[13]), 64);
+    sph_whirlpool_close(&ctx_whirlpool, static_cast<void*>(&hash[14]));
+
+    sph_sha512_context ctx_sha2 = z.sha2;
+    sph_sha512(&ctx_sha2, static_cast<const void*>(&hash[14]), 64);
+    sph_sha512_close(&ctx_sha2, static_cast<void*>(&hash[15]));
+
+    sph_haval256_5_context ctx_haval = z.haval;
+    sph_haval256_5(&ctx_haval, static_cast<const void*>(&hash[15]), 64);
+    sph_haval256_5_close(&ctx_haval, static_cast<void*>(&hash[16]));
+
+    return uint256(hash[16]);
+}
+
+const char *x17_detect()
+{
+    // Build the templates now rather than on the first hash
+    InitialContexts();
+#if defined(USE_X17_AESNI)
+    if (x17_have_aesni()) {
+        // Only switch over if the kernels agree with the sph code.
+        bool ok = true;
+        for (int n = 0; n < 4; n++) {
+            unsigned char in[64], expected[64], result[64];
+            for (int b = 0; b < 64; b++)
+                in[b] = (unsigned char)(n * 64 + b * 7);
+            Cubehash512Generic(in, expected);
+            x17_aesni::Cubehash512_64(in, result);
+            ok &= memcmp(expected, result, 64) == 0;
+            Shavite512Generic(in, expected);
+            x17_aesni::Shavite512_64(in, result);
+            ok &= memcmp(expected, result, 64) == 0;
+            Echo512Generic(in, expected);
+            x17_aesni::Echo512_64(in, result);
+            ok &= memcmp(expected, result, 64) == 0;
+        }
+        if (ok) {
+            x17_cubehash512_64 = &x17_aesni::Cubehash512_64;
+            x17_shavite512_64 = &x17_aesni::Shavite512_64;
+            x17_echo512_64 = &x17_aesni::Echo512_64;
+            return "aesni";
+        }
+    }
+#endif
+    x17_cubehash512_64 = &Cubehash512Generic;
+    x17_shavite512_64 = &Shavite512Generic;
+    x17_echo512_64 = &Echo512Generic;
+    return "generic";
+}
@@ -0,0 +1,242 @@
+// Copyright (c) 2018-2020 The Verge Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// 8-way interleaved scrypt_1024_1_1_256: lane l of every __m256i belongs to
+// the l-th input, so salsa20/8 and the PBKDF2-SHA256 stages run on eight
+// headers at once.
+
+#ifdef ENABLE_AVX2
+
+#include <crypto/pow/scrypt.h>
+#include <crypto/common.h>
+
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+#if defined(_MSC_VER)
+#include <immintrin.h>
+#elif defined(__GNUC__)
+#include <x86intrin.h>
+#endif
+
+namespace sha256d64_avx2
+{
+void TransformState_8way(uint32_t* s, const unsigned char* in);
+}
+
+namespace scrypt_avx2 {
+namespace {
+
+/** SHA-256 over 8 messages of equal length, one per lane. */
+class CSHA256x8
+{
+private:
+    uint32_t s[64];             //!< word-major: word i of lane l at s[8 * i + l]
+    unsigned char buf[8 * 64];  //!< pending block of lane l at buf + 64 * l
+    uint64_t bytes;             //!< bytes written per lane
+
+public:
+    CSHA256x8() { Reset(); }
+
+    CSHA256x8& Reset()
+    {
+        static const uint32_t iv[8] = {0x6a09e667ul, 0xbb67ae85ul, 0x3c6ef372ul, 0xa54ff53aul, 0x510e527ful, 0x9b05688cul, 0x1f83d9abul, 0x5be0cd19ul};
+        for (int i = 0; i < 8; i++)
+            for (int l = 0; l < 8; l++)
+                s[8 * i + l] = iv[i];
+        bytes = 0;
+        return *this;
+    }
+
+    /** Append len bytes to every lane; lane l reads data[l]. */
+    CSHA256x8& Write(const unsigned char* const data[8], size_t len)
+    {
+        size_t done = 0;
+        while (done < len) {
+            size_t bufsize = bytes % 64;
+            size_t now = std::min(len - done, 64 - bufsize);
+            for (int l = 0; l < 8; l++)
+                memcpy(buf + 64 * l + bufsize, data[l] + done, now);
+            bytes += now;
+            done += now;
+            if (bytes % 64 == 0)
+                sha256d64_avx2::TransformState_8way(s, buf);
+        }
+        return *this;
+    }
+
+    /** Append the same bytes to every lane. */
+    CSHA256x8& WriteAll(const unsigned char* data, size_t len)
+    {
+        const unsigned char* lanes[8] = {data, data, data, data, data, data, data, data};
+        return Write(lanes, len);
+    }
+
+    void Finalize(unsigned char* const out[8])
+    {
+        static const unsigned char pad[64] = {0x80};
+        unsigned char sizedesc[8];
+        WriteBE64(sizedesc, bytes << 3);
+        WriteAll(pad, 1 + ((119 - (bytes % 64)) % 64));
+        WriteAll(sizedesc, 8);
+        for (int l = 0; l < 8; l++)
+            for (int i = 0; i < 8; i++)
+                WriteBE32(out[l] + 4 * i, s[8 * i + l]);
+    }
+};
+
+/** PBKDF2-HMAC-SHA256 with c = 1 on 8 password/salt pairs of equal lengths. */
+void PBKDF2_SHA256_8way(const unsigned char* const passwd[8], size_t passwdlen, const unsigned char* const salt[8],
+    size_t saltlen, unsigned char* const buf[8], size_t dkLen)
+{
+    unsigned char rkey[8][64];
+    const unsigned char* key[8];
+    unsigned char* keyout[8];
+    for (int l = 0; l < 8; l++) {
+        memset(rkey[l], 0, 64);
+        key[l] = rkey[l];
+        keyout[l] = rkey[l];
+    }
+    if (passwdlen <= 64) {
+        for (int l = 0; l < 8; l++)
+            memcpy(rkey[l], passwd[l], passwdlen);
+    } else {
+        CSHA256x8().Write(passwd, passwdlen).Finalize(keyout);
+    }
+
+    // HMAC inner and outer states after the padded key (and the salt)
+    CSHA256x8 inner, outer;
+    for (int l = 0; l < 8; l++)
+        for (int n = 0; n < 64; n++)
+            rkey[l][n] ^= 0x5c;
+    outer.Write(key, 64);
+    for (int l = 0; l < 8; l++)
+        for (int n = 0; n < 64; n++)
+            rkey[l][n] ^= 0x5c ^ 0x36;
+    inner.Write(key, 64).Write(salt, saltlen);
+
+    unsigned char U[8][32];
+    unsigned char* uout[8];
+    const unsigned char* uin[8];
+    for (int l = 0; l < 8; l++) {
+        uout[l] = U[l];
+        uin[l] = U[l];
+    }
+    for (size_t i = 0; i * 32 < dkLen; i++) {
+        unsigned char ivec[4];
+        WriteBE32(ivec, (uint32_t)(i + 1));
+
+        CSHA256x8 h = inner;
+        h.WriteAll(ivec, 4).Finalize(uout);
+        h = outer;
+        h.Write(uin, 32).Finalize(uout);
+
+        size_t clen = std::min(dkLen - i * 32, (size_t)32);
+        for (int l = 0; l < 8; l++)
+            memcpy(buf[l] + i * 32, U[l], clen);
+    }
+}
+
+__m256i inline Add(__m256i x, __m256i y) { return _mm256_add_epi32(x, y); }
+__m256i inline Xor(__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }
+__m256i inline RotL(__m256i x, int n) { return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n)); }
+
+/** salsa20/8 on 8 lanes, same structure as xor_salsa8() in scrypt.cpp. */
+void inline XorSalsa8(__m256i B[16], const __m256i Bx[16])
+{
+    __m256i x[16];
+    for (int i = 0; i < 16; i++)
+        x[i] = B[i] = Xor(B[i], Bx[i]);
+
+    for (int i = 0; i < 8; i += 2) {
+        /* Operate on columns. */
+        x[ 4] = Xor(x[ 4], RotL(Add(x[ 0], x[12]),  7));  x[ 9] = Xor(x[ 9], RotL(Add(x[ 5], x[ 1]),  7));
+        x[14] = Xor(x[14], RotL(Add(x[10], x[ 6]),  7));  x[ 3] = Xor(x[ 3], RotL(Add(x[15], x[11]),  7));
+
+        x[ 8] = Xor(x[ 8], RotL(Add(x[ 4], x[ 0]),  9));  x[13] = Xor(x[13], RotL(Add(x[ 9], x[ 5]),  9));
+        x[ 2] = Xor(x[ 2], RotL(Add(x[14], x[10]),  9));  x[ 7] = Xor(x[ 7], RotL(Add(x[ 3], x[15]),  9));
+
+        x[12] = Xor(x[12], RotL(Add(x[ 8], x[ 4]), 13));  x[ 1] = Xor(x[ 1], RotL(Add(x[13], x[ 9]), 13));
+        x[ 6] = Xor(x[ 6], RotL(Add(x[ 2], x[14]), 13));  x[11] = Xor(x[11], RotL(Add(x[ 7], x[ 3]), 13));
+
+        x[ 0] = Xor(x[ 0], RotL(Add(x[12], x[ 8]), 18));  x[ 5] = Xor(x[ 5], RotL(Add(x[ 1], x[13]), 18));
+        x[10] = Xor(x[10], RotL(Add(x[ 6], x[ 2]), 18));  x[15] = Xor(x[15], RotL(Add(x[11], x[ 7]), 18));
+
+        /* Operate on rows. */
+        x[ 1] = Xor(x[ 1], RotL(Add(x[ 0], x[ 3]),  7));  x[ 6] = Xor(x[ 6], RotL(Add(x[ 5], x[ 4]),  7));
+        x[11] = Xor(x[11], RotL(Add(x[10], x[ 9]),  7));  x[12] = Xor(x[12], RotL(Add(x[15], x[14]),  7));
+
+        x[ 2] = Xor(x[ 2], RotL(Add(x[ 1], x[ 0]),  9));  x[ 7] = Xor(x[ 7], RotL(Add(x[ 6], x[ 5]),  9));
+        x[ 8] = Xor(x[ 8], RotL(Add(x[11], x[10]),  9));  x[13] = Xor(x[13], RotL(Add(x[12], x[15]),  9));
+
+        x[ 3] = Xor(x[ 3], RotL(Add(x[ 2], x[ 1]), 13));  x[ 4] = Xor(x[ 4], RotL(Add(x[ 7], x[ 6]), 13));
+        x[ 9] = Xor(x[ 9], RotL(Add(x[ 8], x[11]), 13));  x[14] = Xor(x[14], RotL(Add(x[13], x[12]), 13));
+
+        x[ 0] = Xor(x[ 0], RotL(Add(x[ 3], x[ 2]), 18));  x[ 5] = Xor(x[ 5], RotL(Add(x[ 4], x[ 7]), 18));
+        x[10] = Xor(x[10], RotL(Add(x[ 9], x[ 8]), 18));  x[15] = Xor(x[15], RotL(Add(x[14], x[13]), 18));
+    }
+
+    for (int i = 0; i < 16; i++)
+        B[i] = Add(B[i], x[i]);
+}
+
+} // namespace
+
+/** Hash 8 80-byte inputs. scratchpad must hold SCRYPT_8WAY_SCRATCHPAD_SIZE bytes. */
+void scrypt_1024_1_1_256_8way(const char* const input[8], char* const output[8], char* scratchpad)
+{
+    unsigned char B[8][128];
+    unsigned char* bout[8];
+    const unsigned char* bin[8];
+    const unsigned char* in[8];
+    unsigned char* out[8];
+    for (int l = 0; l < 8; l++) {
+        bout[l] = B[l];
+        bin[l] = B[l];
+        in[l] = (const unsigned char*)input[l];
+        out[l] = (unsigned char*)output[l];
+    }
+    __m256i X[32];
+    __m256i* V = (__m256i*)(((uintptr_t)(scratchpad) + 63) & ~(uintptr_t)(63));
+
+    PBKDF2_SHA256_8way(in, 80, in, 80, bout, 128);
+
+    for (int k = 0; k < 32; k++) {
+        X[k] = _mm256_set_epi32(ReadLE32(B[7] + 4 * k), ReadLE32(B[6] + 4 * k), ReadLE32(B[5] + 4 * k), ReadLE32(B[4] + 4 * k),
+                                ReadLE32(B[3] + 4 * k), ReadLE32(B[2] + 4 * k), ReadLE32(B[1] + 4 * k), ReadLE32(B[0] + 4 * k));
+    }
+
+    for (int i = 0; i < 1024; i++) {
+        memcpy(&V[i * 32], X, sizeof(X));
+        XorSalsa8(&X[0], &X[16]);
+        XorSalsa8(&X[16], &X[0]);
+    }
+
+    // Each lane picks its own V entry, so read them with gathers: lane l of
+    // word k of entry j is the 32-bit word at (j * 32 + k) * 8 + l.
+    const __m256i lane = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    const __m256i mask = _mm256_set1_epi32(1023);
+    for (int i = 0; i < 1024; i++) {
+        __m256i base = Add(_mm256_slli_epi32(_mm256_and_si256(X[16], mask), 8), lane);
+        for (int k = 0; k < 32; k++) {
+            __m256i idx = Add(base, _mm256_set1_epi32(k * 8));
+            X[k] = Xor(X[k], _mm256_i32gather_epi32((const int*)V, idx, 4));
+        }
+        XorSalsa8(&X[0], &X[16]);
+        XorSalsa8(&X[16], &X[0]);
+    }
+
+    for (int k = 0; k < 32; k++) {
+        alignas(32) uint32_t w[8];
+        _mm256_store_si256((__m256i*)w, X[k]);
+        for (int l = 0; l < 8; l++)
+            WriteLE32(B[l] + 4 * k, w[l]);
+    }
+
+    PBKDF2_SHA256_8way(in, 80, bin, 128, out, 32);
+}
+
+} // namespace scrypt_avx2
+
+#endif
@@ -261,3 +261,103 @@ void scrypt_1024_1_1_256(const char *input, char *output)
 	char scratchpad[SCRYPT_SCRATCHPAD_SIZE];
     scrypt_1024_1_1_256_sp(input, output, scratchpad);
 }
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_VERGE_INTERNAL) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+#define USE_SCRYPT_AVX2 1
+namespace scrypt_avx2
+{
+void scrypt_1024_1_1_256_8way(const char* const input[8], char* const output[8], char* scratchpad);
+}
+
+// We can't use cpuid.h's __get_cpuid as it does not support subleafs.
+static inline void scrypt_cpuid(uint32_t leaf, uint32_t subleaf, uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d)
+{
+    __asm__ ("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "0"(leaf), "2"(subleaf));
+}
+
+/** Whether the CPU has AVX2 and the OS saves the YMM registers. */
+static bool scrypt_have_avx2()
+{
+    uint32_t eax, ebx, ecx, edx;
+    scrypt_cpuid(0, 0, eax, ebx, ecx, edx);
+    if (eax < 7)
+        return false;
+    scrypt_cpuid(1, 0, eax, ebx, ecx, edx);
+    if (!((ecx >> 27) & 1) || !((ecx >> 28) & 1)) // OSXSAVE, AVX
+        return false;
+    uint32_t xcr0_lo, xcr0_hi;
+    __asm__ ("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 6) != 6) // XMM and YMM state
+        return false;
+    scrypt_cpuid(7, 0, eax, ebx, ecx, edx);
+    return (ebx >> 5) & 1;
+}
+#endif
+
+static void scrypt_1024_1_1_256_multi_generic(const char *const in[], char *const out[], size_t n)
+{
+    char *scratchpad = (char *)malloc(SCRYPT_SCRATCHPAD_SIZE);
+    for (size_t i = 0; i < n; i++)
+        scrypt_1024_1_1_256_sp(in[i], out[i], scratchpad);
+    free(scratchpad);
+}
+
+#if defined(USE_SCRYPT_AVX2)
+static void scrypt_1024_1_1_256_multi_avx2(const char *const in[], char *const out[], size_t n)
+{
+    char *scratchpad = (char *)malloc(SCRYPT_8WAY_SCRATCHPAD_SIZE);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        scrypt_avx2::scrypt_1024_1_1_256_8way(in + i, out + i, scratchpad);
+    if (n - i >= 3) {
+        // Pad the tail batch by repeating its last input into dummy outputs;
+        // below three inputs it is cheaper to hash them one by one.
+        const char *tail_in[8];
+        char *tail_out[8];
+        char dummy[8][32];
+        for (size_t l = 0; l < 8; l++) {
+            tail_in[l] = i + l < n ? in[i + l] : in[n - 1];
+            tail_out[l] = i + l < n ? out[i + l] : dummy[l];
+        }
+        scrypt_avx2::scrypt_1024_1_1_256_8way(tail_in, tail_out, scratchpad);
+        i = n;
+    }
+    for (; i < n; i++)
+        scrypt_1024_1_1_256_sp(in[i], out[i], scratchpad);
+    free(scratchpad);
+}
+#endif
+
+// Hash one at a time until scrypt_detect_multi() is called
+static void (*scrypt_1024_1_1_256_multi_detected)(const char *const in[], char *const out[], size_t n) = &scrypt_1024_1_1_256_multi_generic;
+
+void scrypt_1024_1_1_256_multi(const char *const in[], char *const out[], size_t n)
+{
+    scrypt_1024_1_1_256_multi_detected(in, out, n);
+}
+
+const char *scrypt_detect_multi()
+{
+#if defined(USE_SCRYPT_AVX2)
+    if (scrypt_have_avx2()) {
+        // Only switch over if the kernel agrees with the scalar code.
+        char inputs[8][80], expected[8][32], results[8][32];
+        const char *in[8];
+        char *out[8];
+        for (int l = 0; l < 8; l++) {
+            for (int b = 0; b < 80; b++)
+                inputs[l][b] = (char)(l * 80 + b);
+            scrypt_1024_1_1_256(inputs[l], expected[l]);
+            in[l] = inputs[l];
+            out[l] = results[l];
+        }
+        scrypt_1024_1_1_256_multi_avx2(in, out, 8);
+        if (memcmp(expected, results, sizeof(results)) == 0) {
+            scrypt_1024_1_1_256_multi_detected = &scrypt_1024_1_1_256_multi_avx2;
+            return "avx2(8way)";
+        }
+    }
+#endif
+    scrypt_1024_1_1_256_multi_detected = &scrypt_1024_1_1_256_multi_generic;
+    return "generic";
+}
@@ -4,10 +4,19 @@
 #include <stdint.h>
 
 static const int SCRYPT_SCRATCHPAD_SIZE = 131072 + 63;
+static const int SCRYPT_8WAY_SCRATCHPAD_SIZE = 8 * 131072 + 63;
 
 void scrypt_1024_1_1_256(const char *input, char *output);
 void scrypt_1024_1_1_256_sp_generic(const char *input, char *output, char *scratchpad);
 
+/**
+ * Hash n 80-byte inputs, in[i] into out[i]. Uses the interleaved 8-way AVX2
+ * kernel when scrypt_detect_multi() found one, else hashes one at a time.
+ */
+void scrypt_1024_1_1_256_multi(const char *const in[], char *const out[], size_t n);
+/** Select the batch implementation for this CPU; returns its name. */
+const char *scrypt_detect_multi();
+
 #if defined(HAVE_SSE2)
 #if defined(_M_X64) || defined(__x86_64__) || defined(_M_AMD64) || (defined(MAC_OSX) && defined(__i386__))
 #define USE_SSE2_ALWAYS 1
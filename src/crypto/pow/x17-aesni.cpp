@@ -0,0 +1,279 @@
+// Copyright (c) 2018-2020 The Verge Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// X17 stages on 64-byte messages with SSE2 and AES-NI. ECHO-512 and
+// SHAvite-3-512 compute the same as echo.c and shavite.c, with every 128-bit
+// word there one __m128i here and an sph AES round one aesenc. CubeHash-512
+// holds its 32-word state in eight registers instead of cubehash.c's renaming.
+
+#ifdef ENABLE_AESNI
+
+#include <stdint.h>
+#include <string.h>
+#if defined(_MSC_VER)
+#include <immintrin.h>
+#elif defined(__GNUC__)
+#include <x86intrin.h>
+#endif
+
+namespace x17_aesni {
+namespace {
+
+inline __m128i Load(const void* p) { return _mm_loadu_si128((const __m128i*)p); }
+inline void Store(void* p, __m128i x) { _mm_storeu_si128((__m128i*)p, x); }
+
+/** Multiply every byte by 2 in GF(2^8) with the AES polynomial */
+inline __m128i Mul2(__m128i x)
+{
+    const __m128i reduce = _mm_and_si128(_mm_cmplt_epi8(x, _mm_setzero_si128()), _mm_set1_epi8(0x1b));
+    return _mm_xor_si128(_mm_add_epi8(x, x), reduce);
+}
+
+/** MIX_COLUMN of echo.c */
+inline void EchoMixColumn(__m128i& a, __m128i& b, __m128i& c, __m128i& d)
+{
+    const __m128i ab = _mm_xor_si128(a, b);
+    const __m128i bc = _mm_xor_si128(b, c);
+    const __m128i cd = _mm_xor_si128(c, d);
+    const __m128i abx = Mul2(ab);
+    const __m128i bcx = Mul2(bc);
+    const __m128i cdx = Mul2(cd);
+    const __m128i na = _mm_xor_si128(_mm_xor_si128(abx, bc), d);
+    const __m128i nb = _mm_xor_si128(_mm_xor_si128(bcx, a), cd);
+    const __m128i nc = _mm_xor_si128(_mm_xor_si128(cdx, ab), d);
+    const __m128i nd = _mm_xor_si128(_mm_xor_si128(_mm_xor_si128(abx, bcx), _mm_xor_si128(cdx, ab)), c);
+    a = na;
+    b = nb;
+    c = nc;
+    d = nd;
+}
+
+inline __m128i RotL32(__m128i x, int n) { return _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n)); }
+
+/**
+ * One CubeHash round. The word swaps of the a half are done by naming the
+ * registers in a different order, so the caller passes them permuted.
+ */
+#define CUBEHASH_ROUND(a0, a1, a2, a3, b0, b1, b2, b3) do { \
+        b0 = _mm_add_epi32(b0, a0); a0 = RotL32(a0, 7); \
+        b1 = _mm_add_epi32(b1, a1); a1 = RotL32(a1, 7); \
+        b2 = _mm_add_epi32(b2, a2); a2 = RotL32(a2, 7); \
+        b3 = _mm_add_epi32(b3, a3); a3 = RotL32(a3, 7); \
+        a2 = _mm_xor_si128(a2, b0); b0 = _mm_shuffle_epi32(b0, _MM_SHUFFLE(1, 0, 3, 2)); \
+        a3 = _mm_xor_si128(a3, b1); b1 = _mm_shuffle_epi32(b1, _MM_SHUFFLE(1, 0, 3, 2)); \
+        a0 = _mm_xor_si128(a0, b2); b2 = _mm_shuffle_epi32(b2, _MM_SHUFFLE(1, 0, 3, 2)); \
+        a1 = _mm_xor_si128(a1, b3); b3 = _mm_shuffle_epi32(b3, _MM_SHUFFLE(1, 0, 3, 2)); \
+        b0 = _mm_add_epi32(b0, a2); a2 = RotL32(a2, 11); \
+        b1 = _mm_add_epi32(b1, a3); a3 = RotL32(a3, 11); \
+        b2 = _mm_add_epi32(b2, a0); a0 = RotL32(a0, 11); \
+        b3 = _mm_add_epi32(b3, a1); a1 = RotL32(a1, 11); \
+        a3 = _mm_xor_si128(a3, b0); b0 = _mm_shuffle_epi32(b0, _MM_SHUFFLE(2, 3, 0, 1)); \
+        a2 = _mm_xor_si128(a2, b1); b1 = _mm_shuffle_epi32(b1, _MM_SHUFFLE(2, 3, 0, 1)); \
+        a1 = _mm_xor_si128(a1, b2); b2 = _mm_shuffle_epi32(b2, _MM_SHUFFLE(2, 3, 0, 1)); \
+        a0 = _mm_xor_si128(a0, b3); b3 = _mm_shuffle_epi32(b3, _MM_SHUFFLE(2, 3, 0, 1)); \
+    } while (0)
+
+/** Sixteen CubeHash rounds; a[] holds state words 0-15, b[] words 16-31 */
+inline void CubeHashRounds(__m128i a[4], __m128i b[4])
+{
+    __m128i a0 = a[0], a1 = a[1], a2 = a[2], a3 = a[3];
+    __m128i b0 = b[0], b1 = b[1], b2 = b[2], b3 = b[3];
+    // A round leaves word j of a in register 3-j, so two rounds restore the order
+    for (int r = 0; r < 16; r += 2) {
+        CUBEHASH_ROUND(a0, a1, a2, a3, b0, b1, b2, b3);
+        CUBEHASH_ROUND(a3, a2, a1, a0, b0, b1, b2, b3);
+    }
+    a[0] = a0; a[1] = a1; a[2] = a2; a[3] = a3;
+    b[0] = b0; b[1] = b1; b[2] = b2; b[3] = b3;
+}
+
+#undef CUBEHASH_ROUND
+
+} // namespace
+
+/** sph_cubehash512 over a 64-byte message */
+void Cubehash512_64(const unsigned char* in, unsigned char* out)
+{
+    static const uint32_t IV512[32] = {
+        0x2AEA2A61, 0x50F494D4, 0x2D538B8B, 0x4167D83E,
+        0x3FEE2313, 0xC701CF8C, 0xCC39968E, 0x50AC5695,
+        0x4D42C787, 0xA647A8B3, 0x97CF0BEF, 0x825B4537,
+        0xEEF864D2, 0xF22090C4, 0xD0E5CD33, 0xA23911AE,
+        0xFCD398D9, 0x148FE485, 0x1B017BEF, 0xB6444532,
+        0x6A536159, 0x2FF5781C, 0x91FA7934, 0x0DBADEA9,
+        0xD65C8A2B, 0xA5A70E75, 0xB1C62456, 0xBC796576,
+        0x1921C8F7, 0xE7989AF1, 0x7795D246, 0xD43E3B44
+    };
+    __m128i a[4], b[4];
+    for (int j = 0; j < 4; j++) {
+        a[j] = Load(&IV512[4 * j]);
+        b[j] = Load(&IV512[16 + 4 * j]);
+    }
+
+    // Two 32-byte message blocks, then the padding block
+    for (int i = 0; i < 2; i++) {
+        a[0] = _mm_xor_si128(a[0], Load(in + 32 * i));
+        a[1] = _mm_xor_si128(a[1], Load(in + 32 * i + 16));
+        CubeHashRounds(a, b);
+    }
+    a[0] = _mm_xor_si128(a[0], _mm_set_epi32(0, 0, 0, 0x80));
+    CubeHashRounds(a, b);
+
+    // Finalization: flip the last state bit, then ten times sixteen rounds
+    b[3] = _mm_xor_si128(b[3], _mm_set_epi32(1, 0, 0, 0));
+    for (int i = 0; i < 10; i++)
+        CubeHashRounds(a, b);
+
+    for (int j = 0; j < 4; j++)
+        Store(out + 16 * j, a[j]);
+}
+
+/** sph_echo512 over a 64-byte message */
+void Echo512_64(const unsigned char* in, unsigned char* out)
+{
+    // The 64-bit counter of the padded block: 512 message bits
+    const uint32_t count = 512;
+
+    unsigned char block[128];
+    memcpy(block, in, 64);
+    memset(block + 64, 0, 64);
+    block[64] = 0x80;
+    block[110] = (unsigned char)(512 & 0xff);
+    block[111] = (unsigned char)(512 >> 8);
+    memcpy(block + 112, &count, 4);
+
+    // Chaining value of a fresh ECHO-512 context: the output length in each 128-bit word
+    const __m128i iv = _mm_set_epi32(0, 0, 0, 512);
+    __m128i W[16];
+    for (int i = 0; i < 8; i++)
+        W[i] = iv;
+    for (int i = 0; i < 8; i++)
+        W[8 + i] = Load(block + 16 * i);
+
+    uint32_t k0 = count;
+    const __m128i zero = _mm_setzero_si128();
+    for (int r = 0; r < 10; r++) {
+        // BIG_SUB_WORDS: two AES rounds per word, the first keyed with the running counter
+        for (int i = 0; i < 16; i++) {
+            W[i] = _mm_aesenc_si128(W[i], _mm_set_epi32(0, 0, 0, (int)k0++));
+            W[i] = _mm_aesenc_si128(W[i], zero);
+        }
+
+        // BIG_SHIFT_ROWS
+        __m128i t = W[1];
+        W[1] = W[5];
+        W[5] = W[9];
+        W[9] = W[13];
+        W[13] = t;
+        t = W[2];
+        W[2] = W[10];
+        W[10] = t;
+        t = W[6];
+        W[6] = W[14];
+        W[14] = t;
+        t = W[15];
+        W[15] = W[11];
+        W[11] = W[7];
+        W[7] = W[3];
+        W[3] = t;
+
+        // BIG_MIX_COLUMNS
+        for (int i = 0; i < 16; i += 4)
+            EchoMixColumn(W[i], W[i + 1], W[i + 2], W[i + 3]);
+    }
+
+    // FINAL_BIG, keeping the first half of the chaining value
+    for (int i = 0; i < 4; i++)
+        Store(out + 16 * i, _mm_xor_si128(_mm_xor_si128(iv, Load(block + 16 * i)), _mm_xor_si128(W[i], W[i + 8])));
+}
+
+/** sph_shavite512 over a 64-byte message */
+void Shavite512_64(const unsigned char* in, unsigned char* out)
+{
+    static const uint32_t IV512[16] = {
+        0x72FCCDD8, 0x79CA4727, 0x128A077B, 0x40D55AEC,
+        0xD1901A06, 0x430AE307, 0xB29F5CD1, 0xDF07FBFC,
+        0x8E45D73D, 0x681AB538, 0xBDE86578, 0xDD577E47,
+        0xE275EADE, 0x502D9FCD, 0xB9357178, 0x022A4B9A
+    };
+    // Bit counter of the padded block: 512 message bits
+    const uint32_t count0 = 512, count1 = 0, count2 = 0, count3 = 0;
+
+    unsigned char block[128];
+    memcpy(block, in, 64);
+    memset(block + 64, 0, 64);
+    block[64] = 0x80;
+    memcpy(block + 110, &count0, 4);
+    memcpy(block + 114, &count1, 4);
+    memcpy(block + 118, &count2, 4);
+    memcpy(block + 122, &count3, 4);
+    block[126] = (unsigned char)(16 << 5);
+    block[127] = (unsigned char)(16 >> 3);
+
+    // Message expansion of c512, in the order of the SPH_SMALL_FOOTPRINT_SHAVITE code
+    const __m128i zero = _mm_setzero_si128();
+    __m128i rk[112];
+    for (int k = 0; k < 8; k++)
+        rk[k] = Load(block + 16 * k);
+    int k = 8;
+    for (;;) {
+        for (int s = 0; s < 8; s++) {
+            __m128i x = _mm_aesenc_si128(_mm_shuffle_epi32(rk[k - 8], _MM_SHUFFLE(0, 3, 2, 1)), zero);
+            rk[k] = _mm_xor_si128(x, rk[k - 1]);
+            if (k == 8)
+                rk[k] = _mm_xor_si128(rk[k], _mm_set_epi32(~count3, count2, count1, count0));
+            else if (k == 41)
+                rk[k] = _mm_xor_si128(rk[k], _mm_set_epi32(~count0, count1, count2, count3));
+            else if (k == 79)
+                rk[k] = _mm_xor_si128(rk[k], _mm_set_epi32(~count1, count0, count3, count2));
+            else if (k == 110)
+                rk[k] = _mm_xor_si128(rk[k], _mm_set_epi32(~count2, count3, count0, count1));
+            k++;
+        }
+        if (k == 112)
+            break;
+        for (int s = 0; s < 8; s++) {
+            // words u-7 .. u-4: the last three of rk[k - 2] and the first of rk[k - 1]
+            const __m128i w = _mm_or_si128(_mm_srli_si128(rk[k - 2], 4), _mm_slli_si128(rk[k - 1], 12));
+            rk[k] = _mm_xor_si128(rk[k - 8], w);
+            k++;
+        }
+    }
+
+    __m128i p0 = Load(&IV512[0]);
+    __m128i p1 = Load(&IV512[4]);
+    __m128i p2 = Load(&IV512[8]);
+    __m128i p3 = Load(&IV512[12]);
+    const __m128i* key = rk;
+    for (int r = 0; r < 14; r++) {
+        __m128i x = _mm_xor_si128(p1, key[0]);
+        x = _mm_aesenc_si128(x, key[1]);
+        x = _mm_aesenc_si128(x, key[2]);
+        x = _mm_aesenc_si128(x, key[3]);
+        p0 = _mm_xor_si128(p0, _mm_aesenc_si128(x, zero));
+
+        x = _mm_xor_si128(p3, key[4]);
+        x = _mm_aesenc_si128(x, key[5]);
+        x = _mm_aesenc_si128(x, key[6]);
+        x = _mm_aesenc_si128(x, key[7]);
+        p2 = _mm_xor_si128(p2, _mm_aesenc_si128(x, zero));
+        key += 8;
+
+        // WROT
+        const __m128i t = p3;
+        p3 = p2;
+        p2 = p1;
+        p1 = p0;
+        p0 = t;
+    }
+
+    Store(out, _mm_xor_si128(Load(&IV512[0]), p0));
+    Store(out + 16, _mm_xor_si128(Load(&IV512[4]), p1));
+    Store(out + 32, _mm_xor_si128(Load(&IV512[8]), p2));
+    Store(out + 48, _mm_xor_si128(Load(&IV512[12]), p3));
+}
+
+} // namespace x17_aesni
+
+#endif
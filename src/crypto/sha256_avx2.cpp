@@ -324,6 +324,70 @@ void Transform_8way(unsigned char* out, const unsigned char* in)
     Write8(out, 28, Add(h, K(0x5be0cd19ul)));
 }
 
+namespace {
+
+/** Load word i of the 8 lanes of a word-major state (lane l is element l). */
+__m256i inline LoadState(const uint32_t* s, int i) { return _mm256_loadu_si256((const __m256i*)(s + 8 * i)); }
+void inline StoreState(uint32_t* s, int i, __m256i v) { _mm256_storeu_si256((__m256i*)(s + 8 * i), v); }
+
+/** Read big-endian message word at offset from each of 8 consecutive 64-byte chunks. */
+__m256i inline ReadLanes(const unsigned char* chunk, int offset) {
+    return _mm256_set_epi32(
+        ReadBE32(chunk + 448 + offset),
+        ReadBE32(chunk + 384 + offset),
+        ReadBE32(chunk + 320 + offset),
+        ReadBE32(chunk + 256 + offset),
+        ReadBE32(chunk + 192 + offset),
+        ReadBE32(chunk + 128 + offset),
+        ReadBE32(chunk + 64 + offset),
+        ReadBE32(chunk + 0 + offset)
+    );
+}
+
+const uint32_t round_k[64] = {
+    0x428a2f98ul, 0x71374491ul, 0xb5c0fbcful, 0xe9b5dba5ul, 0x3956c25bul, 0x59f111f1ul, 0x923f82a4ul, 0xab1c5ed5ul,
+    0xd807aa98ul, 0x12835b01ul, 0x243185beul, 0x550c7dc3ul, 0x72be5d74ul, 0x80deb1feul, 0x9bdc06a7ul, 0xc19bf174ul,
+    0xe49b69c1ul, 0xefbe4786ul, 0x0fc19dc6ul, 0x240ca1ccul, 0x2de92c6ful, 0x4a7484aaul, 0x5cb0a9dcul, 0x76f988daul,
+    0x983e5152ul, 0xa831c66dul, 0xb00327c8ul, 0xbf597fc7ul, 0xc6e00bf3ul, 0xd5a79147ul, 0x06ca6351ul, 0x14292967ul,
+    0x27b70a85ul, 0x2e1b2138ul, 0x4d2c6dfcul, 0x53380d13ul, 0x650a7354ul, 0x766a0abbul, 0x81c2c92eul, 0x92722c85ul,
+    0xa2bfe8a1ul, 0xa81a664bul, 0xc24b8b70ul, 0xc76c51a3ul, 0xd192e819ul, 0xd6990624ul, 0xf40e3585ul, 0x106aa070ul,
+    0x19a4c116ul, 0x1e376c08ul, 0x2748774cul, 0x34b0bcb5ul, 0x391c0cb3ul, 0x4ed8aa4aul, 0x5b9cca4ful, 0x682e6ff3ul,
+    0x748f82eeul, 0x78a5636ful, 0x84c87814ul, 0x8cc70208ul, 0x90befffaul, 0xa4506cebul, 0xbef9a3f7ul, 0xc67178f2ul,
+};
+
+}
+
+/** One SHA-256 compression on 8 independent states, for callers (such as the
+ *  scrypt PBKDF2 stages) that hash more than a single 64-byte message.
+ *  Word i of lane l lives at s[8 * i + l]; lane l compresses in + 64 * l. */
+void TransformState_8way(uint32_t* s, const unsigned char* in)
+{
+    __m256i a = LoadState(s, 0), b = LoadState(s, 1), c = LoadState(s, 2), d = LoadState(s, 3);
+    __m256i e = LoadState(s, 4), f = LoadState(s, 5), g = LoadState(s, 6), h = LoadState(s, 7);
+    __m256i w[16];
+
+    for (int i = 0; i < 16; ++i) {
+        w[i] = ReadLanes(in, 4 * i);
+    }
+    for (int i = 0; i < 64; ++i) {
+        if (i >= 16) {
+            Inc(w[i & 15], sigma1(w[(i + 14) & 15]), w[(i + 9) & 15], sigma0(w[(i + 1) & 15]));
+        }
+        Round(a, b, c, d, e, f, g, h, Add(K(round_k[i]), w[i & 15]));
+        // Rotate the working variables instead of the arguments.
+        __m256i t = h; h = g; g = f; f = e; e = d; d = c; c = b; b = a; a = t;
+    }
+
+    StoreState(s, 0, Add(LoadState(s, 0), a));
+    StoreState(s, 1, Add(LoadState(s, 1), b));
+    StoreState(s, 2, Add(LoadState(s, 2), c));
+    StoreState(s, 3, Add(LoadState(s, 3), d));
+    StoreState(s, 4, Add(LoadState(s, 4), e));
+    StoreState(s, 5, Add(LoadState(s, 5), f));
+    StoreState(s, 6, Add(LoadState(s, 6), g));
+    StoreState(s, 7, Add(LoadState(s, 7), h));
+}
+
 }
 
 #endif
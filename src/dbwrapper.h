@@ -348,6 +348,14 @@ public:
         pdb->CompactRange(&slKey1, &slKey2);
     }
 
+    /**
+     * Compact the whole database, so erased entries are gone from disk too.
+     */
+    void CompactFull() const
+    {
+        pdb->CompactRange(nullptr, nullptr);
+    }
+
 };
 
 #endif // VERGE_DBWRAPPER_H
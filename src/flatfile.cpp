@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <stdexcept>
+#include <string.h>
 
 #include <flatfile.h>
 #include <logging.h>
@@ -95,4 +96,57 @@ bool FlatFileSeq::Flush(const FlatFilePos& pos, bool finalize)
 
     fclose(file);
     return true;
-}
\ No newline at end of file
+}
+
+FlatFileMapPool::FlatFileMapPool(size_t max_files) :
+    m_max_files(max_files)
+{
+}
+
+std::shared_ptr<const CMappedFile> FlatFileMapPool::Map(const fs::path& path, uint64_t end)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_files.begin(); it != m_files.end(); ++it) {
+        if (it->first != path)
+            continue;
+        m_files.splice(m_files.begin(), m_files, it);
+        if (end <= it->second->size())
+            return it->second;
+        // Readers may still be copying out of the old mapping, so it is
+        // replaced rather than remapped in place
+        m_files.erase(it);
+        break;
+    }
+
+    std::shared_ptr<CMappedFile> file = std::make_shared<CMappedFile>();
+    if (!file->Open(path))
+        return nullptr;
+    m_files.emplace_front(path, file);
+    if (m_files.size() > m_max_files)
+        m_files.pop_back();
+    return file;
+}
+
+bool FlatFileMapPool::Read(const FlatFileSeq& seq, const FlatFilePos& pos, unsigned char* out, size_t size)
+{
+    if (m_max_files == 0 || pos.IsNull())
+        return false;
+    const uint64_t end = (uint64_t)pos.nPos + size;
+    std::shared_ptr<const CMappedFile> file = Map(seq.FileName(pos), end);
+    if (!file || end > file->size())
+        return false;
+    memcpy(out, file->data() + pos.nPos, size);
+    return true;
+}
+
+void FlatFileMapPool::Release(const fs::path& path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_files.remove_if([&path](const std::pair<fs::path, std::shared_ptr<const CMappedFile>>& entry) { return entry.first == path; });
+}
+
+void FlatFileMapPool::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_files.clear();
+}
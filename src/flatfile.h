@@ -6,10 +6,15 @@
 #ifndef VERGE_FLATFILE_H
 #define VERGE_FLATFILE_H
 
+#include <list>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
 
 #include <fs.h>
 #include <serialize.h>
+#include <util/mappedfile.h>
 
 struct FlatFilePos
 {
@@ -93,4 +98,38 @@ public:
     bool Flush(const FlatFilePos& pos, bool finalize = false);
 };
 
+/**
+ * Read-only memory mappings of the files of a FlatFileSeq, so that reading a
+ * record is a copy out of the page cache instead of an open, seek, read and
+ * close. At most a fixed number of files are mapped, the least recently
+ * read one is unmapped to make room. Mappings are extended when a read goes
+ * past their end, data written through file handles is visible in them.
+ */
+class FlatFileMapPool
+{
+private:
+    const size_t m_max_files;
+
+    std::mutex m_mutex;
+    //! Most recently read first
+    std::list<std::pair<fs::path, std::shared_ptr<const CMappedFile>>> m_files;
+
+    std::shared_ptr<const CMappedFile> Map(const fs::path& path, uint64_t end);
+
+public:
+    /** @param max_files The number of files kept mapped, 0 disables the pool. */
+    explicit FlatFileMapPool(size_t max_files);
+
+    /**
+     * Copy size bytes at the given position out of the mapped file. Returns
+     * false if the pool is disabled, the file can't be mapped or is too
+     * short, in which case the caller reads the file as usual.
+     */
+    bool Read(const FlatFileSeq& seq, const FlatFilePos& pos, unsigned char* out, size_t size);
+
+    /** Unmap a file, which must be done before it is truncated or deleted. */
+    void Release(const fs::path& path);
+    void Clear();
+};
+
 #endif // VERGE_FLATFILE_H
\ No newline at end of file
@@ -3,6 +3,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <chainparams.h>
 #include <index/txindex.h>
 #include <shutdown.h>
 #include <ui_interface.h>
@@ -265,17 +266,33 @@ bool TxIndex::FindTx(const uint256& tx_hash, uint256& block_hash, CTransactionRe
         return false;
     }
 
-    CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
+    // Open at the size field in front of the block, which tells whether it is compressed
+    CAutoFile file(OpenBlockFile(FlatFilePos(postx.nFile, postx.nPos - 4), true), SER_DISK, CLIENT_VERSION);
     if (file.IsNull()) {
         return error("%s: OpenBlockFile failed", __func__);
     }
     CBlockHeader header;
     try {
-        file >> header;
-        if (fseek(file.Get(), postx.nTxOffset, SEEK_CUR)) {
-            return error("%s: fseek(...) failed", __func__);
+        uint32_t nSize;
+        file >> nSize;
+        if (nSize & BLOCK_RECORD_COMPRESSED) {
+            // A compressed block can only be decompressed whole
+            file.fclose();
+            std::vector<uint8_t> block_data;
+            if (!ReadRawBlockFromDisk(block_data, postx, Params().MessageStart())) {
+                return error("%s: ReadRawBlockFromDisk failed", __func__);
+            }
+            CDataStream ssBlock((const char*)block_data.data(), (const char*)block_data.data() + block_data.size(), SER_DISK, CLIENT_VERSION);
+            ssBlock >> header;
+            ssBlock.ignore(postx.nTxOffset);
+            ssBlock >> tx;
+        } else {
+            file >> header;
+            if (fseek(file.Get(), postx.nTxOffset, SEEK_CUR)) {
+                return error("%s: fseek(...) failed", __func__);
+            }
+            file >> tx;
         }
-        file >> tx;
     } catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s", __func__, e.what());
     }
@@ -17,6 +17,9 @@
 #include <checkpoints.h>
 #include <compat/sanity.h>
 #include <consensus/validation.h>
+#include <crypto/pow/Lyra2.h>
+#include <crypto/pow/hashx17.h>
+#include <crypto/pow/scrypt.h>
 #include <fs.h>
 #include <httpserver.h>
 #include <httprpc.h>
@@ -30,6 +33,8 @@
 #include <policy/feerate.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
+#include <primitives/headerhashcache.h>
+#include <rawblockcache.h>
 #include <rpc/server.h>
 #include <rpc/register.h>
 #include <rpc/blockchain.h>
@@ -366,6 +371,7 @@ void SetupServerArgs()
     gArgs.AddArg("-version", "Print version and exit", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-alertnotify=<cmd>", "Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-assumevalid=<hex>", strprintf("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet: %s)", defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex()), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockcompression", strprintf("Store new blocks LZ4 compressed in the block files, which versions without this option can't read (default: %u)", DEFAULT_BLOCK_COMPRESSION), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocksdir=<dir>", "Specify blocks directory (default: <datadir>/blocks)", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocknotify=<cmd>", "Execute command when the best block changes (%s in cmd is replaced by block hash)", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blockreconstructionextratxn=<n>", strprintf("Extra transactions to keep in memory for compact block reconstructions (default: %u)", DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN), false, OptionsCategory::OPTIONS);
@@ -374,6 +380,7 @@ void SetupServerArgs()
     gArgs.AddArg("-datadir=<dir>", "Specify data directory", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize), true, OptionsCategory::OPTIONS);
     gArgs.AddArg("-dbcache=<n>", strprintf("Set database cache size in megabytes (%d to %d, default: %d)", nMinDbCache, nMaxDbCache, nDefaultDbCache), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-headerhashcache=<n>", strprintf("Keep up to <n> MiB each of known block header identity and proof-of-work hashes so headers are not hashed again (0 to %d, default: %d)", MAX_HEADER_HASH_CACHE_SIZE, DEFAULT_HEADER_HASH_CACHE_SIZE), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-debuglogfile=<file>", strprintf("Specify location of debug log file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)", DEFAULT_DEBUGLOGFILE), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-feefilter", strprintf("Tell other nodes to filter invs to us by our mempool min fee (default: %u)", DEFAULT_FEEFILTER), true, OptionsCategory::OPTIONS);
     gArgs.AddArg("-includeconf=<file>", "Specify additional configuration file, relative to the -datadir path (only useable from configuration file, not command line)", false, OptionsCategory::OPTIONS);
@@ -393,6 +400,7 @@ void SetupServerArgs()
     gArgs.AddArg("-prune=<n>", strprintf("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex and -rescan. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >%u = automatically prune block files to stay under the specified target size in MiB)", MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-rawblockcache=<n>", strprintf("Keep up to <n> MiB of recently served blocks in their serialized form, to send them again without reading them from disk (0 to %d, default: %d)", MAX_RAW_BLOCK_CACHE_SIZE, DEFAULT_RAW_BLOCK_CACHE_SIZE), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex", "Rebuild chain state and block index from the blk*.dat files on disk", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex-chainstate", "Rebuild chain state from the currently indexed blocks", false, OptionsCategory::OPTIONS);
 #ifndef WIN32
@@ -1082,6 +1090,10 @@ bool AppInitParameterInteraction()
         fPruneMode = true;
     }
 
+    fBlockCompression = gArgs.GetBoolArg("-blockcompression", DEFAULT_BLOCK_COMPRESSION);
+    if (fBlockCompression)
+        LogPrintf("Block compression enabled, new blocks are stored LZ4 compressed.\n");
+
     nConnectTimeout = gArgs.GetArg("-timeout", DEFAULT_CONNECT_TIMEOUT);
     if (nConnectTimeout <= 0)
         nConnectTimeout = DEFAULT_CONNECT_TIMEOUT;
@@ -1210,6 +1222,9 @@ bool AppInitSanityChecks()
     // Initialize elliptic curve code
     std::string sha256_algo = SHA256AutoDetect();
     LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    LogPrintf("Using the '%s' batch scrypt implementation\n", scrypt_detect_multi());
+    LogPrintf("Using the '%s' Lyra2 sponge\n", LYRA2_detect());
+    LogPrintf("Using the '%s' X17 stages\n", x17_detect());
     RandomInit();
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -1301,10 +1316,20 @@ bool AppInitMain()
     InitSignatureCache();
     InitScriptExecutionCache();
 
+    int64_t nHeaderHashCache = std::max((int64_t)0, std::min(gArgs.GetArg("-headerhashcache", DEFAULT_HEADER_HASH_CACHE_SIZE), MAX_HEADER_HASH_CACHE_SIZE));
+    HeaderHashCache().SetMaxSize(nHeaderHashCache << 20);
+    PoWHashCache().SetMaxSize(nHeaderHashCache << 20);
+    LogPrintf("Using %d MiB for the header hash cache (%u entries)\n", nHeaderHashCache, HeaderHashCache().MaxEntries());
+    int64_t nRawBlockCache = std::max((int64_t)0, std::min(gArgs.GetArg("-rawblockcache", DEFAULT_RAW_BLOCK_CACHE_SIZE), MAX_RAW_BLOCK_CACHE_SIZE));
+    RawBlockCache().SetMaxSize(nRawBlockCache << 20);
+    LogPrintf("Using %d MiB for the raw block cache\n", nRawBlockCache);
+
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
+        for (int i=0; i<nScriptCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadWorkerJobs);
     }
 
     // Start the lightweight task scheduler thread
@@ -1151,14 +1151,15 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
         std::shared_ptr<const CBlock> pblock;
         if (a_recent_block && a_recent_block->GetHash() == pindex->GetBlockHash()) {
             pblock = a_recent_block;
-        } else if (inv.type == MSG_WITNESS_BLOCK) {
+        } else if (inv.type == MSG_BLOCK || inv.type == MSG_WITNESS_BLOCK) {
             // Fast-path: in this case it is possible to serve the block directly from disk,
-            // as the network format matches the format on disk
-            std::vector<uint8_t> block_data;
+            // as the network format matches the format on disk. Transactions carry no
+            // witness data, so that holds with and without witness serialization.
+            std::shared_ptr<const std::vector<uint8_t>> block_data;
             if (!ReadRawBlockFromDisk(block_data, pindex, chainparams.MessageStart())) {
                 assert(!"cannot load block from disk");
             }
-            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, MakeSpan(block_data)));
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, MakeSpan(*block_data)));
             // Don't set pblock as we've sent the block
         } else {
             // Send block from disk
@@ -1367,6 +1368,14 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
             return true;
         }
 
+        // Only a batch that connects to a known header is hashed on the
+        // worker threads. The identity hashes the continuity check below
+        // needs come first; the proof-of-work hashes wait until the batch
+        // is continuous and new.
+        const bool fConnects = LookupBlockIndex(headers[0].hashPrevBlock) != nullptr;
+        if (fConnects)
+            PrecomputeHeaderHashes(headers, false);
+
         uint256 hashLastBlock;
         for (const CBlockHeader& header : headers) {
             if (!hashLastBlock.IsNull() && header.hashPrevBlock != hashLastBlock) {
@@ -1387,6 +1396,9 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
         if(IsInitialBlockDownload() && !received_new_header) {
             return true;
         }
+
+        if (fConnects)
+            PrecomputeHeaderHashes(headers);
     }
 
     CValidationState state;
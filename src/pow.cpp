@@ -274,16 +274,13 @@ unsigned int DarkGravityWave3(const CBlockIndex* pindexLast, int algo, const Con
         return UintToArith256(params.powLimit).GetCompact();
     }
 
+    // we only consider proof-of-work blocks for the configured mining algo here
+    BlockReading = BlockReading->GetLastOfAlgo(algo);
+
     while (BlockReading && BlockReading->nHeight > 0) {
         if (PastBlocksMax > 0 && CountBlocks >= PastBlocksMax)
         	break;
 
-        // we only consider proof-of-work blocks for the configured mining algo here
-        if (BlockReading->GetBlockHeader().GetAlgo() != algo) {
-        	BlockReading = BlockReading->pprev;
-            continue;
-        }
-
         CountBlocks++;
 
 		if (CountBlocks <= PastBlocksMin) {
@@ -302,11 +299,7 @@ unsigned int DarkGravityWave3(const CBlockIndex* pindexLast, int algo, const Con
         }
         LastBlockTime = BlockReading->GetBlockTime();
 
-        if (BlockReading->pprev == NULL) {
-            assert(BlockReading);
-            break;
-        }
-        BlockReading = BlockReading->pprev;
+        BlockReading = BlockReading->pprevSameAlgo;
     }
 
     if (!CountBlocks)
@@ -407,15 +400,17 @@ unsigned int LwmaCalculateNextWorkRequired(const CBlockIndex* pindexLast, int al
     int64_t t = 0, j = 0;
     int64_t solvetime;
 
+    // If there are not enough blocks with this algo above height 100, return with an algo that *can* use less blocks
+    const CBlockIndex* pindexAlgoLast = pindexLast->GetLastOfAlgo(algo);
+    if (pindexAlgoLast == nullptr || pindexAlgoLast->nAlgoHeight < N)
+        return GetNextTargetRequired_V1(pindexLast, algo, params);
+    if (pindexAlgoLast->GetAncestorSameAlgo(pindexAlgoLast->nAlgoHeight - N)->nHeight < 100)
+        return GetNextTargetRequired_V1(pindexLast, algo, params);
+
     std::vector<const CBlockIndex*> SameAlgoBlocks;
-    for (int c = height-1; SameAlgoBlocks.size() < (N + 1); c--){
-        const CBlockIndex* block = pindexLast->GetAncestor(c); // -1 after execution
-        if (block->GetBlockHeader().GetAlgo() == algo){
-            SameAlgoBlocks.push_back(block);
-        }
-        if (c < 100){ // If there are not enough blocks with this algo, return with an algo that *can* use less blocks
-            return GetNextTargetRequired_V1(pindexLast, algo, params);
-        }
+    SameAlgoBlocks.reserve(N + 1);
+    for (const CBlockIndex* block = pindexAlgoLast; SameAlgoBlocks.size() < (N + 1); block = block->pprevSameAlgo) {
+        SameAlgoBlocks.push_back(block);
     }
     // Creates vector with {block1000, block997, block993}, so we start at the back
 
@@ -7,6 +7,7 @@
 #include <primitives/block.h>
 
 #include <hash.h>
+#include <primitives/headerhashcache.h>
 #include <tinyformat.h>
 #include <util/strencodings.h>
 #include <crypto/common.h>
@@ -19,12 +20,29 @@
 
 int ALGO = ALGO_SCRYPT;
 
+/** Scrypt identity hash of a header, served from the header hash cache when possible */
+static uint256 GetScryptHash(const CBlockHeader& header)
+{
+    const uint256 key = header.GetHeaderCacheKey();
+    uint256 thash;
+    if (HeaderHashCache().Lookup(key, thash))
+        return thash;
+    scrypt_1024_1_1_256(BEGIN(header.nVersion), BEGIN(thash));
+    HeaderHashCache().Insert(key, thash);
+    return thash;
+}
+
 uint256 CBlockHeader::GetHash() const
 {
     if(!this->hash.IsNull()){
         return this->hash;
     }
-    return GetPoWHash(ALGO_SCRYPT);
+    return GetScryptHash(*this);
+}
+
+uint256 CBlockHeader::GetHeaderCacheKey() const
+{
+    return Hash(BEGIN(nVersion), END(nNonce));
 }
 
 uint256 CBlockHeader::GetSerializedHash() const 
@@ -48,8 +66,9 @@ uint256 CBlockHeader::GetPoWHash(int algo) const
 	    break;
         case ALGO_SCRYPT:
         default:
-            scrypt_1024_1_1_256(BEGIN(nVersion), BEGIN(thash));
-
+            // The scrypt PoW hash is the identity hash, so share its cache
+            // entry. Keyed on the header contents, never on this->hash.
+            return GetScryptHash(*this);
     }
     return thash;
 }
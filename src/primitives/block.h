@@ -100,6 +100,9 @@ public:
     uint32_t nBits;
     uint32_t nNonce;
 
+    // memory only: identity hash supplied by a trusted source (the block
+    // index). Deserialization leaves it null; GetHash() then goes through
+    // the header hash cache instead of running scrypt eagerly.
     uint256 hash;
 
     CBlockHeader()
@@ -118,8 +121,8 @@ public:
         READWRITE(nTime);
         READWRITE(nBits);
         READWRITE(nNonce);
-        if(ser_action.ForRead()){
-            this->hash = GetPoWHash(ALGO_SCRYPT);
+        if (ser_action.ForRead()) {
+            this->hash.SetNull();
         }
     }
 
@@ -143,6 +146,9 @@ public:
     uint256 GetSerializedHash() const;
     uint256 GetPoWHash(int algo) const;
 
+    //! SHA256d of the raw 80-byte header, the key of the header hash cache
+    uint256 GetHeaderCacheKey() const;
+
     int GetAlgo() const
     {
         switch (nVersion & BLOCK_VERSION_ALGO)
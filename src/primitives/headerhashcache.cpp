@@ -0,0 +1,93 @@
+// Copyright (c) 2018-2020 The Verge Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <primitives/headerhashcache.h>
+
+#include <crypto/siphash.h>
+
+#include <random>
+
+CHeaderHashCache::SaltedKeyHasher::SaltedKeyHasher()
+{
+    // This library is also linked into libvergeconsensus, which has no access
+    // to the node's RNG; the salt only needs to be unpredictable to peers.
+    std::random_device rd;
+    k0 = ((uint64_t)rd() << 32) | rd();
+    k1 = ((uint64_t)rd() << 32) | rd();
+}
+
+size_t CHeaderHashCache::SaltedKeyHasher::operator()(const uint256& key) const
+{
+    return SipHashUint256(k0, k1, key);
+}
+
+CHeaderHashCache::CHeaderHashCache(size_t nMaxBytes)
+{
+    SetMaxSize(nMaxBytes);
+}
+
+void CHeaderHashCache::SetMaxSize(size_t nMaxBytes)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    nMaxEntries = nMaxBytes / ENTRY_BYTES;
+    while (queue.size() > nMaxEntries) {
+        map.erase(queue.front());
+        queue.pop_front();
+    }
+}
+
+size_t CHeaderHashCache::MaxEntries() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return nMaxEntries;
+}
+
+size_t CHeaderHashCache::Size() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return map.size();
+}
+
+void CHeaderHashCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(cs);
+    map.clear();
+    queue.clear();
+}
+
+bool CHeaderHashCache::Lookup(const uint256& key, uint256& hashOut) const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    auto it = map.find(key);
+    if (it == map.end())
+        return false;
+    hashOut = it->second;
+    return true;
+}
+
+void CHeaderHashCache::Insert(const uint256& key, const uint256& hash)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    if (nMaxEntries == 0)
+        return;
+    if (!map.emplace(key, hash).second)
+        return;
+    queue.push_back(key);
+    if (queue.size() > nMaxEntries) {
+        map.erase(queue.front());
+        queue.pop_front();
+    }
+}
+
+CHeaderHashCache& HeaderHashCache()
+{
+    static CHeaderHashCache cache;
+    return cache;
+}
+
+CHeaderHashCache& PoWHashCache()
+{
+    static CHeaderHashCache cache;
+    return cache;
+}
@@ -0,0 +1,77 @@
+// Copyright (c) 2018-2020 The Verge Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef VERGE_PRIMITIVES_HEADERHASHCACHE_H
+#define VERGE_PRIMITIVES_HEADERHASHCACHE_H
+
+#include <uint256.h>
+
+#include <deque>
+#include <mutex>
+#include <stdint.h>
+#include <unordered_map>
+
+//! Default for -headerhashcache, in MiB
+static const int64_t DEFAULT_HEADER_HASH_CACHE_SIZE = 32;
+//! Maximum -headerhashcache, in MiB
+static const int64_t MAX_HEADER_HASH_CACHE_SIZE = 4096;
+
+/**
+ * Maps the SHA256d of a raw 80-byte block header to a hash of that header:
+ * its scrypt identity hash, or for PoWHashCache() the proof-of-work hash of
+ * the header's own algorithm.
+ *
+ * Computing the identity hash of a header costs a full scrypt-1024, while the
+ * key costs two SHA256 compressions. Only hashes that were computed locally or
+ * that come from the (proof-of-work checked) block index are ever inserted, and
+ * lookups compare the whole 256-bit key, so a hit is as good as recomputing.
+ * The oldest entries are evicted first once the size limit is reached.
+ */
+class CHeaderHashCache
+{
+private:
+    /** Salted so that peers cannot grind headers into a single bucket. */
+    class SaltedKeyHasher
+    {
+    private:
+        uint64_t k0, k1;
+
+    public:
+        SaltedKeyHasher();
+        size_t operator()(const uint256& key) const;
+    };
+
+    mutable std::mutex cs;
+    std::unordered_map<uint256, uint256, SaltedKeyHasher> map;
+    std::deque<uint256> queue;
+    size_t nMaxEntries;
+
+public:
+    //! Approximate memory used by one entry: map node, bucket and eviction queue slot
+    static const size_t ENTRY_BYTES = 128;
+
+    explicit CHeaderHashCache(size_t nMaxBytes = DEFAULT_HEADER_HASH_CACHE_SIZE << 20);
+
+    /** Resize the cache, evicting the oldest entries if it shrinks. */
+    void SetMaxSize(size_t nMaxBytes);
+    size_t MaxEntries() const;
+    size_t Size() const;
+    void Clear();
+
+    bool Lookup(const uint256& key, uint256& hashOut) const;
+    void Insert(const uint256& key, const uint256& hash);
+};
+
+/** The process-wide header hash cache used by CBlockHeader::GetHash(). */
+CHeaderHashCache& HeaderHashCache();
+
+/**
+ * Proof-of-work hashes of non-scrypt headers, filled ahead of validation by
+ * PrecomputeHeaderHashes() and consulted when validation checks their proof
+ * of work. CBlockHeader::GetPoWHash() always hashes: mining loops call it for
+ * every nonce.
+ */
+CHeaderHashCache& PoWHashCache();
+
+#endif // VERGE_PRIMITIVES_HEADERHASHCACHE_H
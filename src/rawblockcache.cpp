@@ -0,0 +1,88 @@
+// Copyright (c) 2018-2020 The Verge Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <rawblockcache.h>
+
+#include <crypto/siphash.h>
+#include <random.h>
+
+#include <limits>
+
+CRawBlockCache::SaltedKeyHasher::SaltedKeyHasher() :
+    k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max()))
+{
+}
+
+size_t CRawBlockCache::SaltedKeyHasher::operator()(const uint256& key) const
+{
+    return SipHashUint256(k0, k1, key);
+}
+
+CRawBlockCache::CRawBlockCache(size_t nMaxBytesIn) : nBytes(0), nMaxBytes(nMaxBytesIn)
+{
+}
+
+void CRawBlockCache::Trim()
+{
+    while (nBytes > nMaxBytes) {
+        nBytes -= entries.back().second->size();
+        map.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
+
+void CRawBlockCache::SetMaxSize(size_t nMaxBytesIn)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    nMaxBytes = nMaxBytesIn;
+    Trim();
+}
+
+size_t CRawBlockCache::MaxSize() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return nMaxBytes;
+}
+
+size_t CRawBlockCache::Size() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return nBytes;
+}
+
+void CRawBlockCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(cs);
+    map.clear();
+    entries.clear();
+    nBytes = 0;
+}
+
+bool CRawBlockCache::Lookup(const uint256& hash, RawBlock& block)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    auto it = map.find(hash);
+    if (it == map.end())
+        return false;
+    entries.splice(entries.begin(), entries, it->second);
+    block = it->second->second;
+    return true;
+}
+
+void CRawBlockCache::Insert(const uint256& hash, const RawBlock& block)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    if (block->size() > nMaxBytes || map.count(hash))
+        return;
+    entries.emplace_front(hash, block);
+    map.emplace(hash, entries.begin());
+    nBytes += block->size();
+    Trim();
+}
+
+CRawBlockCache& RawBlockCache()
+{
+    static CRawBlockCache cache;
+    return cache;
+}
@@ -0,0 +1,77 @@
+// Copyright (c) 2018-2020 The Verge Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef VERGE_RAWBLOCKCACHE_H
+#define VERGE_RAWBLOCKCACHE_H
+
+#include <uint256.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//! Default for -rawblockcache, in MiB
+static const int64_t DEFAULT_RAW_BLOCK_CACHE_SIZE = 16;
+//! Maximum -rawblockcache, in MiB
+static const int64_t MAX_RAW_BLOCK_CACHE_SIZE = 1024;
+
+/**
+ * Serialized blocks by block hash, as last read from the block files.
+ *
+ * Blocks are stored on disk in their network serialization, so a block
+ * syncing peers keep asking for can be sent again from here without
+ * reading, decoding and re-encoding it. The bytes of a block never change
+ * once its hash is known, so entries are only dropped to stay within the
+ * size limit, least recently used first.
+ */
+class CRawBlockCache
+{
+public:
+    typedef std::shared_ptr<const std::vector<uint8_t>> RawBlock;
+
+private:
+    /** Salted so that the buckets do not depend on block hashes alone. */
+    class SaltedKeyHasher
+    {
+    private:
+        uint64_t k0, k1;
+
+    public:
+        SaltedKeyHasher();
+        size_t operator()(const uint256& key) const;
+    };
+
+    typedef std::list<std::pair<uint256, RawBlock>> EntryList;
+
+    mutable std::mutex cs;
+    //! Most recently used first
+    EntryList entries;
+    std::unordered_map<uint256, EntryList::iterator, SaltedKeyHasher> map;
+    size_t nBytes;
+    size_t nMaxBytes;
+
+    void Trim();
+
+public:
+    explicit CRawBlockCache(size_t nMaxBytesIn = DEFAULT_RAW_BLOCK_CACHE_SIZE << 20);
+
+    /** Resize the cache, evicting the least recently used blocks if it shrinks. */
+    void SetMaxSize(size_t nMaxBytesIn);
+    size_t MaxSize() const;
+    //! Bytes of block data held
+    size_t Size() const;
+    void Clear();
+
+    bool Lookup(const uint256& hash, RawBlock& block);
+    void Insert(const uint256& hash, const RawBlock& block);
+};
+
+/** The process-wide cache used by ReadRawBlockFromDisk(). */
+CRawBlockCache& RawBlockCache();
+
+#endif // VERGE_RAWBLOCKCACHE_H
@@ -3,65 +3,146 @@
 // file license.txt or http://www.opensource.org/licenses/mit-license.php.
 
 #include <ringsig.h>
-#include <base58.h>
-#include <key.h>
-#include <main.h>
-#include <chainparams.h>
 
-#include <openssl/err.h>
-#include <openssl/rand.h>
-#include <openssl/ec.h>
-#include <openssl/bn.h>
-#include <openssl/ecdsa.h>
-#include <openssl/obj_mac.h>
+#include <amount.h>
+#include <arith_uint256.h>
+#include <hash.h>
+#include <pubkey.h>
+#include <random.h>
+#include <version.h>
 
+#include <secp256k1.h>
 
-static EC_GROUP *ecGrp   = NULL;
-static BN_CTX   *bnCtx   = NULL;
-static BIGNUM   *bnOrder = NULL;
+#include <array>
+#include <assert.h>
+#include <map>
+#include <memory>
 
+// Scalars are 32 byte big-endian numbers taken modulo the group order n,
+// points are handled as secp256k1_pubkey and hashed in compressed form.
 
-int initialiseRingSigs()
-{
-    int rv = 0;
-
-    if (fDebugRingSig)
-        LogPrintf("initialiseRingSigs()\n");
+static const arith_uint256 ORDER = UintToArith256(uint256S("fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364141"));
 
-    if (!(ecGrp = EC_GROUP_new_by_curve_name(NID_secp256k1)))
-        return errorN(1, "initialiseRingSigs(): EC_GROUP_new_by_curve_name failed.");
+/** Context for the ring signature arithmetic, built on first use */
+static secp256k1_context* RingSigContext()
+{
+    static std::unique_ptr<secp256k1_context, void(*)(secp256k1_context*)> ctx(
+        []() {
+            secp256k1_context* ctx = secp256k1_context_create(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+            // Blind the generator multiplications of this context
+            unsigned char vseed[32];
+            GetRandBytes(vseed, sizeof(vseed));
+            if (!secp256k1_context_randomize(ctx, vseed))
+                LogPrintf("RingSigContext(): secp256k1_context_randomize failed.\n");
+            return ctx;
+        }(),
+        secp256k1_context_destroy);
+    return ctx.get();
+}
 
-    if (!(bnCtx = BN_CTX_new()))
-        return errorN(1, "initialiseRingSigs(): BN_CTX_new failed.");
+int initialiseRingSigs()
+{
+    return RingSigContext() ? 0 : 1;
+}
 
-    BN_CTX_start(bnCtx);
+int finaliseRingSigs()
+{
+    // The context lives until exit
+    return 0;
+}
 
-    // get order and cofactor
-    bnOrder = BN_new();
-    if (!EC_GROUP_get_order(ecGrp, bnOrder, bnCtx))
-        return errorN(1, "initialiseRingSigs(): EC_GROUP_get_order failed.");
+static arith_uint256 ScalarGet(const uint8_t *p)
+{
+    uint256 v;
+    for (size_t i = 0; i < ec_secret_size; ++i)
+        *(v.begin() + i) = p[ec_secret_size - 1 - i];
+    arith_uint256 n = UintToArith256(v);
+    // Anything below 2^256 is below 2n
+    return n >= ORDER ? n - ORDER : n;
+}
 
-    BN_CTX_end(bnCtx);
+static void ScalarSet(uint8_t *p, const arith_uint256 &n)
+{
+    uint256 v = ArithToUint256(n);
+    for (size_t i = 0; i < ec_secret_size; ++i)
+        p[i] = *(v.begin() + ec_secret_size - 1 - i);
+}
 
-    return rv;
+static arith_uint256 ScalarAdd(const arith_uint256 &a, const arith_uint256 &b)
+{
+    arith_uint256 r = a + b;
+    if (r < a || r >= ORDER)
+        r -= ORDER;
+    return r;
 }
 
-int finaliseRingSigs()
+static arith_uint256 ScalarSub(const arith_uint256 &a, const arith_uint256 &b)
 {
-    if (fDebugRingSig)
-        LogPrintf("finaliseRingSigs()\n");
+    arith_uint256 r = a - b;
+    if (a < b)
+        r += ORDER;
+    return r;
+}
 
-    BN_free(bnOrder);
-    BN_CTX_free(bnCtx);
-    EC_GROUP_clear_free(ecGrp);
+static int ScalarMul(const arith_uint256 &a, const arith_uint256 &b, arith_uint256 &r)
+{
+    if (a == 0 || b == 0) {
+        r = 0;
+        return 0;
+    }
+    uint8_t ba[ec_secret_size], bb[ec_secret_size];
+    ScalarSet(ba, a);
+    ScalarSet(bb, b);
+    if (!secp256k1_ec_privkey_tweak_mul(RingSigContext(), ba, bb))
+        return 1;
+    r = ScalarGet(ba);
+    return 0;
+}
 
-    ecGrp   = NULL;
-    bnCtx   = NULL;
-    bnOrder = NULL;
+/** r = s * P, or s * G when P is null */
+static bool PointMul(const secp256k1_pubkey *P, const arith_uint256 &s, secp256k1_pubkey &r)
+{
+    uint8_t b[ec_secret_size];
+    ScalarSet(b, s);
+    if (!P)
+        return secp256k1_ec_pubkey_create(RingSigContext(), &r, b);
+    r = *P;
+    return secp256k1_ec_pubkey_tweak_mul(RingSigContext(), &r, b);
+}
 
+/** Compressed a * A + b * B, where a null point stands for G. Fails if the sum is infinity. */
+static int PointMulAdd(const secp256k1_pubkey *A, const arith_uint256 &a, const secp256k1_pubkey *B, const arith_uint256 &b, uint8_t *pOut)
+{
+    secp256k1_pubkey terms[2];
+    const secp256k1_pubkey *pTerms[2];
+    size_t nTerms = 0;
+    if (a != 0) {
+        if (!PointMul(A, a, terms[nTerms]))
+            return 1;
+        pTerms[nTerms] = &terms[nTerms];
+        nTerms++;
+    }
+    if (b != 0) {
+        if (!PointMul(B, b, terms[nTerms]))
+            return 1;
+        pTerms[nTerms] = &terms[nTerms];
+        nTerms++;
+    }
+
+    secp256k1_pubkey sum;
+    size_t nOut = ec_compressed_size;
+    if (nTerms == 0
+        || !secp256k1_ec_pubkey_combine(RingSigContext(), &sum, pTerms, nTerms)
+        || !secp256k1_ec_pubkey_serialize(RingSigContext(), pOut, &nOut, &sum, SECP256K1_EC_COMPRESSED))
+        return 1;
     return 0;
 }
 
+static int PointParse(const uint8_t *p, size_t len, secp256k1_pubkey &r)
+{
+    return secp256k1_ec_pubkey_parse(RingSigContext(), &r, p, len) ? 0 : 1;
+}
+
 
 int splitAmount(int64_t nValue, std::vector<int64_t>& vOut)
 {
@@ -112,166 +193,109 @@ int splitAmount(int64_t nValue, std::vector<int64_t>& vOut)
     return 0;
 }
 
-
 int getOldKeyImage(CPubKey &publicKey, ec_point &keyImage)
 {
     // - PublicKey * Hash(PublicKey)
-    if (publicKey.size() != EC_COMPRESSED_SIZE)
-        return errorN(1, "%s: Invalid publicKey.", __func__);
+    if (publicKey.size() != ec_compressed_size)
+    {
+        LogPrintf("%s: Invalid publicKey.\n", __func__);
+        return 1;
+    }
 
-    int rv = 0;
+    secp256k1_pubkey ptPk;
+    if (PointParse(publicKey.begin(), publicKey.size(), ptPk) != 0)
+    {
+        LogPrintf("%s: parse publicKey failed.\n", __func__);
+        return 1;
+    }
 
     uint256 pkHash = publicKey.GetHash();
-
-    BN_CTX_start(bnCtx);
-    BIGNUM *bnTmp = BN_CTX_get(bnCtx);
-    EC_POINT *ptPk = NULL;
-
-    // Hash to BIGNUM
-    if (!BN_bin2bn(pkHash.begin(), EC_SECRET_SIZE, bnTmp)
-    && (rv = errorN(1, "%s: BN_bin2bn failed.", __func__)))
-        goto End;
-
-    // PublicKey point
-    if (!(ptPk = EC_POINT_new(ecGrp))
-    && (rv = errorN(1, "%s: EC_POINT_new failed.", __func__)))
-        goto End;
-
-    if (!EC_POINT_oct2point(ecGrp, ptPk, publicKey.begin(), EC_COMPRESSED_SIZE, bnCtx)
-    && (rv = errorN(1, "%s: EC_POINT_oct2point failed.", __func__)))
-        goto End;
-
-    // PublicKey * Hash(PublicKey)
-    if (!EC_POINT_mul(ecGrp, ptPk, NULL, ptPk, bnTmp, bnCtx)
-    && (rv = errorN(1, "%s: EC_POINT_mul failed.", __func__)))
-        goto End;
-
-    try { keyImage.resize(EC_COMPRESSED_SIZE); } catch (std::exception& e)
+    keyImage.resize(ec_compressed_size);
+    if (PointMulAdd(&ptPk, ScalarGet(pkHash.begin()), nullptr, 0, &keyImage[0]) != 0)
     {
-        LogPrintf("%s: keyImage.resize threw: %s.\n", __func__, e.what());
-        rv = 1; goto End;
+        LogPrintf("%s: point -> keyImage failed.\n", __func__);
+        return 1;
     }
 
-    // Point to BIGNUM to bin
-    if (!(EC_POINT_point2bn(ecGrp, ptPk, POINT_CONVERSION_COMPRESSED, bnTmp, bnCtx))
-     ||BN_num_bytes(bnTmp) != (int) EC_COMPRESSED_SIZE
-     ||BN_bn2bin(bnTmp, &keyImage[0]) != (int) EC_COMPRESSED_SIZE)
-        rv = errorN(1, "%s: point -> keyImage failed.", __func__);
-
-    End:
-    EC_POINT_free(ptPk);
-    BN_CTX_end(bnCtx);
-
     return 0;
 }
 
-static int hashToEC(const uint8_t *p, uint32_t len, BIGNUM *bnTmp, EC_POINT *ptRet, bool fNew=false)
+/** Hp(P): the hash of p taken as an x coordinate, counted up to the first point on the curve */
+static int hashToEC(const uint8_t *p, uint32_t len, secp256k1_pubkey &ptRet)
 {
-    // - bn(hash(data)) * (G + bn1)
-    int count = 0;
     uint256 pkHash = Hash(p, p + len);
-    BIGNUM *bnOne = BN_CTX_get(bnCtx);
-    BN_one(bnOne);
-
-    if (!bnTmp || !BN_bin2bn(pkHash.begin(), EC_SECRET_SIZE, bnTmp))
-        return errorN(1, "%s: BN_bin2bn failed.", __func__);
 
-    if (fNew || Params().IsProtocolV3(nBestHeight))
-        while(!EC_POINT_set_compressed_coordinates_GFp(ecGrp, ptRet, bnTmp, 0, bnCtx) && count < 100)
-        {
-            count += 1;
+    uint8_t point[ec_compressed_size];
+    point[0] = 0x02; // even y
+    memcpy(&point[1], pkHash.begin(), ec_secret_size);
 
-            if (count == 100)
-                return errorN(1, "%s: Failed to find a valid point for public key.", __func__);
+    for (int count = 0; count < 100; ++count)
+    {
+        if (PointParse(point, sizeof(point), ptRet) == 0)
+            return 0;
 
-            BN_add(bnTmp, bnTmp, bnOne);
-        }
-    else
-        if (!EC_POINT_mul(ecGrp, ptRet, bnTmp, NULL, NULL, bnCtx))
-            return errorN(1, "%s: EC_POINT_mul failed.", __func__);
+        for (size_t i = ec_secret_size; i > 0 && ++point[i] == 0; --i) {}
+    }
 
-    return 0;
+    LogPrintf("%s: Failed to find a valid point for public key.\n", __func__);
+    return 1;
 }
 
-
 int generateKeyImage(ec_point &publicKey, ec_secret secret, ec_point &keyImage)
 {
     // - keyImage = secret * hash(publicKey) * G
 
-    if (publicKey.size() != EC_COMPRESSED_SIZE)
-        return errorN(1, "%s: Invalid publicKey.", __func__);
-
-    BN_CTX_start(bnCtx);
-    int rv = 0;
-    BIGNUM *bnTmp = BN_CTX_get(bnCtx);
-    BIGNUM *bnSec = BN_CTX_get(bnCtx);
-    EC_POINT *hG  = NULL;
-
-    if (!(hG = EC_POINT_new(ecGrp))
-    && (rv = errorN(1, "%s: EC_POINT_new failed.", __func__)))
-        goto End;
-
-    if (hashToEC(&publicKey[0], publicKey.size(), bnTmp, hG, true)
-    && (rv = errorN(1, "%s: hashToEC failed.", __func__)))
-        goto End;
-
-    if (!(BN_bin2bn(&secret.e[0], EC_SECRET_SIZE, bnSec))
-    && (rv = errorN(1, "%s: BN_bin2bn failed.", __func__)))
-        goto End;
+    if (publicKey.size() != ec_compressed_size)
+    {
+        LogPrintf("%s: Invalid publicKey.\n", __func__);
+        return 1;
+    }
 
-    if (!EC_POINT_mul(ecGrp, hG, NULL, hG, bnSec, bnCtx)
-    && (rv = errorN(1, "%s: kimg EC_POINT_mul failed.", __func__)))
-        goto End;
+    secp256k1_pubkey hG;
+    if (hashToEC(&publicKey[0], publicKey.size(), hG) != 0)
+    {
+        LogPrintf("%s: hashToEC failed.\n", __func__);
+        return 1;
+    }
 
-    try { keyImage.resize(EC_COMPRESSED_SIZE); } catch (std::exception& e)
+    keyImage.resize(ec_compressed_size);
+    if (PointMulAdd(&hG, ScalarGet(&secret.e[0]), nullptr, 0, &keyImage[0]) != 0)
     {
-        LogPrintf("%s: keyImage.resize threw: %s.\n", __func__, e.what());
-        rv = 1; goto End;
+        LogPrintf("%s: point -> keyImage failed.\n", __func__);
+        return 1;
     }
 
-    if ((!(EC_POINT_point2bn(ecGrp, hG, POINT_CONVERSION_COMPRESSED, bnTmp, bnCtx))
-        || BN_num_bytes(bnTmp) != (int) EC_COMPRESSED_SIZE
-        || BN_bn2bin(bnTmp, &keyImage[0]) != (int) EC_COMPRESSED_SIZE)
-    && (rv = errorN(1, "%s: point -> keyImage failed.", __func__)))
-        goto End;
+    return 0;
+}
+
+/** A public key of a ring, parsed and hashed to the curve */
+struct CRingMember
+{
+    bool fValid;
+    secp256k1_pubkey pk;
+    secp256k1_pubkey hp;
+};
 
-    if (fDebugRingSig)
-        LogPrintf("keyImage %s\n", HexStr(keyImage).c_str());
+typedef std::map<std::array<uint8_t, 33>, CRingMember> RingMemberMap;
 
-    End:
-    EC_POINT_free(hG);
-    BN_CTX_end(bnCtx);
+static const CRingMember* GetRingMember(RingMemberMap &mapMembers, const uint8_t *pPubkey)
+{
+    std::array<uint8_t, 33> key;
+    memcpy(key.data(), pPubkey, ec_compressed_size);
 
-    return rv;
+    std::pair<RingMemberMap::iterator, bool> ret = mapMembers.insert(std::make_pair(key, CRingMember()));
+    CRingMember &member = ret.first->second;
+    if (ret.second)
+    {
+        member.fValid = PointParse(pPubkey, ec_compressed_size, member.pk) == 0
+            && hashToEC(pPubkey, ec_compressed_size, member.hp) == 0;
+    }
+    return member.fValid ? &member : nullptr;
 }
 
-
 int generateRingSignature(data_chunk &keyImage, uint256 &txnHash, int nRingSize, int nSecretOffset, ec_secret secret, const uint8_t *pPubkeys, uint8_t *pSigc, uint8_t *pSigr)
 {
-    if (fDebugRingSig)
-        LogPrintf("%s: Ring size %d.\n", __func__, nRingSize);
-
-    int rv = 0;
-    int nBytes;
-
-    BN_CTX_start(bnCtx);
-
-    BIGNUM   *bnKS  = BN_CTX_get(bnCtx);
-    BIGNUM   *bnK1  = BN_CTX_get(bnCtx);
-    BIGNUM   *bnK2  = BN_CTX_get(bnCtx);
-    BIGNUM   *bnT   = BN_CTX_get(bnCtx);
-    BIGNUM   *bnH   = BN_CTX_get(bnCtx);
-    BIGNUM   *bnSum = BN_CTX_get(bnCtx);
-    EC_POINT *ptT1  = NULL;
-    EC_POINT *ptT2  = NULL;
-    EC_POINT *ptT3  = NULL;
-    EC_POINT *ptPk  = NULL;
-    EC_POINT *ptKi  = NULL;
-    EC_POINT *ptL   = NULL;
-    EC_POINT *ptR   = NULL;
-
     uint8_t tempData[66]; // hold raw point data to hash
-    uint256 commitHash;
     ec_secret scData1, scData2;
 
     CHashWriter ssCommitHash(SER_GETHASH, PROTOCOL_VERSION);
@@ -279,71 +303,48 @@ int generateRingSignature(data_chunk &keyImage, uint256 &txnHash, int nRingSize,
     ssCommitHash << txnHash;
 
     // zero signature
-    memset(pSigc, 0, EC_SECRET_SIZE * nRingSize);
-    memset(pSigr, 0, EC_SECRET_SIZE * nRingSize);
-
+    memset(pSigc, 0, ec_secret_size * nRingSize);
+    memset(pSigr, 0, ec_secret_size * nRingSize);
 
     // ks = random 256 bit int mod P
-    if (GenerateRandomSecret(scData1)
-    && (rv = errorN(1, "%s: GenerateRandomSecret failed.", __func__)))
-        goto End;
-
-    if (!bnKS || !(BN_bin2bn(&scData1.e[0], EC_SECRET_SIZE, bnKS)))
-    {
-        LogPrintf("%s: BN_bin2bn failed.\n", __func__);
-        rv = 1; goto End;
-    }
-
-    // zero sum
-    if (!bnSum || !(BN_zero(bnSum)))
+    if (GenerateRandomSecret(scData1) != 0)
     {
-        LogPrintf("%s: BN_zero failed.\n", __func__);
-        rv = 1; goto End;
+        LogPrintf("%s: GenerateRandomSecret failed.\n", __func__);
+        return 1;
     }
+    arith_uint256 ks = ScalarGet(&scData1.e[0]);
 
-    if (   !(ptT1 = EC_POINT_new(ecGrp))
-        || !(ptT2 = EC_POINT_new(ecGrp))
-        || !(ptT3 = EC_POINT_new(ecGrp))
-        || !(ptPk = EC_POINT_new(ecGrp))
-        || !(ptKi = EC_POINT_new(ecGrp))
-        || !(ptL  = EC_POINT_new(ecGrp))
-        || !(ptR  = EC_POINT_new(ecGrp)))
+    // get keyimage as point
+    secp256k1_pubkey ptKi;
+    if (keyImage.size() != ec_compressed_size || PointParse(&keyImage[0], keyImage.size(), ptKi) != 0)
     {
-        LogPrintf("%s: EC_POINT_new failed.\n", __func__);
-        rv = 1; goto End;
+        LogPrintf("%s: extract ptKi failed.\n", __func__);
+        return 1;
     }
 
-    // get keyimage as point
-    if (!EC_POINT_oct2point(ecGrp, ptKi, &keyImage[0], EC_COMPRESSED_SIZE, bnCtx)
-      &&(rv = errorN(1, "%s: extract ptKi failed.", __func__)))
-        goto End;
-
+    arith_uint256 sum = 0;
+    RingMemberMap mapMembers;
     for (int i = 0; i < nRingSize; ++i)
     {
+        const CRingMember *member = GetRingMember(mapMembers, &pPubkeys[i * ec_compressed_size]);
+        if (!member)
+        {
+            LogPrintf("%s: extract ptPk failed.\n", __func__);
+            return 1;
+        }
+
         if (i == nSecretOffset)
         {
             // k = random 256 bit int mod P
             // L = k * G
             // R = k * HashToEC(PKi)
 
-            if (!EC_POINT_mul(ecGrp, ptL, bnKS, NULL, NULL, bnCtx))
-            {
-                LogPrintf("%s: EC_POINT_mul failed.\n", __func__);
-                rv = 1; goto End;
-            }
-
-            if (hashToEC(&pPubkeys[i * EC_COMPRESSED_SIZE], EC_COMPRESSED_SIZE, bnT, ptT1) != 0)
+            if (PointMulAdd(nullptr, ks, nullptr, 0, &tempData[0]) != 0
+                || PointMulAdd(&member->hp, ks, nullptr, 0, &tempData[33]) != 0)
             {
-                LogPrintf("%s: hashToEC failed.\n", __func__);
-                rv = 1; goto End;
+                LogPrintf("%s: extract ptL and ptR failed.\n", __func__);
+                return 1;
             }
-
-            if (!EC_POINT_mul(ecGrp, ptR, NULL, ptT1, bnKS, bnCtx))
-            {
-                LogPrintf("%s: EC_POINT_mul failed.\n", __func__);
-                rv = 1; goto End;
-            }
-
         } else
         {
             // k1 = random 256 bit int mod P
@@ -354,477 +355,183 @@ int generateRingSignature(data_chunk &keyImage, uint256 &txnHash, int nRingSize,
             // ri = k2
 
             if (GenerateRandomSecret(scData1) != 0
-                || !bnK1 || !(BN_bin2bn(&scData1.e[0], EC_SECRET_SIZE, bnK1))
-                || GenerateRandomSecret(scData2) != 0
-                || !bnK2 || !(BN_bin2bn(&scData2.e[0], EC_SECRET_SIZE, bnK2)))
+                || GenerateRandomSecret(scData2) != 0)
             {
                 LogPrintf("%s: k1 and k2 failed.\n", __func__);
-                rv = 1; goto End;
-            }
-
-            // get Pk i as point
-            if (!(bnT = BN_bin2bn(&pPubkeys[i * EC_COMPRESSED_SIZE], EC_COMPRESSED_SIZE, bnT))
-                || !(ptPk) || !(ptPk = EC_POINT_bn2point(ecGrp, bnT, ptPk, bnCtx)))
-            {
-                LogPrintf("%s: extract ptPk failed.\n", __func__);
-                rv = 1; goto End;
-            }
-
-            // ptT1 = k1 * Pi
-            if (!EC_POINT_mul(ecGrp, ptT1, NULL, ptPk, bnK1, bnCtx))
-            {
-                LogPrintf("%s: EC_POINT_mul failed.\n", __func__);
-                rv = 1; goto End;
-            }
-
-            // ptT2 = k2 * G
-            if (!EC_POINT_mul(ecGrp, ptT2, bnK2, NULL, NULL, bnCtx))
-            {
-                LogPrintf("%s: EC_POINT_mul failed.\n", __func__);
-                rv = 1; goto End;
-            }
-
-            // ptL = ptT1 + ptT2
-            if (!EC_POINT_add(ecGrp, ptL, ptT1, ptT2, bnCtx))
-            {
-                LogPrintf("%s: EC_POINT_add failed.\n", __func__);
-                rv = 1; goto End;
-            }
-
-            // ptT3 = Hp(Pi)
-            if (hashToEC(&pPubkeys[i * EC_COMPRESSED_SIZE], EC_COMPRESSED_SIZE, bnT, ptT3) != 0)
-            {
-                LogPrintf("%s: hashToEC failed.\n", __func__);
-                rv = 1; goto End;
+                return 1;
             }
+            arith_uint256 k1 = ScalarGet(&scData1.e[0]);
+            arith_uint256 k2 = ScalarGet(&scData2.e[0]);
 
-            // ptT1 = k1 * I
-            if (!EC_POINT_mul(ecGrp, ptT1, NULL, ptKi, bnK1, bnCtx))
+            if (PointMulAdd(&member->pk, k1, nullptr, k2, &tempData[0]) != 0
+                || PointMulAdd(&ptKi, k1, &member->hp, k2, &tempData[33]) != 0)
             {
-                LogPrintf("%s: EC_POINT_mul failed.\n", __func__);
-                rv = 1; goto End;
+                LogPrintf("%s: extract ptL and ptR failed.\n", __func__);
+                return 1;
             }
 
-            // ptT2 = k2 * ptT3
-            if (!EC_POINT_mul(ecGrp, ptT2, NULL, ptT3, bnK2, bnCtx))
-            {
-                LogPrintf("%s: EC_POINT_mul failed.\n", __func__);
-                rv = 1; goto End;
-            }
-
-            // ptR = ptT1 + ptT2
-            if (!EC_POINT_add(ecGrp, ptR, ptT1, ptT2, bnCtx))
-            {
-                LogPrintf("%s: EC_POINT_add failed.\n", __func__);
-                rv = 1; goto End;
-            }
+            memcpy(&pSigc[i * ec_secret_size], &scData1.e[0], ec_secret_size);
+            memcpy(&pSigr[i * ec_secret_size], &scData2.e[0], ec_secret_size);
 
-            memcpy(&pSigc[i * EC_SECRET_SIZE], &scData1.e[0], EC_SECRET_SIZE);
-            memcpy(&pSigr[i * EC_SECRET_SIZE], &scData2.e[0], EC_SECRET_SIZE);
-
-            // sum = (sum + sigc) % N , sigc == bnK1
-            if (!BN_mod_add(bnSum, bnSum, bnK1, bnOrder, bnCtx))
-            {
-                LogPrintf("%s: BN_mod_add failed.\n", __func__);
-                rv = 1; goto End;
-            }
+            // sum = (sum + sigc) % N , sigc == k1
+            sum = ScalarAdd(sum, k1);
         }
 
         // -- add ptL and ptR to hash
-        if (   !(EC_POINT_point2oct(ecGrp, ptL, POINT_CONVERSION_COMPRESSED, &tempData[0],  33, bnCtx) == (int) EC_COMPRESSED_SIZE)
-            || !(EC_POINT_point2oct(ecGrp, ptR, POINT_CONVERSION_COMPRESSED, &tempData[33], 33, bnCtx) == (int) EC_COMPRESSED_SIZE))
-        {
-            LogPrintf("%s: extract ptL and ptR failed.\n", __func__);
-            rv = 1; goto End;
-        }
-
         ssCommitHash.write((const char*)&tempData[0], 66);
     }
 
-    commitHash = ssCommitHash.GetHash();
-
-    if (!(bnH) || !(bnH = BN_bin2bn(commitHash.begin(), EC_SECRET_SIZE, bnH)))
-    {
-        LogPrintf("%s: commitHash -> bnH failed.\n", __func__);
-        rv = 1; goto End;
-    }
-
-
-    if (!BN_mod(bnH, bnH, bnOrder, bnCtx)) // this is necessary
-    {
-        LogPrintf("%s: BN_mod failed.\n", __func__);
-        rv = 1; goto End;
-    }
-
-    // sigc[nSecretOffset] = (bnH - bnSum) % N
-    if (!BN_mod_sub(bnT, bnH, bnSum, bnOrder, bnCtx))
-    {
-        LogPrintf("%s: BN_mod_sub failed.\n", __func__);
-        rv = 1; goto End;
-    }
-
-    if ((nBytes = BN_num_bytes(bnT)) > (int)EC_SECRET_SIZE
-        || BN_bn2bin(bnT, &pSigc[nSecretOffset * EC_SECRET_SIZE + (EC_SECRET_SIZE-nBytes)]) != nBytes)
-    {
-        LogPrintf("%s: bnT -> pSigc failed.\n", __func__);
-        rv = 1; goto End;
-    }
-
-    // sigr[nSecretOffset] = (bnKS - sigc[nSecretOffset] * bnSecret) % N
-    // reuse bnH for bnSecret
-    if (!bnH || !(BN_bin2bn(&secret.e[0], EC_SECRET_SIZE, bnH)))
-    {
-        LogPrintf("%s: BN_bin2bn failed.\n", __func__);
-        rv = 1; goto End;
-    }
-
-    // bnT = sigc[nSecretOffset] * bnSecret , TODO: mod N ?
-    if (!BN_mul(bnT, bnT, bnH, bnCtx))
-    {
-        LogPrintf("%s: BN_mul failed.\n", __func__);
-        rv = 1; goto End;
-    }
+    uint256 commitHash = ssCommitHash.GetHash();
 
-    if (!BN_mod_sub(bnT, bnKS, bnT, bnOrder, bnCtx))
-    {
-        LogPrintf("%s: BN_mod_sub failed.\n", __func__);
-        rv = 1; goto End;
-    }
+    // sigc[nSecretOffset] = (H - sum) % N
+    arith_uint256 cs = ScalarSub(ScalarGet(commitHash.begin()), sum);
+    ScalarSet(&pSigc[nSecretOffset * ec_secret_size], cs);
 
-    if ((nBytes = BN_num_bytes(bnT)) > (int) EC_SECRET_SIZE
-        || BN_bn2bin(bnT, &pSigr[nSecretOffset * EC_SECRET_SIZE + (EC_SECRET_SIZE-nBytes)]) != nBytes)
+    // sigr[nSecretOffset] = (ks - sigc[nSecretOffset] * secret) % N
+    arith_uint256 t;
+    if (ScalarMul(cs, ScalarGet(&secret.e[0]), t) != 0)
     {
-        LogPrintf("%s: bnT -> pSigr failed.\n", __func__);
-        rv = 1; goto End;
+        LogPrintf("%s: ScalarMul failed.\n", __func__);
+        return 1;
     }
+    ScalarSet(&pSigr[nSecretOffset * ec_secret_size], ScalarSub(ks, t));
 
-    End:
-    EC_POINT_free(ptT1);
-    EC_POINT_free(ptT2);
-    EC_POINT_free(ptT3);
-    EC_POINT_free(ptPk);
-    EC_POINT_free(ptKi);
-    EC_POINT_free(ptL);
-    EC_POINT_free(ptR);
-
-    BN_CTX_end(bnCtx);
-
-    return rv;
+    return 0;
 }
 
-int verifyRingSignature(data_chunk &keyImage, uint256 &txnHash, int nRingSize, const uint8_t *pPubkeys, const uint8_t *pSigc, const uint8_t *pSigr)
+static int checkRingSignature(const CRingSigBatch::Entry &sig, RingMemberMap &mapMembers)
 {
-    int rv = 0;
-
-    BN_CTX_start(bnCtx);
-
-    BIGNUM   *bnT   = BN_CTX_get(bnCtx);
-    BIGNUM   *bnH   = BN_CTX_get(bnCtx);
-    BIGNUM   *bnC   = BN_CTX_get(bnCtx);
-    BIGNUM   *bnR   = BN_CTX_get(bnCtx);
-    BIGNUM   *bnSum = BN_CTX_get(bnCtx);
-    EC_POINT *ptT1  = NULL;
-    EC_POINT *ptT2  = NULL;
-    EC_POINT *ptT3  = NULL;
-    EC_POINT *ptPk  = NULL;
-    EC_POINT *ptKi  = NULL;
-    EC_POINT *ptL   = NULL;
-    EC_POINT *ptR   = NULL;
-
-    uint8_t tempData[66]; // hold raw point data to hash
-    uint256 commitHash;
-    CHashWriter ssCommitHash(SER_GETHASH, PROTOCOL_VERSION);
-
-    ssCommitHash << txnHash;
-
-    // zero sum
-    if (!bnSum || !(BN_zero(bnSum)))
+    // get keyimage as point
+    secp256k1_pubkey ptKi;
+    if (sig.keyImage.size() != ec_compressed_size || PointParse(&sig.keyImage[0], sig.keyImage.size(), ptKi) != 0)
     {
-        LogPrintf("%s: BN_zero failed.\n", __func__);
-        rv = 1; goto End;
+        LogPrintf("%s: extract ptKi failed.\n", __func__);
+        return 1;
     }
 
-    if (   !(ptT1 = EC_POINT_new(ecGrp))
-        || !(ptT2 = EC_POINT_new(ecGrp))
-        || !(ptT3 = EC_POINT_new(ecGrp))
-        || !(ptPk = EC_POINT_new(ecGrp))
-        || !(ptKi = EC_POINT_new(ecGrp))
-        || !(ptL  = EC_POINT_new(ecGrp))
-        || !(ptR  = EC_POINT_new(ecGrp)))
-    {
-        LogPrintf("%s: EC_POINT_new failed.\n", __func__);
-        rv = 1; goto End;
-    }
+    uint8_t tempData[66]; // hold raw point data to hash
+    CHashWriter ssCommitHash(SER_GETHASH, PROTOCOL_VERSION);
 
-    // get keyimage as point
-    if (!EC_POINT_oct2point(ecGrp, ptKi, &keyImage[0], EC_COMPRESSED_SIZE, bnCtx)
-      &&(rv = errorN(1, "%s: extract ptKi failed.", __func__)))
-        goto End;
+    ssCommitHash << sig.txnHash;
 
-    for (int i = 0; i < nRingSize; ++i)
+    arith_uint256 sum = 0;
+    for (int i = 0; i < sig.nRingSize; ++i)
     {
         // Li = ci * Pi + ri * G
         // Ri = ci * I + ri * Hp(Pi)
 
-        if (   !bnC || !(bnC = BN_bin2bn(&pSigc[i * EC_SECRET_SIZE], EC_SECRET_SIZE, bnC))
-            || !bnR || !(bnR = BN_bin2bn(&pSigr[i * EC_SECRET_SIZE], EC_SECRET_SIZE, bnR)))
-        {
-            LogPrintf("%s: extract bnC and bnR failed.\n", __func__);
-            rv = 1; goto End;
-        }
-
-        // get Pk i as point
-        if (!(bnT = BN_bin2bn(&pPubkeys[i * EC_COMPRESSED_SIZE], EC_COMPRESSED_SIZE, bnT))
-            || !(ptPk) || !(ptPk = EC_POINT_bn2point(ecGrp, bnT, ptPk, bnCtx)))
+        const CRingMember *member = GetRingMember(mapMembers, &sig.pPubkeys[i * ec_compressed_size]);
+        if (!member)
         {
             LogPrintf("%s: extract ptPk failed.\n", __func__);
-            rv = 1; goto End;
-        }
-
-        // ptT1 = ci * Pi
-        if (!EC_POINT_mul(ecGrp, ptT1, NULL, ptPk, bnC, bnCtx))
-        {
-            LogPrintf("%s: EC_POINT_mul failed.\n", __func__);
-            rv = 1; goto End;
-        }
-
-        // ptT2 = ri * G
-        if (!EC_POINT_mul(ecGrp, ptT2, bnR, NULL, NULL, bnCtx))
-        {
-            LogPrintf("%s: EC_POINT_mul failed.\n", __func__);
-            rv = 1; goto End;
-        }
-
-        // ptL = ptT1 + ptT2
-        if (!EC_POINT_add(ecGrp, ptL, ptT1, ptT2, bnCtx))
-        {
-            LogPrintf("%s: EC_POINT_add failed.\n", __func__);
-            rv = 1; goto End;
-        }
-
-        // ptT3 = Hp(Pi)
-        if (hashToEC(&pPubkeys[i * EC_COMPRESSED_SIZE], EC_COMPRESSED_SIZE, bnT, ptT3) != 0)
-        {
-            LogPrintf("%s: hashToEC failed.\n", __func__);
-            rv = 1; goto End;
+            return 1;
         }
 
-        // ptT1 = k1 * I
-        if (!EC_POINT_mul(ecGrp, ptT1, NULL, ptKi, bnC, bnCtx))
-        {
-            LogPrintf("%s: EC_POINT_mul failed.\n", __func__);
-            rv = 1; goto End;
-        }
-
-        // ptT2 = k2 * ptT3
-        if (!EC_POINT_mul(ecGrp, ptT2, NULL, ptT3, bnR, bnCtx))
-        {
-            LogPrintf("%s: EC_POINT_mul failed.\n", __func__);
-            rv = 1; goto End;
-        }
+        arith_uint256 c = ScalarGet(&sig.pSigc[i * ec_secret_size]);
+        arith_uint256 r = ScalarGet(&sig.pSigr[i * ec_secret_size]);
 
-        // ptR = ptT1 + ptT2
-        if (!EC_POINT_add(ecGrp, ptR, ptT1, ptT2, bnCtx))
+        if (PointMulAdd(&member->pk, c, nullptr, r, &tempData[0]) != 0
+            || PointMulAdd(&ptKi, c, &member->hp, r, &tempData[33]) != 0)
         {
-            LogPrintf("%s: EC_POINT_add failed.\n", __func__);
-            rv = 1; goto End;
+            LogPrintf("%s: extract ptL and ptR failed.\n", __func__);
+            return 1;
         }
 
         // sum = (sum + ci) % N
-        if (!BN_mod_add(bnSum, bnSum, bnC, bnOrder, bnCtx))
-        {
-            LogPrintf("%s: BN_mod_add failed.\n", __func__);
-            rv = 1; goto End;
-        }
+        sum = ScalarAdd(sum, c);
 
         // -- add ptL and ptR to hash
-        if (!(EC_POINT_point2oct(ecGrp, ptL, POINT_CONVERSION_COMPRESSED, &tempData[0],  33, bnCtx) == (int) EC_COMPRESSED_SIZE)
-          ||!(EC_POINT_point2oct(ecGrp, ptR, POINT_CONVERSION_COMPRESSED, &tempData[33], 33, bnCtx) == (int) EC_COMPRESSED_SIZE))
-        {
-            LogPrintf("%s: extract ptL and ptR failed.\n", __func__);
-            rv = 1; goto End;
-        }
-
         ssCommitHash.write((const char*)&tempData[0], 66);
     }
 
-    commitHash = ssCommitHash.GetHash();
-
-    if (!(bnH) || !(bnH = BN_bin2bn(commitHash.begin(), EC_SECRET_SIZE, bnH)))
-    {
-        LogPrintf("%s: commitHash -> bnH failed.\n", __func__);
-        rv = 1; goto End;
-    }
-
-    if (!BN_mod(bnH, bnH, bnOrder, bnCtx))
-    {
-        LogPrintf("%s: BN_mod failed.\n", __func__);
-        rv = 1; goto End;
-    }
-
-    // bnT = (bnH - bnSum) % N
-    if (!BN_mod_sub(bnT, bnH, bnSum, bnOrder, bnCtx))
-    {
-        LogPrintf("%s: BN_mod_sub failed.\n", __func__);
-        rv = 1; goto End;
-    }
+    uint256 commitHash = ssCommitHash.GetHash();
 
-    // test bnT == 0  (bnSum == bnH)
-    if (!BN_is_zero(bnT))
+    // test sum == H
+    if (ScalarGet(commitHash.begin()) != sum)
     {
         LogPrintf("%s: signature does not verify.\n", __func__);
-        rv = 2;
+        return 2;
     }
 
-    End:
-
-    EC_POINT_free(ptT1);
-    EC_POINT_free(ptT2);
-    EC_POINT_free(ptT3);
-    EC_POINT_free(ptPk);
-    EC_POINT_free(ptKi);
-    EC_POINT_free(ptL);
-    EC_POINT_free(ptR);
-
-    BN_CTX_end(bnCtx);
-
-    return rv;
+    return 0;
 }
 
+int verifyRingSignature(data_chunk &keyImage, uint256 &txnHash, int nRingSize, const uint8_t *pPubkeys, const uint8_t *pSigc, const uint8_t *pSigr)
+{
+    CRingSigBatch batch;
+    batch.Add(keyImage, txnHash, nRingSize, pPubkeys, pSigc, pSigr);
+    std::vector<int> vResults;
+    batch.Verify(vResults);
+    return vResults[0];
+}
 
 int generateRingSignatureAB(data_chunk &keyImage, uint256 &txnHash, int nRingSize, int nSecretOffset, ec_secret secret, const uint8_t *pPubkeys, data_chunk &sigC, uint8_t *pSigS)
 {
     // https://bitcointalk.org/index.php?topic=972541.msg10619684
 
-    if (fDebugRingSig)
-        LogPrintf("%s: Ring size %d.\n", __func__, nRingSize);
-
     assert(nRingSize < 200);
 
-    RandAddSeedPerfmon();
-
-    memset(pSigS, 0, EC_SECRET_SIZE * nRingSize);
-
-    int rv = 0;
-    int nBytes;
-
-    uint256 tmpPkHash;
-    uint256 tmpHash;
+    memset(pSigS, 0, ec_secret_size * nRingSize);
 
     uint8_t tempData[66]; // hold raw point data to hash
     ec_secret sAlpha;
 
     if (0 != GenerateRandomSecret(sAlpha))
-        return errorN(1, "%s: GenerateRandomSecret failed.", __func__);
+    {
+        LogPrintf("%s: GenerateRandomSecret failed.\n", __func__);
+        return 1;
+    }
+    arith_uint256 alpha = ScalarGet(&sAlpha.e[0]);
 
     CHashWriter ssPkHash(SER_GETHASH, PROTOCOL_VERSION);
     CHashWriter ssCjHash(SER_GETHASH, PROTOCOL_VERSION);
 
-    uint256 test;
     for (int i = 0; i < nRingSize; ++i)
     {
-        ssPkHash.write((const char*)&pPubkeys[i * EC_COMPRESSED_SIZE], EC_COMPRESSED_SIZE);
+        ssPkHash.write((const char*)&pPubkeys[i * ec_compressed_size], ec_compressed_size);
 
         if (i == nSecretOffset)
             continue;
 
-        int k;
-        // NOTE: necessary to clamp?
-        for (k = 0; k < 32; ++k)
+        ec_secret sS;
+        if (0 != GenerateRandomSecret(sS))
         {
-            if (1 != RAND_bytes(&pSigS[i * EC_SECRET_SIZE], 32))
-                return errorN(1, "%s: RAND_bytes ERR_get_error %u.", __func__, ERR_get_error());
-
-            memcpy(test.begin(), &pSigS[i * EC_SECRET_SIZE], 32);
-            if (test > MIN_SECRET && test < MAX_SECRET)
-                break;
+            LogPrintf("%s: Failed to generate a valid key.\n", __func__);
+            return 1;
         }
-
-        if (k > 31)
-            return errorN(1, "%s: Failed to generate a valid key.", __func__);
+        memcpy(&pSigS[i * ec_secret_size], &sS.e[0], ec_secret_size);
     }
 
-    tmpPkHash = ssPkHash.GetHash();
-
-    BN_CTX_start(bnCtx);
-    BIGNUM   *bnT  = BN_CTX_get(bnCtx);
-    BIGNUM   *bnT2 = BN_CTX_get(bnCtx);
-    BIGNUM   *bnS  = BN_CTX_get(bnCtx);
-    BIGNUM   *bnC  = BN_CTX_get(bnCtx);
-    BIGNUM   *bnCj = BN_CTX_get(bnCtx);
-    BIGNUM   *bnA  = BN_CTX_get(bnCtx);
-    EC_POINT *ptKi = NULL;
-    EC_POINT *ptPk = NULL;
-    EC_POINT *ptT1 = NULL;
-    EC_POINT *ptT2 = NULL;
-    EC_POINT *ptT3 = NULL;
-    EC_POINT *ptT4 = NULL;
-
-    if (!(ptKi = EC_POINT_new(ecGrp))
-      ||!(ptPk = EC_POINT_new(ecGrp))
-      ||!(ptT1 = EC_POINT_new(ecGrp))
-      ||!(ptT2 = EC_POINT_new(ecGrp))
-      ||!(ptT3 = EC_POINT_new(ecGrp))
-      ||!(ptT4 = EC_POINT_new(ecGrp)))
-    {
-        LogPrintf("%s: EC_POINT_new failed.\n", __func__);
-        rv = 1; goto End;
-    }
+    uint256 tmpPkHash = ssPkHash.GetHash();
 
     // get keyimage as point
-    if (!EC_POINT_oct2point(ecGrp, ptKi, &keyImage[0], EC_COMPRESSED_SIZE, bnCtx)
-      &&(rv = errorN(1, "%s: extract ptKi failed.", __func__)))
-        goto End;
-
-    // c_{j+1} = h(P_1,...,P_n,alpha*G,alpha*H(P_j))
-    if (!bnA || !(BN_bin2bn(&sAlpha.e[0], EC_SECRET_SIZE, bnA)))
-    {
-        LogPrintf("%s: BN_bin2bn failed.\n", __func__);
-        rv = 1; goto End;
-    }
-
-    // ptT1 = alpha * G
-    if (!EC_POINT_mul(ecGrp, ptT1, bnA, NULL, NULL, bnCtx))
-    {
-        LogPrintf("%s: EC_POINT_mul failed.\n", __func__);
-        rv = 1; goto End;
-    }
-
-    // ptT3 = H(Pj)
-
-    if (hashToEC(&pPubkeys[nSecretOffset * EC_COMPRESSED_SIZE], EC_COMPRESSED_SIZE, bnT2, ptT3) != 0)
+    secp256k1_pubkey ptKi;
+    if (keyImage.size() != ec_compressed_size || PointParse(&keyImage[0], keyImage.size(), ptKi) != 0)
     {
-        LogPrintf("%s: hashToEC failed.\n", __func__);
-        rv = 1; goto End;
+        LogPrintf("%s: extract ptKi failed.\n", __func__);
+        return 1;
     }
 
-    ssCjHash.write((const char*)tmpPkHash.begin(), 32);
-
-    // ptT2 = alpha * H(P_j)
-    // ptT2 = alpha * ptT3
-    if (!EC_POINT_mul(ecGrp, ptT2, NULL, ptT3, bnA, bnCtx))
+    RingMemberMap mapMembers;
+    const CRingMember *member = GetRingMember(mapMembers, &pPubkeys[nSecretOffset * ec_compressed_size]);
+    if (!member)
     {
-        LogPrintf("%s: EC_POINT_mul failed.\n", __func__);
-        rv = 1; goto End;
+        LogPrintf("%s: extract ptPk failed.\n", __func__);
+        return 1;
     }
 
-    if (   !(EC_POINT_point2oct(ecGrp, ptT1, POINT_CONVERSION_COMPRESSED, &tempData[0],  33, bnCtx) == (int) EC_COMPRESSED_SIZE)
-        || !(EC_POINT_point2oct(ecGrp, ptT2, POINT_CONVERSION_COMPRESSED, &tempData[33], 33, bnCtx) == (int) EC_COMPRESSED_SIZE))
+    // c_{j+1} = h(P_1,...,P_n,alpha*G,alpha*H(P_j))
+    if (PointMulAdd(nullptr, alpha, nullptr, 0, &tempData[0]) != 0
+        || PointMulAdd(&member->hp, alpha, nullptr, 0, &tempData[33]) != 0)
     {
         LogPrintf("%s: extract ptL and ptR failed.\n", __func__);
-        rv = 1; goto End;
+        return 1;
     }
 
+    ssCjHash.write((const char*)tmpPkHash.begin(), 32);
     ssCjHash.write((const char*)&tempData[0], 66);
-    tmpHash = ssCjHash.GetHash();
-
-    if (!bnC || !(BN_bin2bn(tmpHash.begin(), EC_SECRET_SIZE, bnC)) // bnC lags i by 1
-        || !BN_mod(bnC, bnC, bnOrder, bnCtx))
-    {
-        LogPrintf("%s: hash -> bnC failed.\n", __func__);
-        rv = 1; goto End;
-    }
-
+    arith_uint256 c = ScalarGet(ssCjHash.GetHash().begin()); // c lags i by 1
+    arith_uint256 cj;
 
     // c_{j+2} = h(P_1,...,P_n,s_{j+1}*G+c_{j+1}*P_{j+1},s_{j+1}*H(P_{j+1})+c_{j+1}*I_j)
     for (int k = 0, ib = (nSecretOffset + 1) % nRingSize, i = (nSecretOffset + 2) % nRingSize;
@@ -834,306 +541,174 @@ int generateRingSignatureAB(data_chunk &keyImage, uint256 &txnHash, int nRingSiz
         if (k == nRingSize - 1)
         {
             // s_j = alpha - c_j*x_j mod n.
-            if (!bnT || !BN_bin2bn(&secret.e[0], EC_SECRET_SIZE, bnT))
-            {
-                LogPrintf("%s: BN_bin2bn failed.\n", __func__);
-                rv = 1; goto End;
-            }
-
-            if (!BN_mul(bnT2, bnCj, bnT, bnCtx))
-            {
-                LogPrintf("%s: BN_mul failed.\n", __func__);
-                rv = 1; goto End;
-            }
-
-            if (!BN_mod_sub(bnS, bnA, bnT2, bnOrder, bnCtx))
-            {
-                LogPrintf("%s: BN_mod_sub failed.\n", __func__);
-                rv = 1; goto End;
-            }
-
-            if (!bnS || (nBytes = BN_num_bytes(bnS)) > (int) EC_SECRET_SIZE
-                || BN_bn2bin(bnS, &pSigS[nSecretOffset * EC_SECRET_SIZE + (EC_SECRET_SIZE-nBytes)]) != nBytes)
+            arith_uint256 t;
+            if (ScalarMul(cj, ScalarGet(&secret.e[0]), t) != 0)
             {
-                LogPrintf("%s: bnS -> pSigS failed.\n", __func__);
-                rv = 1; goto End;
+                LogPrintf("%s: ScalarMul failed.\n", __func__);
+                return 1;
             }
+            ScalarSet(&pSigS[nSecretOffset * ec_secret_size], ScalarSub(alpha, t));
 
             if (nSecretOffset != nRingSize - 1)
                 break;
         }
 
-        if (!bnS || !(BN_bin2bn(&pSigS[ib * EC_SECRET_SIZE], EC_SECRET_SIZE, bnS)))
-        {
-            LogPrintf("%s: BN_bin2bn failed.\n", __func__);
-            rv = 1; goto End;
-        }
-
-        // bnC is from last round (ib)
-        if (!EC_POINT_oct2point(ecGrp, ptPk, &pPubkeys[ib * EC_COMPRESSED_SIZE], EC_COMPRESSED_SIZE, bnCtx))
-        {
-            LogPrintf("%s: EC_POINT_oct2point failed.\n", __func__);
-            rv = 1; goto End;
-        }
-
-        // ptT1 = s_{j+1}*G+c_{j+1}*P_{j+1}
-        if (!EC_POINT_mul(ecGrp, ptT1, bnS, ptPk, bnC, bnCtx))
-        {
-            LogPrintf("%s: EC_POINT_mul failed.\n", __func__);
-            rv = 1; goto End;
-        }
-
-        //s_{j+1}*H(P_{j+1})+c_{j+1}*I_j
+        arith_uint256 s = ScalarGet(&pSigS[ib * ec_secret_size]);
 
-        if (hashToEC(&pPubkeys[ib * EC_COMPRESSED_SIZE], EC_COMPRESSED_SIZE, bnT2, ptT2) != 0)
+        // c is from last round (ib)
+        if (!(member = GetRingMember(mapMembers, &pPubkeys[ib * ec_compressed_size])))
         {
-            LogPrintf("%s: hashToEC failed.\n", __func__);
-            rv = 1; goto End;
-        }
-
-        // ptT3 = s_{j+1}*H(P_{j+1})
-        if (!EC_POINT_mul(ecGrp, ptT3, NULL, ptT2, bnS, bnCtx))
-        {
-            LogPrintf("%s: EC_POINT_mul failed.\n", __func__);
-            rv = 1; goto End;
-        }
-
-        // ptT4 = c_{j+1}*I_j
-        if (!EC_POINT_mul(ecGrp, ptT4, NULL, ptKi, bnC, bnCtx))
-        {
-            LogPrintf("%s: EC_POINT_mul failed.\n", __func__);
-            rv = 1; goto End;
-        }
-
-        // ptT2 = ptT3 + ptT4
-        if (!EC_POINT_add(ecGrp, ptT2, ptT3, ptT4, bnCtx))
-        {
-            LogPrintf("%s: EC_POINT_add failed.\n", __func__);
-            rv = 1; goto End;
+            LogPrintf("%s: extract ptPk failed.\n", __func__);
+            return 1;
         }
 
-        if (!(EC_POINT_point2oct(ecGrp, ptT1, POINT_CONVERSION_COMPRESSED, &tempData[0],  33, bnCtx) == (int) EC_COMPRESSED_SIZE)
-          ||!(EC_POINT_point2oct(ecGrp, ptT2, POINT_CONVERSION_COMPRESSED, &tempData[33], 33, bnCtx) == (int) EC_COMPRESSED_SIZE))
+        // s_{j+1}*G+c_{j+1}*P_{j+1}
+        // s_{j+1}*H(P_{j+1})+c_{j+1}*I_j
+        if (PointMulAdd(nullptr, s, &member->pk, c, &tempData[0]) != 0
+            || PointMulAdd(&member->hp, s, &ptKi, c, &tempData[33]) != 0)
         {
             LogPrintf("%s: extract ptL and ptR failed.\n", __func__);
-            rv = 1; goto End;
+            return 1;
         }
 
         CHashWriter ssCHash(SER_GETHASH, PROTOCOL_VERSION);
         ssCHash.write((const char*)tmpPkHash.begin(), 32);
         ssCHash.write((const char*)&tempData[0], 66);
-        tmpHash = ssCHash.GetHash();
+        c = ScalarGet(ssCHash.GetHash().begin());
 
-        if ((!bnC
-           ||!BN_bin2bn(tmpHash.begin(), EC_SECRET_SIZE, bnC) // bnC lags i by 1
-           ||!BN_mod(bnC, bnC, bnOrder, bnCtx))
-          && (rv = errorN(1, "%s: hash -> bnC failed.", __func__)))
-            goto End;
-
-        if (i == nSecretOffset
-         &&!BN_copy(bnCj, bnC)
-         && (rv = errorN(1, "%s: BN_copy failed.\n", __func__)))
-            goto End;
+        if (i == nSecretOffset)
+            cj = c;
 
         if (i == 0)
         {
-            memset(tempData, 0, EC_SECRET_SIZE);
-            if ((nBytes = BN_num_bytes(bnC)) > (int) EC_SECRET_SIZE
-                || BN_bn2bin(bnC, &tempData[0 + (EC_SECRET_SIZE-nBytes)]) != nBytes)
-            {
-                LogPrintf("%s: bnC -> sigC failed.\n", __func__);
-                rv = 1; goto End;
-            }
-            try { sigC.resize(32); } catch (std::exception& e)
-            {
-                LogPrintf("%s: sigC.resize failed.\n", __func__);
-                rv = 1; goto End;
-            }
-            memcpy(&sigC[0], tempData, EC_SECRET_SIZE);
+            sigC.resize(ec_secret_size);
+            ScalarSet(&sigC[0], c);
         }
     }
 
-    End:
-    EC_POINT_free(ptKi);
-    EC_POINT_free(ptPk);
-    EC_POINT_free(ptT1);
-    EC_POINT_free(ptT2);
-    EC_POINT_free(ptT3);
-    EC_POINT_free(ptT4);
-
-    BN_CTX_end(bnCtx);
-
-    return rv;
+    return 0;
 }
 
-
-int verifyRingSignatureAB(data_chunk &keyImage, uint256 &txnHash, int nRingSize, const uint8_t *pPubkeys, const data_chunk &sigC, const uint8_t *pSigS)
+static int checkRingSignatureAB(const CRingSigBatch::Entry &sig, RingMemberMap &mapMembers)
 {
     // https://bitcointalk.org/index.php?topic=972541.msg10619684
 
     // forall_{i=1..n} compute e_i=s_i*G+c_i*P_i and E_i=s_i*H(P_i)+c_i*I_j and c_{i+1}=h(P_1,...,P_n,e_i,E_i)
     // check c_{n+1}=c_1
 
-    if (sigC.size() != EC_SECRET_SIZE)
-        return errorN(1, "%s: sigC size !=  EC_SECRET_SIZE.", __func__);
-    if (keyImage.size() != EC_COMPRESSED_SIZE)
-        return errorN(1, "%s: keyImage size !=  EC_COMPRESSED_SIZE.", __func__);
-
-    int rv = 0;
-
-    uint256 tmpPkHash;
-    uint256 tmpHash;
-
-    uint8_t tempData[66]; // hold raw point data to hash
-    CHashWriter ssPkHash(SER_GETHASH, PROTOCOL_VERSION);
-    CHashWriter ssCjHash(SER_GETHASH, PROTOCOL_VERSION);
-
-    for (int i = 0; i < nRingSize; ++i)
-    {
-        ssPkHash.write((const char*)&pPubkeys[i * EC_COMPRESSED_SIZE], EC_COMPRESSED_SIZE);
-    }
-
-    tmpPkHash = ssPkHash.GetHash();
-
-    BN_CTX_start(bnCtx);
-
-    BIGNUM   *bnC  = BN_CTX_get(bnCtx);
-    BIGNUM   *bnC1 = BN_CTX_get(bnCtx);
-    BIGNUM   *bnT  = BN_CTX_get(bnCtx);
-    BIGNUM   *bnS  = BN_CTX_get(bnCtx);
-    EC_POINT *ptKi = NULL;
-    EC_POINT *ptT1 = NULL;
-    EC_POINT *ptT2 = NULL;
-    EC_POINT *ptT3 = NULL;
-    EC_POINT *ptPk = NULL;
-
-    if (!(ptKi = EC_POINT_new(ecGrp))
-      ||!(ptT1 = EC_POINT_new(ecGrp))
-      ||!(ptT2 = EC_POINT_new(ecGrp))
-      ||!(ptT3 = EC_POINT_new(ecGrp))
-      ||!(ptPk = EC_POINT_new(ecGrp)))
+    if (sig.sigC.size() != ec_secret_size)
     {
-        LogPrintf("%s: EC_POINT_new failed.\n", __func__);
-        rv = 1; goto End;
+        LogPrintf("%s: sigC size !=  EC_SECRET_SIZE.\n", __func__);
+        return 1;
     }
 
     // get keyimage as point
-    if (!EC_POINT_oct2point(ecGrp, ptKi, &keyImage[0], EC_COMPRESSED_SIZE, bnCtx)
-      &&(rv = errorN(1, "%s: extract ptKi failed.", __func__)))
-        goto End;
-
-    if (!bnC1 || !BN_bin2bn(&sigC[0], EC_SECRET_SIZE, bnC1))
+    secp256k1_pubkey ptKi;
+    if (sig.keyImage.size() != ec_compressed_size || PointParse(&sig.keyImage[0], sig.keyImage.size(), ptKi) != 0)
     {
-        LogPrintf("%s: BN_bin2bn failed.\n", __func__);
-        rv = 1; goto End;
+        LogPrintf("%s: extract ptKi failed.\n", __func__);
+        return 1;
     }
 
-    if (!BN_copy(bnC, bnC1))
-    {
-        LogPrintf("%s: BN_copy failed.\n", __func__);
-        rv = 1; goto End;
-    }
+    uint8_t tempData[66]; // hold raw point data to hash
+    CHashWriter ssPkHash(SER_GETHASH, PROTOCOL_VERSION);
 
-    for (int i = 0; i < nRingSize; ++i)
+    for (int i = 0; i < sig.nRingSize; ++i)
     {
-        if (!bnS || !(BN_bin2bn(&pSigS[i * EC_SECRET_SIZE], EC_SECRET_SIZE, bnS)))
-        {
-            LogPrintf("%s: BN_bin2bn failed.\n", __func__);
-            rv = 1; goto End;
-        }
-
-        // ptT2 <- pk
-        if (!EC_POINT_oct2point(ecGrp, ptPk, &pPubkeys[i * EC_COMPRESSED_SIZE], EC_COMPRESSED_SIZE, bnCtx))
-        {
-            LogPrintf("%s: EC_POINT_oct2point failed.\n", __func__);
-            rv = 1; goto End;
-        }
-
-        // ptT1 = e_i=s_i*G+c_i*P_i
-        if (!EC_POINT_mul(ecGrp, ptT1, bnS, ptPk, bnC, bnCtx))
-        {
-            LogPrintf("%s: EC_POINT_mul failed.\n", __func__);
-            rv = 1; goto End;
-        }
-
-        if (!(EC_POINT_point2oct(ecGrp, ptT1, POINT_CONVERSION_COMPRESSED, &tempData[0],  33, bnCtx) == (int) EC_COMPRESSED_SIZE))
-        {
-            LogPrintf("%s: extract ptT1 failed.\n", __func__);
-            rv = 1; goto End;
-        }
-
-        // ptT2 =E_i=s_i*H(P_i)+c_i*I_j
+        ssPkHash.write((const char*)&sig.pPubkeys[i * ec_compressed_size], ec_compressed_size);
+    }
 
-        // ptT2 =H(P_i)
-        if (hashToEC(&pPubkeys[i * EC_COMPRESSED_SIZE], EC_COMPRESSED_SIZE, bnT, ptT2) != 0)
-        {
-            LogPrintf("%s: hashToEC failed.\n", __func__);
-            rv = 1; goto End;
-        }
+    uint256 tmpPkHash = ssPkHash.GetHash();
 
-        // ptT3 = s_i*ptT2
-        if (!EC_POINT_mul(ecGrp, ptT3, NULL, ptT2, bnS, bnCtx))
-        {
-            LogPrintf("%s: EC_POINT_mul failed.\n", __func__);
-            rv = 1; goto End;
-        }
+    const arith_uint256 c1 = ScalarGet(&sig.sigC[0]);
+    arith_uint256 c = c1;
 
-        // ptT1 = c_i*I_j
-        if (!EC_POINT_mul(ecGrp, ptT1, NULL, ptKi, bnC, bnCtx))
+    for (int i = 0; i < sig.nRingSize; ++i)
+    {
+        const CRingMember *member = GetRingMember(mapMembers, &sig.pPubkeys[i * ec_compressed_size]);
+        if (!member)
         {
-            LogPrintf("%s: EC_POINT_mul failed.\n", __func__);
-            rv = 1; goto End;
+            LogPrintf("%s: extract ptPk failed.\n", __func__);
+            return 1;
         }
 
-        // ptT2 = ptT3 + ptT1
-        if (!EC_POINT_add(ecGrp, ptT2, ptT3, ptT1, bnCtx))
-        {
-            LogPrintf("%s: EC_POINT_add failed.\n", __func__);
-            rv = 1; goto End;
-        }
+        arith_uint256 s = ScalarGet(&sig.pSigr[i * ec_secret_size]);
 
-        if (!(EC_POINT_point2oct(ecGrp, ptT2, POINT_CONVERSION_COMPRESSED, &tempData[33], 33, bnCtx) == (int) EC_COMPRESSED_SIZE))
+        // e_i=s_i*G+c_i*P_i
+        // E_i=s_i*H(P_i)+c_i*I_j
+        if (PointMulAdd(nullptr, s, &member->pk, c, &tempData[0]) != 0
+            || PointMulAdd(&member->hp, s, &ptKi, c, &tempData[33]) != 0)
         {
-            LogPrintf("%s: extract ptT2 failed.\n", __func__);
-            rv = 1; goto End;
+            LogPrintf("%s: extract ptL and ptR failed.\n", __func__);
+            return 1;
         }
 
         CHashWriter ssCHash(SER_GETHASH, PROTOCOL_VERSION);
         ssCHash.write((const char*)tmpPkHash.begin(), 32);
         ssCHash.write((const char*)&tempData[0], 66);
-        tmpHash = ssCHash.GetHash();
-
-        if (!bnC || !(BN_bin2bn(tmpHash.begin(), EC_SECRET_SIZE, bnC))
-            || !BN_mod(bnC, bnC, bnOrder, bnCtx))
-        {
-            LogPrintf("%s: tmpHash -> bnC failed.\n", __func__);
-            rv = 1; goto End;
-        }
-    }
-
-    // bnT = (bnC - bnC1) % N
-    if (!BN_mod_sub(bnT, bnC, bnC1, bnOrder, bnCtx))
-    {
-        LogPrintf("%s: BN_mod_sub failed.\n", __func__);
-        rv = 1; goto End;
+        c = ScalarGet(ssCHash.GetHash().begin());
     }
 
-    // test bnT == 0  (bnC == bnC1)
-    if (!BN_is_zero(bnT))
+    // test c == c1
+    if (c != c1)
     {
         LogPrintf("%s: signature does not verify.\n", __func__);
-        rv = 2;
+        return 2;
     }
 
-    End:
+    return 0;
+}
+
+int verifyRingSignatureAB(data_chunk &keyImage, uint256 &txnHash, int nRingSize, const uint8_t *pPubkeys, const data_chunk &sigC, const uint8_t *pSigS)
+{
+    CRingSigBatch batch;
+    batch.AddAB(keyImage, txnHash, nRingSize, pPubkeys, sigC, pSigS);
+    std::vector<int> vResults;
+    batch.Verify(vResults);
+    return vResults[0];
+}
+
+void CRingSigBatch::Add(const data_chunk &keyImage, const uint256 &txnHash, int nRingSize, const uint8_t *pPubkeys, const uint8_t *pSigc, const uint8_t *pSigr)
+{
+    Entry sig;
+    sig.type = RING_SIG_1;
+    sig.keyImage = keyImage;
+    sig.txnHash = txnHash;
+    sig.nRingSize = nRingSize;
+    sig.pPubkeys = pPubkeys;
+    sig.pSigc = pSigc;
+    sig.pSigr = pSigr;
+    vEntries.push_back(std::move(sig));
+}
 
-    BN_CTX_end(bnCtx);
+void CRingSigBatch::AddAB(const data_chunk &keyImage, const uint256 &txnHash, int nRingSize, const uint8_t *pPubkeys, const data_chunk &sigC, const uint8_t *pSigS)
+{
+    Entry sig;
+    sig.type = RING_SIG_2;
+    sig.keyImage = keyImage;
+    sig.txnHash = txnHash;
+    sig.nRingSize = nRingSize;
+    sig.pPubkeys = pPubkeys;
+    sig.sigC = sigC;
+    sig.pSigc = nullptr;
+    sig.pSigr = pSigS;
+    vEntries.push_back(std::move(sig));
+}
 
-    EC_POINT_free(ptKi);
-    EC_POINT_free(ptT1);
-    EC_POINT_free(ptT2);
-    EC_POINT_free(ptT3);
-    EC_POINT_free(ptPk);
+bool CRingSigBatch::Verify(std::vector<int> &vResults) const
+{
+    // Decoys are drawn from the same outputs over and over, parse and
+    // hash each of them once for the whole batch
+    RingMemberMap mapMembers;
 
-    return rv;
+    bool fValid = true;
+    vResults.resize(vEntries.size());
+    for (size_t i = 0; i < vEntries.size(); ++i)
+    {
+        const Entry &sig = vEntries[i];
+        vResults[i] = sig.type == RING_SIG_1 ? checkRingSignature(sig, mapMembers) : checkRingSignatureAB(sig, mapMembers);
+        if (vResults[i] != 0)
+            fValid = false;
+    }
+    return fValid;
 }
@@ -6,8 +6,9 @@
 #define VERGE_RINGSIG_H
 
 #include <stealth.h>
-#include <state.h>
-#include <types.h>
+#include <uint256.h>
+
+#include <vector>
 
 class CPubKey;
 
@@ -44,5 +45,38 @@ int verifyRingSignature(data_chunk &keyImage, uint256 &txnHash, int nRingSize, c
 int generateRingSignatureAB(data_chunk &keyImage, uint256 &txnHash, int nRingSize, int nSecretOffset, ec_secret secret, const uint8_t *pPubkeys, data_chunk &sigC, uint8_t *pSigS);
 int verifyRingSignatureAB(data_chunk &keyImage, uint256 &txnHash, int nRingSize, const uint8_t *pPubkeys, const data_chunk &sigC, const uint8_t *pSigS);
 
+/**
+ * Verifies many ring signatures together. Ring members are parsed and
+ * hashed to the curve once per batch, however many rings they appear in.
+ * The keys and signatures passed to Add() must stay valid until Verify().
+ */
+class CRingSigBatch
+{
+public:
+    struct Entry
+    {
+        ringsigType type;
+        data_chunk keyImage;
+        uint256 txnHash;
+        int nRingSize;
+        const uint8_t *pPubkeys;
+        data_chunk sigC;       // RING_SIG_2
+        const uint8_t *pSigc;  // RING_SIG_1
+        const uint8_t *pSigr;  // RING_SIG_1: r, RING_SIG_2: s
+    };
+
+    void Add(const data_chunk &keyImage, const uint256 &txnHash, int nRingSize, const uint8_t *pPubkeys, const uint8_t *pSigc, const uint8_t *pSigr);
+    void AddAB(const data_chunk &keyImage, const uint256 &txnHash, int nRingSize, const uint8_t *pPubkeys, const data_chunk &sigC, const uint8_t *pSigS);
+
+    size_t size() const { return vEntries.size(); }
+    void clear() { vEntries.clear(); }
+
+    /** Returns true if every signature verifies, vResults holds the verifyRingSignature code of each. */
+    bool Verify(std::vector<int> &vResults) const;
+
+private:
+    std::vector<Entry> vEntries;
+};
+
 
 #endif  // VERGE_RINGSIG_H
@@ -52,7 +52,7 @@ static CUpdatedBlock latestblock;
 
 CBlockIndex* GetLastBlockIndex4Algo(CBlockIndex* pindex, int algo)
 {
-    while (pindex && pindex->pprev && pindex->GetBlockHeader().GetAlgo() != algo)
+    while (pindex && pindex->pprev && pindex->GetAlgo() != algo)
         pindex = pindex->pprev;
     return pindex;
 }
@@ -770,6 +770,21 @@ static CBlock GetBlockChecked(const CBlockIndex* pblockindex)
     return block;
 }
 
+/** The serialized block as stored, the same bytes that GetBlockChecked would reserialize to */
+static std::shared_ptr<const std::vector<uint8_t>> GetRawBlockChecked(const CBlockIndex* pblockindex)
+{
+    std::shared_ptr<const std::vector<uint8_t>> block_data;
+    if (IsBlockPruned(pblockindex)) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Block not available (pruned data)");
+    }
+
+    if (!ReadRawBlockFromDisk(block_data, pblockindex, Params().MessageStart())) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Block not found on disk");
+    }
+
+    return block_data;
+}
+
 static UniValue getblock(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
@@ -839,16 +854,15 @@ static UniValue getblock(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
     }
 
-    const CBlock block = GetBlockChecked(pblockindex);
-
     if (verbosity <= 0)
     {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-        ssBlock << block;
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
+        std::shared_ptr<const std::vector<uint8_t>> block_data = GetRawBlockChecked(pblockindex);
+        std::string strHex = HexStr(block_data->begin(), block_data->end());
         return strHex;
     }
 
+    const CBlock block = GetBlockChecked(pblockindex);
+
     return blockToJSON(block, chainActive.Tip(), pblockindex, verbosity >= 2);
 }
 
@@ -4,6 +4,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <algostats.h>
 #include <amount.h>
 #include <chain.h>
 #include <chainparams.h>
@@ -67,7 +68,7 @@ static UniValue GetNetworkHashPS(int lookup, int height, int algo = ALGO) {
     int64_t maxTime = minTime;
     arith_uint256 workTotal = GetBlockProof(*pb);
     for (int i = 0; i < lookup; i++) {
-        pb0 = GetLastBlockIndex4Algo(pb0->pprev, algo);
+        pb0 = pb0->pprevSameAlgo;
         if (pb0 == nullptr) break;
         workTotal += GetBlockProof(*pb0);
         int64_t time = pb0->GetBlockTime();
@@ -85,6 +86,16 @@ static UniValue GetNetworkHashPS(int lookup, int height, int algo = ALGO) {
     return workTotal.getdouble() / timeDiff;
 }
 
+/** GetNetworkHashPS(), answered from g_algo_stats when possible so that cs_main is only taken for old heights or long lookups. */
+static UniValue GetNetworkHashPSCached(int lookup, int height, int algo = ALGO) {
+    double dHashPS;
+    if (g_algo_stats.GetNetworkHashPS(algo, lookup, height, dHashPS))
+        return dHashPS;
+
+    LOCK(cs_main);
+    return GetNetworkHashPS(lookup, height, algo);
+}
+
 static UniValue getnetworkhashps(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() > 2)
@@ -103,8 +114,7 @@ static UniValue getnetworkhashps(const JSONRPCRequest& request)
             + HelpExampleRpc("getnetworkhashps", "")
        );
 
-    LOCK(cs_main);
-    return GetNetworkHashPS(!request.params[0].isNull() ? request.params[0].get_int() : 120, !request.params[1].isNull() ? request.params[1].get_int() : -1);
+    return GetNetworkHashPSCached(!request.params[0].isNull() ? request.params[0].get_int() : 120, !request.params[1].isNull() ? request.params[1].get_int() : -1);
 }
 
 static UniValue getallnetworkhashps(const JSONRPCRequest& request)
@@ -125,15 +135,14 @@ static UniValue getallnetworkhashps(const JSONRPCRequest& request)
             + HelpExampleRpc("getallnetworkhashps", "")
        );
 
-    LOCK(cs_main);
     int blocks = !request.params[0].isNull() ? request.params[0].get_int() : 360;
     int height =  !request.params[1].isNull() ? request.params[1].get_int() : -1;
     UniValue obj(UniValue::VOBJ);
-    obj.pushKV("scrypt", GetNetworkHashPS(blocks, height, ALGO_SCRYPT));
-    obj.pushKV("groestl", GetNetworkHashPS(blocks, height, ALGO_GROESTL));
-    obj.pushKV("lyra2re", GetNetworkHashPS(blocks, height, ALGO_LYRA2RE));
-    obj.pushKV("x17", GetNetworkHashPS(blocks, height, ALGO_X17));
-    obj.pushKV("blake2s", GetNetworkHashPS(blocks, height, ALGO_BLAKE));
+    obj.pushKV("scrypt", GetNetworkHashPSCached(blocks, height, ALGO_SCRYPT));
+    obj.pushKV("groestl", GetNetworkHashPSCached(blocks, height, ALGO_GROESTL));
+    obj.pushKV("lyra2re", GetNetworkHashPSCached(blocks, height, ALGO_LYRA2RE));
+    obj.pushKV("x17", GetNetworkHashPSCached(blocks, height, ALGO_X17));
+    obj.pushKV("blake2s", GetNetworkHashPSCached(blocks, height, ALGO_BLAKE));
     return obj;
 }
 
@@ -160,6 +169,8 @@ static UniValue getmininginfo(const JSONRPCRequest& request)
         );
 
 
+    UniValue networkhashps = getnetworkhashps(request);
+
     LOCK(cs_main);
 
     UniValue obj(UniValue::VOBJ);
@@ -167,7 +178,7 @@ static UniValue getmininginfo(const JSONRPCRequest& request)
     obj.pushKV("currentblockweight", (uint64_t)nLastBlockWeight);
     obj.pushKV("currentblocktx",   (uint64_t)nLastBlockTx);
     obj.pushKV("difficulty",       (double)GetDifficulty(chainActive.Tip()));
-    obj.pushKV("networkhashps",    getnetworkhashps(request));
+    obj.pushKV("networkhashps",    networkhashps);
     obj.pushKV("pooledtx",         (uint64_t)mempool.size());
     obj.pushKV("chain",            Params().NetworkIDString());
     obj.pushKV("warnings",         GetWarnings("statusbar"));
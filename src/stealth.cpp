@@ -9,10 +9,10 @@
 #include <crypto/sha256.h>
 #include <arith_uint256.h>
 
-#include <openssl/rand.h>
-#include <openssl/ec.h>
-#include <openssl/ecdsa.h>
-#include <openssl/obj_mac.h>
+#include <secp256k1.h>
+#include <secp256k1_ecdh.h>
+
+#include <memory>
 
 //const uint8_t stealth_version_byte = 0x2a;
 const uint8_t stealth_version_byte = 0x28;
@@ -148,7 +148,7 @@ int GenerateRandomSecret(ec_secret& out)
     // -- check max, try max 32 times
     for (i = 0; i < 32; ++i)
     {
-        RAND_bytes((unsigned char*) test.begin(), 32);
+        GetStrongRandBytes((unsigned char*) test.begin(), 32);
         if (UintToArith256(test) > min && UintToArith256(test) < max)
         {
             memcpy(&out.e[0], test.begin(), 32);
@@ -165,55 +165,57 @@ int GenerateRandomSecret(ec_secret& out)
     return 0;
 };
 
-int SecretToPublicKey(const ec_secret& secret, ec_point& out)
+/** Context for the stealth key arithmetic, built on first use */
+static secp256k1_context* StealthContext()
 {
-    // -- public key = private * G
-    int rv = 0;
-    
-    EC_GROUP *ecgrp = EC_GROUP_new_by_curve_name(NID_secp256k1);
-    
-    if (!ecgrp)
-    {
-        printf("SecretToPublicKey(): EC_GROUP_new_by_curve_name failed.\n");
+    static std::unique_ptr<secp256k1_context, void(*)(secp256k1_context*)> ctx(
+        []() {
+            secp256k1_context* ctx = secp256k1_context_create(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+            // Blind the generator multiplications of this context
+            unsigned char vseed[32];
+            GetRandBytes(vseed, sizeof(vseed));
+            if (!secp256k1_context_randomize(ctx, vseed))
+                printf("StealthContext(): secp256k1_context_randomize failed.\n");
+            return ctx;
+        }(),
+        secp256k1_context_destroy);
+    return ctx.get();
+};
+
+static int PubkeyToPoint(const secp256k1_pubkey& pubkey, ec_point& out)
+{
+    size_t nSize = ec_compressed_size;
+    out.resize(ec_compressed_size);
+    if (!secp256k1_ec_pubkey_serialize(StealthContext(), &out[0], &nSize, &pubkey, SECP256K1_EC_COMPRESSED)
+        || nSize != ec_compressed_size)
         return 1;
-    };
+    return 0;
+};
 
-    BIGNUM* bnIn = BN_bin2bn(&secret.e[0], ec_secret_size, BN_new());
-    if (!bnIn)
+static int PointToPubkey(const ec_point& point, secp256k1_pubkey& out)
+{
+    if (point.empty() || !secp256k1_ec_pubkey_parse(StealthContext(), &out, &point[0], point.size()))
+        return 1;
+    return 0;
+};
+
+int SecretToPublicKey(const ec_secret& secret, ec_point& out)
+{
+    // -- public key = private * G
+    secp256k1_pubkey pub;
+    if (!secp256k1_ec_pubkey_create(StealthContext(), &pub, &secret.e[0]))
     {
-        EC_GROUP_free(ecgrp);
-        printf("SecretToPublicKey(): BN_bin2bn failed\n");
+        printf("SecretToPublicKey(): secp256k1_ec_pubkey_create failed.\n");
         return 1;
     };
     
-    EC_POINT* pub = EC_POINT_new(ecgrp);
-    
-    
-    EC_POINT_mul(ecgrp, pub, bnIn, NULL, NULL, NULL);
-    
-    BIGNUM* bnOut = EC_POINT_point2bn(ecgrp, pub, POINT_CONVERSION_COMPRESSED, BN_new(), NULL);
-    if (!bnOut)
-    {
-        printf("SecretToPublicKey(): point2bn failed\n");
-        rv = 1;
-    } else
+    if (PubkeyToPoint(pub, out) != 0)
     {
-        out.resize(ec_compressed_size);
-        if (BN_num_bytes(bnOut) != (int) ec_compressed_size
-            || BN_bn2bin(bnOut, &out[0]) != (int) ec_compressed_size)
-        {
-            printf("SecretToPublicKey(): bnOut incorrect length.\n");
-            rv = 1;
-        };
-        
-        BN_free(bnOut);
+        printf("SecretToPublicKey(): pubkey serialize failed.\n");
+        return 1;
     };
     
-    EC_GROUP_free(ecgrp);
-    BN_free(bnIn);
-    EC_POINT_free(pub);
-
-    return rv;
+    return 0;
 };
 
 
@@ -246,180 +248,46 @@ int StealthSecret(ec_secret& secret, const ec_point& pubkey, const ec_point& pkS
     
     Recipient gets R' and P
     
-    test 0 and infinity?
+    secp256k1_ecdh hashes the compressed encoding of eQ with SHA256, so c
+    is the same as hashing the serialized point.
     */
     
-    int rv = 0;
-    std::vector<uint8_t> vchOutQ;
+    secp256k1_context* ctx = StealthContext();
+    secp256k1_pubkey Q, R;
     
-    BN_CTX* bnCtx   = NULL;
-    BIGNUM* bnEphem = NULL;
-    BIGNUM* bnQ     = NULL;
-    EC_POINT* Q     = NULL;
-    BIGNUM* bnOutQ  = NULL;
-    BIGNUM* bnc     = NULL;
-    EC_POINT* C     = NULL;
-    BIGNUM* bnR     = NULL;
-    EC_POINT* R     = NULL;
-    EC_POINT* Rout  = NULL;
-    BIGNUM* bnOutR  = NULL;
-    
-    EC_GROUP* ecgrp = EC_GROUP_new_by_curve_name(NID_secp256k1);
-    
-    if (!ecgrp)
+    if (PointToPubkey(pubkey, Q) != 0)
     {
-        printf("StealthSecret(): EC_GROUP_new_by_curve_name failed.\n");
+        printf("StealthSecret(): Q secp256k1_ec_pubkey_parse failed\n");
         return 1;
     };
     
-    if (!(bnCtx = BN_CTX_new()))
-    {
-        printf("StealthSecret(): BN_CTX_new failed.\n");
-        rv = 1;
-        goto End;
-    };
-    
-    if (!(bnEphem = BN_bin2bn(&secret.e[0], ec_secret_size, BN_new())))
+    // -- c = H(eQ)
+    if (!secp256k1_ecdh(ctx, &sharedSOut.e[0], &Q, &secret.e[0]))
     {
-        printf("StealthSecret(): bnEphem BN_bin2bn failed.\n");
-        rv = 1;
-        goto End;
-    };
-    
-    if (!(bnQ = BN_bin2bn(&pubkey[0], pubkey.size(), BN_new())))
-    {
-        printf("StealthSecret(): bnQ BN_bin2bn failed\n");
-        rv = 1;
-        goto End;
-    };
-    
-    if (!(Q = EC_POINT_bn2point(ecgrp, bnQ, NULL, bnCtx)))
-    {
-        printf("StealthSecret(): Q EC_POINT_bn2point failed\n");
-        rv = 1;
-        goto End;
-    };
-    
-    // -- eQ
-    // EC_POINT_mul(const EC_GROUP *group, EC_POINT *r, const BIGNUM *n, const EC_POINT *q, const BIGNUM *m, BN_CTX *ctx);
-    // EC_POINT_mul calculates the value generator * n + q * m and stores the result in r. The value n may be NULL in which case the result is just q * m. 
-    if (!EC_POINT_mul(ecgrp, Q, NULL, Q, bnEphem, bnCtx))
-    {
-        printf("StealthSecret(): eQ EC_POINT_mul failed\n");
-        rv = 1;
-        goto End;
-    };
-    
-    if (!(bnOutQ = EC_POINT_point2bn(ecgrp, Q, POINT_CONVERSION_COMPRESSED, BN_new(), bnCtx)))
-    {
-        printf("StealthSecret(): Q EC_POINT_bn2point failed\n");
-        rv = 1;
-        goto End;
-    };
-    
-    
-    vchOutQ.resize(ec_compressed_size);
-    if (BN_num_bytes(bnOutQ) != (int) ec_compressed_size
-        || BN_bn2bin(bnOutQ, &vchOutQ[0]) != (int) ec_compressed_size)
-    {
-        printf("StealthSecret(): bnOutQ incorrect length.\n");
-        rv = 1;
-        goto End;
-    };
-    
-    // SHA256(&vchOutQ[0], vchOutQ.size(), &sharedSOut.e[0]);
-    CSHA256().Write(&vchOutQ[0], vchOutQ.size()).Finalize(&sharedSOut.e[0]);
-    
-    if (!(bnc = BN_bin2bn(&sharedSOut.e[0], ec_secret_size, BN_new())))
-    {
-        printf("StealthSecret(): BN_bin2bn failed\n");
-        rv = 1;
-        goto End;
-    };
-    
-    // -- cG
-    if (!(C = EC_POINT_new(ecgrp)))
-    {
-        printf("StealthSecret(): C EC_POINT_new failed\n");
-        rv = 1;
-        goto End;
-    };
-    
-    if (!EC_POINT_mul(ecgrp, C, bnc, NULL, NULL, bnCtx))
-    {
-        printf("StealthSecret(): C EC_POINT_mul failed\n");
-        rv = 1;
-        goto End;
-    };
-    
-    if (!(bnR = BN_bin2bn(&pkSpend[0], pkSpend.size(), BN_new())))
-    {
-        printf("StealthSecret(): bnR BN_bin2bn failed\n");
-        rv = 1;
-        goto End;
-    };
-    
-    
-    if (!(R = EC_POINT_bn2point(ecgrp, bnR, NULL, bnCtx)))
-    {
-        printf("StealthSecret(): R EC_POINT_bn2point failed\n");
-        rv = 1;
-        goto End;
-    };
-    
-    if (!EC_POINT_mul(ecgrp, C, bnc, NULL, NULL, bnCtx))
-    {
-        printf("StealthSecret(): C EC_POINT_mul failed\n");
-        rv = 1;
-        goto End;
-    };
-    
-    if (!(Rout = EC_POINT_new(ecgrp)))
-    {
-        printf("StealthSecret(): Rout EC_POINT_new failed\n");
-        rv = 1;
-        goto End;
+        printf("StealthSecret(): eQ secp256k1_ecdh failed\n");
+        return 1;
     };
     
-    if (!EC_POINT_add(ecgrp, Rout, R, C, bnCtx))
+    if (PointToPubkey(pkSpend, R) != 0)
     {
-        printf("StealthSecret(): Rout EC_POINT_add failed\n");
-        rv = 1;
-        goto End;
+        printf("StealthSecret(): R secp256k1_ec_pubkey_parse failed\n");
+        return 1;
     };
     
-    if (!(bnOutR = EC_POINT_point2bn(ecgrp, Rout, POINT_CONVERSION_COMPRESSED, BN_new(), bnCtx)))
+    // -- R' = R + cG
+    if (!secp256k1_ec_pubkey_tweak_add(ctx, &R, &sharedSOut.e[0]))
     {
-        printf("StealthSecret(): Rout EC_POINT_bn2point failed\n");
-        rv = 1;
-        goto End;
+        printf("StealthSecret(): R + cG secp256k1_ec_pubkey_tweak_add failed\n");
+        return 1;
     };
     
-    
-    pkOut.resize(ec_compressed_size);
-    if (BN_num_bytes(bnOutR) != (int) ec_compressed_size
-        || BN_bn2bin(bnOutR, &pkOut[0]) != (int) ec_compressed_size)
+    if (PubkeyToPoint(R, pkOut) != 0)
     {
-        printf("StealthSecret(): pkOut incorrect length.\n");
-        rv = 1;
-        goto End;
+        printf("StealthSecret(): pkOut serialize failed.\n");
+        return 1;
     };
     
-    End:
-    if (bnOutR)     BN_free(bnOutR);
-    if (Rout)       EC_POINT_free(Rout);
-    if (R)          EC_POINT_free(R);
-    if (bnR)        BN_free(bnR);
-    if (C)          EC_POINT_free(C);
-    if (bnc)        BN_free(bnc);
-    if (bnOutQ)     BN_free(bnOutQ);
-    if (Q)          EC_POINT_free(Q);
-    if (bnQ)        BN_free(bnQ);
-    if (bnEphem)    BN_free(bnEphem);
-    if (bnCtx)      BN_CTX_free(bnCtx);
-    EC_GROUP_free(ecgrp);
-    
-    return rv;
+    return 0;
 };
 
 
@@ -433,225 +301,36 @@ int StealthSecretSpend(ec_secret& scanSecret, ec_point& ephemPubkey, ec_secret&
          Remember: mod curve.order, pad with 0x00s where necessary?
     */
     
-    int rv = 0;
-    std::vector<uint8_t> vchOutP;
-    
-    BN_CTX* bnCtx           = NULL;
-    BIGNUM* bnScanSecret    = NULL;
-    BIGNUM* bnP             = NULL;
-    EC_POINT* P             = NULL;
-    BIGNUM* bnOutP          = NULL;
-    BIGNUM* bnc             = NULL;
-    BIGNUM* bnOrder         = NULL;
-    BIGNUM* bnSpend         = NULL;
-    
-    EC_GROUP* ecgrp = EC_GROUP_new_by_curve_name(NID_secp256k1);
-    
-    if (!ecgrp)
+    secp256k1_pubkey P;
+    if (PointToPubkey(ephemPubkey, P) != 0)
     {
-        printf("StealthSecretSpend(): EC_GROUP_new_by_curve_name failed.\n");
+        printf("StealthSecretSpend(): P secp256k1_ec_pubkey_parse failed\n");
         return 1;
     };
     
-    if (!(bnCtx = BN_CTX_new()))
-    {
-        printf("StealthSecretSpend(): BN_CTX_new failed.\n");
-        rv = 1;
-        goto End;
-    };
-    
-    if (!(bnScanSecret = BN_bin2bn(&scanSecret.e[0], ec_secret_size, BN_new())))
-    {
-        printf("StealthSecretSpend(): bnScanSecret BN_bin2bn failed.\n");
-        rv = 1;
-        goto End;
-    };
-    
-    if (!(bnP = BN_bin2bn(&ephemPubkey[0], ephemPubkey.size(), BN_new())))
-    {
-        printf("StealthSecretSpend(): bnP BN_bin2bn failed\n");
-        rv = 1;
-        goto End;
-    };
-    
-    if (!(P = EC_POINT_bn2point(ecgrp, bnP, NULL, bnCtx)))
-    {
-        printf("StealthSecretSpend(): P EC_POINT_bn2point failed\n");
-        rv = 1;
-        goto End;
-    };
-    
-    // -- dP
-    if (!EC_POINT_mul(ecgrp, P, NULL, P, bnScanSecret, bnCtx))
-    {
-        printf("StealthSecretSpend(): dP EC_POINT_mul failed\n");
-        rv = 1;
-        goto End;
-    };
-    
-    if (!(bnOutP = EC_POINT_point2bn(ecgrp, P, POINT_CONVERSION_COMPRESSED, BN_new(), bnCtx)))
-    {
-        printf("StealthSecretSpend(): P EC_POINT_bn2point failed\n");
-        rv = 1;
-        goto End;
-    };
-    
-    
-    vchOutP.resize(ec_compressed_size);
-    if (BN_num_bytes(bnOutP) != (int) ec_compressed_size
-        || BN_bn2bin(bnOutP, &vchOutP[0]) != (int) ec_compressed_size)
-    {
-        printf("StealthSecretSpend(): bnOutP incorrect length.\n");
-        rv = 1;
-        goto End;
-    };
-    
-    uint8_t hash1[32];
-    CSHA256().Write(&vchOutP[0], vchOutP.size()).Finalize((uint8_t*)hash1);
-    // SHA256(&vchOutP[0], vchOutP.size(), (uint8_t*)hash1);
-    
-    
-    if (!(bnc = BN_bin2bn(&hash1[0], 32, BN_new())))
-    {
-        printf("StealthSecretSpend(): BN_bin2bn failed\n");
-        rv = 1;
-        goto End;
-    };
-    
-    if (!(bnOrder = BN_new())
-        || !EC_GROUP_get_order(ecgrp, bnOrder, bnCtx))
-    {
-        printf("StealthSecretSpend(): EC_GROUP_get_order failed\n");
-        rv = 1;
-        goto End;
-    };
-    
-    if (!(bnSpend = BN_bin2bn(&spendSecret.e[0], ec_secret_size, BN_new())))
+    // -- c = H(dP)
+    ec_secret c;
+    if (!secp256k1_ecdh(StealthContext(), &c.e[0], &P, &scanSecret.e[0]))
     {
-        printf("StealthSecretSpend(): bnSpend BN_bin2bn failed.\n");
-        rv = 1;
-        goto End;
-    };
-    
-    //if (!BN_add(r, a, b)) return 0;
-    //return BN_nnmod(r, r, m, ctx);
-    if (!BN_mod_add(bnSpend, bnSpend, bnc, bnOrder, bnCtx))
-    {
-        printf("StealthSecretSpend(): bnSpend BN_mod_add failed.\n");
-        rv = 1;
-        goto End;
-    };
-    
-    if (BN_is_zero(bnSpend)) // possible?
-    {
-        printf("StealthSecretSpend(): bnSpend is zero.\n");
-        rv = 1;
-        goto End;
-    };
-    
-    if (BN_num_bytes(bnSpend) != (int) ec_secret_size
-        || BN_bn2bin(bnSpend, &secretOut.e[0]) != (int) ec_secret_size)
-    {
-        printf("StealthSecretSpend(): bnSpend incorrect length.\n");
-        rv = 1;
-        goto End;
+        printf("StealthSecretSpend(): dP secp256k1_ecdh failed\n");
+        return 1;
     };
     
-    End:
-    if (bnSpend)        BN_free(bnSpend);
-    if (bnOrder)        BN_free(bnOrder);
-    if (bnc)            BN_free(bnc);
-    if (bnOutP)         BN_free(bnOutP);
-    if (P)              EC_POINT_free(P);
-    if (bnP)            BN_free(bnP);
-    if (bnScanSecret)   BN_free(bnScanSecret);
-    if (bnCtx)          BN_CTX_free(bnCtx);
-    EC_GROUP_free(ecgrp);
-    
-    return rv;
+    return StealthSharedToSecretSpend(c, spendSecret, secretOut);
 };
 
 
 int StealthSharedToSecretSpend(ec_secret& sharedS, ec_secret& spendSecret, ec_secret& secretOut)
 {
-    
-    int rv = 0;
-    std::vector<uint8_t> vchOutP;
-    
-    BN_CTX* bnCtx           = NULL;
-    BIGNUM* bnc             = NULL;
-    BIGNUM* bnOrder         = NULL;
-    BIGNUM* bnSpend         = NULL;
-    
-    EC_GROUP* ecgrp = EC_GROUP_new_by_curve_name(NID_secp256k1);
-    
-    if (!ecgrp)
+    // -- f + c mod curve.order, fails if the sum is zero
+    memcpy(&secretOut.e[0], &spendSecret.e[0], ec_secret_size);
+    if (!secp256k1_ec_privkey_tweak_add(StealthContext(), &secretOut.e[0], &sharedS.e[0]))
     {
-        printf("StealthSecretSpend(): EC_GROUP_new_by_curve_name failed.\n");
+        printf("StealthSharedToSecretSpend(): secp256k1_ec_privkey_tweak_add failed.\n");
         return 1;
     };
     
-    if (!(bnCtx = BN_CTX_new()))
-    {
-        printf("StealthSecretSpend(): BN_CTX_new failed.\n");
-        rv = 1;
-        goto End;
-    };
-    
-    if (!(bnc = BN_bin2bn(&sharedS.e[0], ec_secret_size, BN_new())))
-    {
-        printf("StealthSecretSpend(): BN_bin2bn failed\n");
-        rv = 1;
-        goto End;
-    };
-    
-    if (!(bnOrder = BN_new())
-        || !EC_GROUP_get_order(ecgrp, bnOrder, bnCtx))
-    {
-        printf("StealthSecretSpend(): EC_GROUP_get_order failed\n");
-        rv = 1;
-        goto End;
-    };
-    
-    if (!(bnSpend = BN_bin2bn(&spendSecret.e[0], ec_secret_size, BN_new())))
-    {
-        printf("StealthSecretSpend(): bnSpend BN_bin2bn failed.\n");
-        rv = 1;
-        goto End;
-    };
-    
-    //if (!BN_add(r, a, b)) return 0;
-    //return BN_nnmod(r, r, m, ctx);
-    if (!BN_mod_add(bnSpend, bnSpend, bnc, bnOrder, bnCtx))
-    {
-        printf("StealthSecretSpend(): bnSpend BN_mod_add failed.\n");
-        rv = 1;
-        goto End;
-    };
-    
-    if (BN_is_zero(bnSpend)) // possible?
-    {
-        printf("StealthSecretSpend(): bnSpend is zero.\n");
-        rv = 1;
-        goto End;
-    };
-    
-    if (BN_num_bytes(bnSpend) != (int) ec_secret_size
-        || BN_bn2bin(bnSpend, &secretOut.e[0]) != (int) ec_secret_size)
-    {
-        printf("StealthSecretSpend(): bnSpend incorrect length.\n");
-        rv = 1;
-        goto End;
-    };
-    
-    End:
-    if (bnSpend)        BN_free(bnSpend);
-    if (bnOrder)        BN_free(bnOrder);
-    if (bnc)            BN_free(bnc);
-    if (bnCtx)          BN_CTX_free(bnCtx);
-    EC_GROUP_free(ecgrp);
-    
-    return rv;
+    return 0;
 };
 
 bool IsStealthAddress(const std::string& encodedAddress)
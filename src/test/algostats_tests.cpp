@@ -0,0 +1,100 @@
+// Copyright (c) 2018-2020 The Verge Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algostats.h>
+#include <chain.h>
+#include <pow.h>
+#include <test/setup_common.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(algostats_tests, BasicTestingSetup)
+
+/** Walk the index the way getnetworkhashps used to */
+static double SlowNetworkHashPS(const CBlockIndex* pindexTip, int algo, int lookup)
+{
+    const CBlockIndex* pb = pindexTip->GetLastOfAlgo(algo);
+    if (pb == nullptr || !pb->nHeight)
+        return 0;
+    if (lookup <= 0)
+        lookup = 2;
+
+    int64_t minTime = pb->GetBlockTime();
+    int64_t maxTime = minTime;
+    arith_uint256 workTotal = GetBlockProof(*pb);
+    for (int i = 0; i < lookup && pb->pprevSameAlgo; i++) {
+        pb = pb->pprevSameAlgo;
+        workTotal += GetBlockProof(*pb);
+        minTime = std::min(pb->GetBlockTime(), minTime);
+        maxTime = std::max(pb->GetBlockTime(), maxTime);
+    }
+    if (minTime == maxTime)
+        return 0;
+    workTotal /= GetAlgoWeight(algo);
+    return workTotal.getdouble() / (maxTime - minTime);
+}
+
+static void BuildChain(std::vector<CBlockIndex>& blocks, CBlockIndex* pindexFork)
+{
+    static const int32_t versions[NUM_ALGOS] = {BLOCK_VERSION_SCRYPT, BLOCK_VERSION_X17, BLOCK_VERSION_LYRA2RE, BLOCK_VERSION_BLAKE, BLOCK_VERSION_GROESTL};
+    for (size_t i = 0; i < blocks.size(); i++) {
+        CBlockIndex* pprev = i ? &blocks[i - 1] : pindexFork;
+        blocks[i].pprev = pprev;
+        blocks[i].nHeight = pprev ? pprev->nHeight + 1 : 0;
+        blocks[i].nVersion = 4 | versions[InsecureRandRange(NUM_ALGOS)];
+        blocks[i].nTime = (pprev ? pprev->nTime : 1412878964) + InsecureRandRange(120);
+        blocks[i].nBits = 0x1e0fffff - InsecureRandRange(0x10000);
+        blocks[i].BuildSkip();
+    }
+}
+
+static void CheckStats(const CAlgoStats& stats, const CBlockIndex* pindexTip)
+{
+    for (int algo = 0; algo < NUM_ALGOS; algo++) {
+        for (int lookup : {-1, 1, 2, 120, ALGO_STATS_WINDOW}) {
+            double dHashPS;
+            BOOST_CHECK(stats.GetNetworkHashPS(algo, lookup, -1, dHashPS));
+            BOOST_CHECK_CLOSE(dHashPS + 1, SlowNetworkHashPS(pindexTip, algo, lookup) + 1, 1e-9);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(algostats_tracks_tip)
+{
+    std::vector<CBlockIndex> vBlocksMain(3000);
+    BuildChain(vBlocksMain, nullptr);
+
+    CAlgoStats stats;
+    double dHashPS;
+    BOOST_CHECK(!stats.GetNetworkHashPS(ALGO_SCRYPT, 120, -1, dHashPS));
+
+    // Connect block by block
+    for (size_t i = 0; i < vBlocksMain.size(); i++)
+        stats.UpdateTip(&vBlocksMain[i]);
+    CheckStats(stats, &vBlocksMain.back());
+
+    // Queries the window cannot answer are left to the caller
+    BOOST_CHECK(!stats.GetNetworkHashPS(ALGO_SCRYPT, ALGO_STATS_WINDOW + 1, -1, dHashPS));
+    BOOST_CHECK(!stats.GetNetworkHashPS(ALGO_SCRYPT, 120, 100, dHashPS));
+    BOOST_CHECK(stats.GetNetworkHashPS(ALGO_SCRYPT, 120, vBlocksMain.back().nHeight, dHashPS));
+
+    // Disconnect a few blocks
+    for (int i = 0; i < 10; i++) {
+        stats.UpdateTip(&vBlocksMain[vBlocksMain.size() - 2 - i]);
+        CheckStats(stats, &vBlocksMain[vBlocksMain.size() - 2 - i]);
+    }
+
+    // Jump to a competing branch
+    std::vector<CBlockIndex> vBlocksSide(500);
+    BuildChain(vBlocksSide, &vBlocksMain[2500]);
+    stats.UpdateTip(&vBlocksSide.back());
+    CheckStats(stats, &vBlocksSide.back());
+
+    stats.Clear();
+    BOOST_CHECK(!stats.GetNetworkHashPS(ALGO_SCRYPT, 120, -1, dHashPS));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -11,10 +11,14 @@
 #include <crypto/sha512.h>
 #include <crypto/hmac_sha256.h>
 #include <crypto/hmac_sha512.h>
+#include <crypto/pow/Lyra2.h>
+#include <crypto/pow/hashx17.h>
+#include <crypto/pow/scrypt.h>
 #include <random.h>
 #include <util/strencodings.h>
 #include <test/setup_common.h>
 
+#include <thread>
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
@@ -563,4 +567,78 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+BOOST_AUTO_TEST_CASE(scrypt_multi)
+{
+    // Cover full batches, padded tails and the one-by-one tail
+    for (int n : {0, 1, 2, 3, 8, 11, 17}) {
+        std::vector<unsigned char> in(80 * n), out1(32 * n), out2(32 * n);
+        std::vector<const char*> pin;
+        std::vector<char*> pout;
+        for (int j = 0; j < 80 * n; ++j) {
+            in[j] = InsecureRandBits(8);
+        }
+        for (int j = 0; j < n; ++j) {
+            scrypt_1024_1_1_256((const char*)&in[80 * j], (char*)&out1[32 * j]);
+            pin.push_back((const char*)&in[80 * j]);
+            pout.push_back((char*)&out2[32 * j]);
+        }
+        scrypt_1024_1_1_256_multi(pin.data(), pout.data(), n);
+        BOOST_CHECK(out1 == out2);
+    }
+}
+
+static void TestLyra2(uint64_t timeCost, uint64_t nRows, uint64_t nCols, const std::string& hexout)
+{
+    unsigned char pwd[32], out[32];
+    for (int i = 0; i < 32; i++)
+        pwd[i] = i;
+    BOOST_CHECK_EQUAL(LYRA2(out, 32, pwd, 32, pwd, 32, timeCost, nRows, nCols), 0);
+    BOOST_CHECK_EQUAL(HexStr(out, out + 32), hexout);
+}
+
+BOOST_AUTO_TEST_CASE(lyra2_testvectors)
+{
+    // Lyra2REv2's 4x4 and Lyra2RE's 8x8 fit in the per-thread workspace, 16x4 goes to the heap
+    TestLyra2(1, 4, 4, "6e30062cecbe4c53612da9305a36d7e89ca9983efcf86498596d1751e718aa73");
+    TestLyra2(1, 8, 8, "6e01bfcf287c2504aefdced7b921743d475ce63c4cfd5bcbc1a901f4fa3c2416");
+    TestLyra2(2, 16, 4, "2965687b45be8c7b9a45ea69d439b0dace27005cf4e3ab63a60d39e015e893d7");
+}
+
+static std::vector<unsigned char> X17Input(int v)
+{
+    std::vector<unsigned char> in(80);
+    for (int i = 0; i < 80; i++)
+        in[i] = i * (v + 3) + v;
+    return in;
+}
+
+BOOST_AUTO_TEST_CASE(x17_testvectors)
+{
+    static const std::string expected[] = {
+        "cdf2066beedb7d5c22a5f5d585e6b1ea191600db14c36a414c8ea1467798066a",
+        "70a5ca7d197b39ece511b29ccf95d2ba572e497960b53a85a5e09be858bd19ae",
+        "c5b36034d648572739384b9e2b16693dcba5286d9da93d220be1f5deb45f5cac",
+    };
+    for (int v = 0; v < 3; v++) {
+        const std::vector<unsigned char> in = X17Input(v);
+        BOOST_CHECK_EQUAL(HashX17(in.begin(), in.end()).GetHex(), expected[v]);
+    }
+
+    // The chain keeps no state between calls, so concurrent hashes must not interfere
+    std::vector<uint256> results(4 * 3 * 50);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([t, &results] {
+            for (int i = 0; i < 3 * 50; i++) {
+                const std::vector<unsigned char> in = X17Input(i % 3);
+                results[t * 3 * 50 + i] = HashX17(in.begin(), in.end());
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    for (size_t i = 0; i < results.size(); i++)
+        BOOST_CHECK_EQUAL(results[i].GetHex(), expected[i % 3]);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -120,4 +120,49 @@ BOOST_AUTO_TEST_CASE(flatfile_flush)
     BOOST_CHECK_EQUAL(fs::file_size(seq.FileName(FlatFilePos(0, 1))), 1);
 }
 
+BOOST_AUTO_TEST_CASE(flatfile_map_pool)
+{
+    auto data_dir = SetDataDir("flatfile_test");
+    FlatFileSeq seq(data_dir, "a", 100);
+    FlatFileMapPool maps(1);
+
+    const char* line1 = "A purely peer-to-peer version of electronic cash would allow online "
+                        "payments to be sent directly from one party to another without going "
+                        "through a financial institution.";
+    const char* line2 = "Digital signatures provide part of the solution, but the main benefits are "
+                        "lost if a trusted third party is still required to prevent double-spending.";
+    size_t pos1 = 0;
+    size_t pos2 = strlen(line1);
+    unsigned char buf[256];
+
+    FILE* file = seq.Open(FlatFilePos(0, pos1));
+    BOOST_REQUIRE(file);
+    fwrite(line1, 1, strlen(line1), file);
+    fflush(file);
+    BOOST_CHECK(maps.Read(seq, FlatFilePos(0, pos1), buf, strlen(line1)));
+    BOOST_CHECK(memcmp(buf, line1, strlen(line1)) == 0);
+
+    // Data appended after the file was mapped is found by mapping it again
+    BOOST_CHECK(!maps.Read(seq, FlatFilePos(0, pos2), buf, 1));
+    fwrite(line2, 1, strlen(line2), file);
+    fclose(file);
+    BOOST_CHECK(maps.Read(seq, FlatFilePos(0, pos2), buf, strlen(line2)));
+    BOOST_CHECK(memcmp(buf, line2, strlen(line2)) == 0);
+
+    // Reading another file unmaps the least recently read one
+    file = seq.Open(FlatFilePos(1, 0));
+    BOOST_REQUIRE(file);
+    fwrite(line2, 1, strlen(line2), file);
+    fclose(file);
+    BOOST_CHECK(maps.Read(seq, FlatFilePos(1, 0), buf, strlen(line2)));
+    BOOST_CHECK(maps.Read(seq, FlatFilePos(0, pos1), buf, strlen(line1)));
+    BOOST_CHECK(memcmp(buf, line1, strlen(line1)) == 0);
+
+    maps.Release(seq.FileName(FlatFilePos(0, 0)));
+    BOOST_CHECK(!maps.Read(seq, FlatFilePos(2, 0), buf, 1));
+
+    // A disabled pool reads nothing
+    BOOST_CHECK(!FlatFileMapPool(0).Read(seq, FlatFilePos(0, pos1), buf, 1));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -0,0 +1,137 @@
+// Copyright (c) 2018-2020 The Verge Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <crypto/pow/scrypt.h>
+#include <primitives/block.h>
+#include <primitives/headerhashcache.h>
+#include <streams.h>
+#include <test/setup_common.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(headerhashcache_tests, BasicTestingSetup)
+
+static uint256 DirectScryptHash(const CBlockHeader& header)
+{
+    uint256 hash;
+    scrypt_1024_1_1_256(BEGIN(header.nVersion), BEGIN(hash));
+    return hash;
+}
+
+BOOST_AUTO_TEST_CASE(lazy_deserialize)
+{
+    const CBlock& genesis = Params().GenesisBlock();
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << genesis.GetBlockHeader();
+
+    HeaderHashCache().Clear();
+    CBlockHeader header;
+    ss >> header;
+    // Nothing is hashed until the hash is asked for
+    BOOST_CHECK(header.hash.IsNull());
+    BOOST_CHECK_EQUAL(HeaderHashCache().Size(), 0U);
+
+    BOOST_CHECK(header.GetHash() == Params().GetConsensus().hashGenesisBlock);
+    BOOST_CHECK(header.GetHash() == DirectScryptHash(header));
+    BOOST_CHECK(header.GetPoWHash(ALGO_SCRYPT) == header.GetHash());
+    BOOST_CHECK_EQUAL(HeaderHashCache().Size(), 1U);
+
+    // The cache is keyed on the header contents, so a modified header is
+    // never served a stale hash
+    header.nNonce++;
+    BOOST_CHECK(header.GetHash() != Params().GetConsensus().hashGenesisBlock);
+    BOOST_CHECK(header.GetHash() == DirectScryptHash(header));
+    BOOST_CHECK_EQUAL(HeaderHashCache().Size(), 2U);
+}
+
+BOOST_AUTO_TEST_CASE(seeded_entries)
+{
+    CBlockHeader header = Params().GenesisBlock().GetBlockHeader();
+    header.nTime++;
+
+    // Entries inserted from the block index are served without hashing
+    uint256 fake = uint256S("0x1234");
+    HeaderHashCache().Clear();
+    HeaderHashCache().Insert(header.GetHeaderCacheKey(), fake);
+    BOOST_CHECK(header.GetHash() == fake);
+    HeaderHashCache().Clear();
+    BOOST_CHECK(header.GetHash() == DirectScryptHash(header));
+}
+
+BOOST_AUTO_TEST_CASE(precompute)
+{
+    // A mixed-algorithm batch, larger than one worker job
+    std::vector<CBlockHeader> headers;
+    const int32_t versions[] = {BLOCK_VERSION_SCRYPT, BLOCK_VERSION_X17, BLOCK_VERSION_LYRA2RE, BLOCK_VERSION_BLAKE, BLOCK_VERSION_GROESTL};
+    for (int i = 0; i < 30; i++) {
+        CBlockHeader header = Params().GenesisBlock().GetBlockHeader();
+        header.hash.SetNull();
+        header.nVersion = 4 | versions[i % 5];
+        header.nNonce = i;
+        headers.push_back(header);
+    }
+
+    HeaderHashCache().Clear();
+    PoWHashCache().Clear();
+
+    // The identity hashes alone, then the proof-of-work hashes as well
+    PrecomputeHeaderHashes(headers, false);
+    BOOST_CHECK_EQUAL(HeaderHashCache().Size(), 30U);
+    BOOST_CHECK_EQUAL(PoWHashCache().Size(), 0U);
+    PrecomputeHeaderHashes(headers);
+    BOOST_CHECK_EQUAL(HeaderHashCache().Size(), 30U);
+    BOOST_CHECK_EQUAL(PoWHashCache().Size(), 24U);
+
+    uint256 hash;
+    for (const CBlockHeader& header : headers) {
+        BOOST_CHECK(HeaderHashCache().Lookup(header.GetHeaderCacheKey(), hash));
+        BOOST_CHECK(hash == DirectScryptHash(header));
+        if (header.GetAlgo() == ALGO_SCRYPT) {
+            BOOST_CHECK(!PoWHashCache().Lookup(header.GetHeaderCacheKey(), hash));
+        } else {
+            // The cached proof-of-work hashes match hashing from scratch
+            BOOST_CHECK(PoWHashCache().Lookup(header.GetHeaderCacheKey(), hash));
+            BOOST_CHECK(hash == header.GetPoWHash(header.GetAlgo()));
+        }
+    }
+
+    // Already known headers are not queued again
+    PrecomputeHeaderHashes(headers);
+    BOOST_CHECK_EQUAL(HeaderHashCache().Size(), 30U);
+    BOOST_CHECK_EQUAL(PoWHashCache().Size(), 24U);
+}
+
+BOOST_AUTO_TEST_CASE(eviction)
+{
+    CHeaderHashCache cache(3 * CHeaderHashCache::ENTRY_BYTES);
+    BOOST_CHECK_EQUAL(cache.MaxEntries(), 3U);
+
+    std::vector<uint256> keys;
+    for (int i = 0; i < 5; i++) {
+        keys.push_back(InsecureRand256());
+        cache.Insert(keys.back(), keys.back());
+    }
+    BOOST_CHECK_EQUAL(cache.Size(), 3U);
+
+    // Oldest entries go first
+    uint256 hash;
+    BOOST_CHECK(!cache.Lookup(keys[0], hash));
+    BOOST_CHECK(!cache.Lookup(keys[1], hash));
+    for (int i = 2; i < 5; i++) {
+        BOOST_CHECK(cache.Lookup(keys[i], hash));
+        BOOST_CHECK(hash == keys[i]);
+    }
+
+    cache.SetMaxSize(CHeaderHashCache::ENTRY_BYTES);
+    BOOST_CHECK_EQUAL(cache.Size(), 1U);
+    BOOST_CHECK(cache.Lookup(keys[4], hash));
+
+    cache.SetMaxSize(0);
+    cache.Insert(keys[0], keys[0]);
+    BOOST_CHECK_EQUAL(cache.Size(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,157 @@
+// Copyright (c) 2018-2020 The Verge Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <consensus/merkle.h>
+#include <consensus/validation.h>
+#include <fs.h>
+#include <index/txindex.h>
+#include <miner.h>
+#include <pow.h>
+#include <script/standard.h>
+#include <streams.h>
+#include <test/setup_common.h>
+#include <util/system.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(loadblock_tests)
+
+/** Mine nBlocks blocks on a test chain and return them in chain order */
+static std::vector<CBlock> MakeBlocks(int nBlocks)
+{
+    TestChain100Setup setup;
+    while (chainActive.Height() < nBlocks)
+        setup.CreateAndProcessBlock({}, GetScriptForRawPubKey(setup.coinbaseKey.GetPubKey()));
+
+    std::vector<CBlock> blocks(nBlocks);
+    for (int nHeight = 1; nHeight <= nBlocks; nHeight++)
+        BOOST_REQUIRE(ReadBlockFromDisk(blocks[nHeight - 1], chainActive[nHeight], Params().GetConsensus()));
+    return blocks;
+}
+
+/** Write a block record as the block files hold it, with only nKeep bytes of the block if given */
+static void WriteBlockRecord(CAutoFile& file, const CBlock& block, size_t nKeep = 0)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << block;
+    unsigned int nSize = ss.size();
+    file << Params().MessageStart() << nSize;
+    file.write(ss.data(), nKeep ? nKeep : ss.size());
+}
+
+// A record that ends before its size field says, in the middle of a batch
+// and while the next batch is read ahead, makes the import resync; the blocks
+// after it still load.
+BOOST_AUTO_TEST_CASE(loadblock_truncated_record)
+{
+    const int nBlocks = IMPORT_BATCH_BLOCKS + 44;
+    const int nTruncated = IMPORT_BATCH_BLOCKS / 2;
+    const std::vector<CBlock> blocks = MakeBlocks(nBlocks);
+
+    TestingSetup setup(CBaseChainParams::REGTEST);
+    const fs::path path = GetDataDir() / "bootstrap.dat";
+    {
+        CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        BOOST_REQUIRE(!file.IsNull());
+        for (int nHeight = 1; nHeight <= nBlocks; nHeight++) {
+            const CBlock& block = blocks[nHeight - 1];
+            if (nHeight == nTruncated)
+                WriteBlockRecord(file, block, ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION) / 2);
+            WriteBlockRecord(file, block);
+        }
+    }
+
+    BOOST_CHECK(LoadExternalBlockFile(Params(), fsbridge::fopen(path, "rb")));
+    CValidationState state;
+    BOOST_CHECK(ActivateBestChain(state, Params()));
+
+    LOCK(cs_main);
+    BOOST_CHECK_EQUAL(chainActive.Height(), nBlocks);
+    BOOST_CHECK(chainActive.Tip()->GetBlockHash() == blocks.back().GetHash());
+}
+
+// With -blockcompression a block is stored as an LZ4 record. It reads back
+// through its index entry, a txindex finds its transaction, and importing
+// the block file takes it in again.
+BOOST_AUTO_TEST_CASE(loadblock_compressed)
+{
+    const fs::path path = fs::temp_directory_path() / fs::unique_path("loadblock_compressed_%%%%%%%%.dat");
+    CBlock block;
+    {
+        TestChain100Setup setup;
+        const CChainParams& chainparams = Params();
+
+        // A coinbase with a long run of zeros next to the output paying the signing key
+        std::unique_ptr<CBlockTemplate> pblocktemplate = BlockAssembler(chainparams).CreateNewBlock(GetScriptForRawPubKey(setup.coinbaseKey.GetPubKey()));
+        block = pblocktemplate->block;
+        {
+            LOCK(cs_main);
+            unsigned int extraNonce = 0;
+            IncrementExtraNonce(&block, chainActive.Tip(), extraNonce);
+        }
+        CMutableTransaction coinbase(*block.vtx[0]);
+        coinbase.vout.emplace_back(0, CScript() << OP_RETURN << std::vector<unsigned char>(4000, 0));
+        block.vtx[0] = MakeTransactionRef(std::move(coinbase));
+        block.hashMerkleRoot = BlockMerkleRoot(block);
+        while (!CheckProofOfWork(block.GetPoWHash(block.GetAlgo()), block.nBits, chainparams.GetConsensus())) ++block.nNonce;
+        BOOST_REQUIRE(SignBlock(block, setup.keystore));
+
+        fBlockCompression = true;
+        BOOST_CHECK(ProcessNewBlock(chainparams, std::make_shared<const CBlock>(block), true, nullptr));
+        fBlockCompression = DEFAULT_BLOCK_COMPRESSION;
+
+        FlatFilePos pos;
+        {
+            LOCK(cs_main);
+            BOOST_REQUIRE(chainActive.Tip()->GetBlockHash() == block.GetHash());
+            pos = chainActive.Tip()->GetBlockPos();
+            BOOST_CHECK(GetBlockFileInfo(pos.nFile)->nFlags & CBlockFileInfo::BLOCK_FILE_COMPRESSED);
+        }
+        {
+            CAutoFile file(OpenBlockFile(FlatFilePos(pos.nFile, pos.nPos - 4), true), SER_DISK, CLIENT_VERSION);
+            uint32_t nSize;
+            file >> nSize;
+            BOOST_CHECK(nSize & BLOCK_RECORD_COMPRESSED);
+            BOOST_CHECK((nSize & ~BLOCK_RECORD_COMPRESSED) < ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION));
+        }
+
+        CBlock read;
+        BOOST_CHECK(ReadBlockFromDisk(read, chainActive.Tip(), chainparams.GetConsensus()));
+        BOOST_CHECK(read.GetHash() == block.GetHash());
+        BOOST_CHECK(read.vtx[0]->GetHash() == block.vtx[0]->GetHash());
+
+        TxIndex txindex(1 << 20, true);
+        txindex.Start();
+        const int64_t time_start = GetTimeMillis();
+        while (!txindex.BlockUntilSyncedToCurrentChain()) {
+            BOOST_REQUIRE(time_start + 10 * 1000 > GetTimeMillis());
+            MilliSleep(100);
+        }
+        uint256 block_hash;
+        CTransactionRef tx_disk;
+        BOOST_CHECK(txindex.FindTx(block.vtx[0]->GetHash(), block_hash, tx_disk));
+        BOOST_CHECK(block_hash == block.GetHash());
+        BOOST_CHECK(tx_disk && tx_disk->GetHash() == block.vtx[0]->GetHash());
+        txindex.Stop();
+
+        fs::copy_file(GetBlocksDir() / "blk00000.dat", path);
+    }
+
+    TestingSetup setup(CBaseChainParams::REGTEST);
+    BOOST_CHECK(LoadExternalBlockFile(Params(), fsbridge::fopen(path, "rb")));
+    fs::remove(path);
+    CValidationState state;
+    BOOST_CHECK(ActivateBestChain(state, Params()));
+
+    LOCK(cs_main);
+    BOOST_CHECK(chainActive.Tip()->GetBlockHash() == block.GetHash());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,73 @@
+// Copyright (c) 2018-2020 The Verge Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <rawblockcache.h>
+
+#include <chainparams.h>
+#include <streams.h>
+#include <test/setup_common.h>
+#include <validation.h>
+#include <version.h>
+
+#include <memory>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(rawblockcache_tests, TestingSetup)
+
+static CRawBlockCache::RawBlock RawBlock(size_t nSize)
+{
+    return std::make_shared<const std::vector<uint8_t>>(nSize, 0);
+}
+
+BOOST_AUTO_TEST_CASE(least_recently_used)
+{
+    CRawBlockCache cache(3000);
+    CRawBlockCache::RawBlock block;
+    cache.Insert(uint256S("0x1"), RawBlock(1000));
+    cache.Insert(uint256S("0x2"), RawBlock(1000));
+    cache.Insert(uint256S("0x3"), RawBlock(1000));
+    BOOST_CHECK_EQUAL(cache.Size(), 3000U);
+
+    // Looking a block up keeps it over blocks inserted later
+    BOOST_CHECK(cache.Lookup(uint256S("0x1"), block));
+    cache.Insert(uint256S("0x4"), RawBlock(1000));
+    BOOST_CHECK(cache.Lookup(uint256S("0x1"), block));
+    BOOST_CHECK(!cache.Lookup(uint256S("0x2"), block));
+    BOOST_CHECK(cache.Lookup(uint256S("0x4"), block));
+
+    // A block larger than the cache is not kept, and shrinking evicts
+    cache.Insert(uint256S("0x5"), RawBlock(4000));
+    BOOST_CHECK(!cache.Lookup(uint256S("0x5"), block));
+    cache.SetMaxSize(1500);
+    BOOST_CHECK_EQUAL(cache.Size(), 1000U);
+    BOOST_CHECK(cache.Lookup(uint256S("0x4"), block));
+    cache.Clear();
+    BOOST_CHECK_EQUAL(cache.Size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(raw_block_matches_serialization)
+{
+    const CBlockIndex* pgenesis;
+    {
+        LOCK(cs_main);
+        pgenesis = chainActive.Genesis();
+    }
+    BOOST_REQUIRE(pgenesis);
+
+    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+    ssBlock << Params().GenesisBlock();
+
+    // Read from disk first, then served from the cache
+    RawBlockCache().Clear();
+    for (int i = 0; i < 2; i++) {
+        std::shared_ptr<const std::vector<uint8_t>> block_data;
+        BOOST_CHECK(ReadRawBlockFromDisk(block_data, pgenesis, Params().MessageStart()));
+        BOOST_CHECK(std::vector<uint8_t>(ssBlock.begin(), ssBlock.end()) == *block_data);
+        BOOST_CHECK_EQUAL(RawBlockCache().Size(), ssBlock.size());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
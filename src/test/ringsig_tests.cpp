@@ -0,0 +1,162 @@
+// Copyright (c) 2018-2020 The Verge Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <ringsig.h>
+
+#include <pubkey.h>
+#include <test/setup_common.h>
+#include <uint256.h>
+#include <util/strencodings.h>
+
+#include <string.h>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(ringsig_tests, BasicTestingSetup)
+
+/** The public keys of a ring, one of which we hold the secret for */
+struct TestRing
+{
+    std::vector<ec_secret> vSecrets;
+    std::vector<uint8_t> vPubkeys;
+
+    explicit TestRing(int nRingSize) : vSecrets(nRingSize), vPubkeys(nRingSize * ec_compressed_size)
+    {
+        for (int i = 0; i < nRingSize; ++i) {
+            ec_point pubkey;
+            BOOST_CHECK(GenerateRandomSecret(vSecrets[i]) == 0);
+            BOOST_CHECK(SecretToPublicKey(vSecrets[i], pubkey) == 0);
+            memcpy(&vPubkeys[i * ec_compressed_size], pubkey.data(), ec_compressed_size);
+        }
+    }
+
+    ec_point Pubkey(int i) const
+    {
+        return ec_point(vPubkeys.begin() + i * ec_compressed_size, vPubkeys.begin() + (i + 1) * ec_compressed_size);
+    }
+
+    ec_point KeyImage(int i) const
+    {
+        ec_point pubkey = Pubkey(i), keyImage;
+        BOOST_CHECK(generateKeyImage(pubkey, vSecrets[i], keyImage) == 0);
+        return keyImage;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(ringsig_key_image)
+{
+    // Generated with the former OpenSSL implementation
+    ec_secret secret;
+    std::vector<uint8_t> v = ParseHex("9bfb68d2b78149f3798f35b959325e734df15357e913c5a3989a89a447f66b0b");
+    memcpy(secret.e, v.data(), ec_secret_size);
+
+    ec_point pubkey, keyImage;
+    BOOST_CHECK(SecretToPublicKey(secret, pubkey) == 0);
+    BOOST_CHECK_EQUAL(HexStr(pubkey), "0390dff441e5889f69144cfc525d87085c1c6cd7e88a2cf417d8fdd186a8ec44ce");
+    BOOST_CHECK(generateKeyImage(pubkey, secret, keyImage) == 0);
+    BOOST_CHECK_EQUAL(HexStr(keyImage), "02f59948ae8330031f0b57b4de8c9c9be0826a76cf02675209611d314fa08930f8");
+
+    CPubKey cpk(pubkey);
+    BOOST_CHECK(getOldKeyImage(cpk, keyImage) == 0);
+    BOOST_CHECK_EQUAL(HexStr(keyImage), "02ea4b164d2a6e945fb3d2554c1df9c93846bd8329afbf402017cfc40af9748fca");
+
+    ec_point invalid(ec_uncompressed_size, 0x04);
+    BOOST_CHECK(generateKeyImage(invalid, secret, keyImage) != 0);
+}
+
+BOOST_AUTO_TEST_CASE(ringsig_sign_verify)
+{
+    for (int nRingSize : {2, 3, 10, 32}) {
+        TestRing ring(nRingSize);
+        for (int nSecretOffset : {0, nRingSize / 2, nRingSize - 1}) {
+            ec_point keyImage = ring.KeyImage(nSecretOffset);
+            uint256 txnHash = InsecureRand256();
+
+            std::vector<uint8_t> vSigc(nRingSize * ec_secret_size), vSigr(nRingSize * ec_secret_size);
+            BOOST_CHECK(generateRingSignature(keyImage, txnHash, nRingSize, nSecretOffset, ring.vSecrets[nSecretOffset], ring.vPubkeys.data(), vSigc.data(), vSigr.data()) == 0);
+            BOOST_CHECK_EQUAL(verifyRingSignature(keyImage, txnHash, nRingSize, ring.vPubkeys.data(), vSigc.data(), vSigr.data()), 0);
+
+            data_chunk sigC;
+            std::vector<uint8_t> vSigS(nRingSize * ec_secret_size);
+            BOOST_CHECK(generateRingSignatureAB(keyImage, txnHash, nRingSize, nSecretOffset, ring.vSecrets[nSecretOffset], ring.vPubkeys.data(), sigC, vSigS.data()) == 0);
+            BOOST_CHECK_EQUAL(verifyRingSignatureAB(keyImage, txnHash, nRingSize, ring.vPubkeys.data(), sigC, vSigS.data()), 0);
+
+            // Another transaction, key image or signature byte
+            uint256 otherHash = InsecureRand256();
+            BOOST_CHECK_EQUAL(verifyRingSignature(keyImage, otherHash, nRingSize, ring.vPubkeys.data(), vSigc.data(), vSigr.data()), 2);
+
+            ec_point otherImage = ring.KeyImage((nSecretOffset + 1) % nRingSize);
+            BOOST_CHECK_EQUAL(verifyRingSignature(otherImage, txnHash, nRingSize, ring.vPubkeys.data(), vSigc.data(), vSigr.data()), 2);
+            BOOST_CHECK_EQUAL(verifyRingSignatureAB(otherImage, txnHash, nRingSize, ring.vPubkeys.data(), sigC, vSigS.data()), 2);
+
+            vSigr[InsecureRandRange(vSigr.size())] ^= 1;
+            BOOST_CHECK_EQUAL(verifyRingSignature(keyImage, txnHash, nRingSize, ring.vPubkeys.data(), vSigc.data(), vSigr.data()), 2);
+            vSigS[InsecureRandRange(vSigS.size())] ^= 1;
+            BOOST_CHECK_EQUAL(verifyRingSignatureAB(keyImage, txnHash, nRingSize, ring.vPubkeys.data(), sigC, vSigS.data()), 2);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ringsig_batch)
+{
+    // Signatures of different transactions over rings drawn from the same keys
+    const int nRingSize = 8;
+    TestRing keys(20);
+
+    std::vector<std::vector<uint8_t>> vRings, vSigc, vSigr;
+    std::vector<data_chunk> vKeyImages, vSigC;
+    std::vector<uint256> vTxnHashes;
+    CRingSigBatch batch;
+    for (int n = 0; n < 10; ++n) {
+        std::vector<uint8_t> ring;
+        int nSecretOffset = InsecureRandRange(nRingSize), nSigner = 0;
+        for (int i = 0; i < nRingSize; ++i) {
+            int k = (n + 2 * i) % 20;
+            if (i == nSecretOffset)
+                nSigner = k;
+            ring.insert(ring.end(), keys.vPubkeys.begin() + k * ec_compressed_size, keys.vPubkeys.begin() + (k + 1) * ec_compressed_size);
+        }
+        vRings.push_back(ring);
+        vKeyImages.push_back(keys.KeyImage(nSigner));
+        vTxnHashes.push_back(InsecureRand256());
+        vSigc.emplace_back(nRingSize * ec_secret_size);
+        vSigr.emplace_back(nRingSize * ec_secret_size);
+        vSigC.emplace_back();
+        if (n % 2 == 0) {
+            BOOST_CHECK(generateRingSignature(vKeyImages[n], vTxnHashes[n], nRingSize, nSecretOffset, keys.vSecrets[nSigner], vRings[n].data(), vSigc[n].data(), vSigr[n].data()) == 0);
+        } else {
+            BOOST_CHECK(generateRingSignatureAB(vKeyImages[n], vTxnHashes[n], nRingSize, nSecretOffset, keys.vSecrets[nSigner], vRings[n].data(), vSigC[n], vSigr[n].data()) == 0);
+        }
+    }
+
+    for (int n = 0; n < 10; ++n) {
+        if (n % 2 == 0)
+            batch.Add(vKeyImages[n], vTxnHashes[n], nRingSize, vRings[n].data(), vSigc[n].data(), vSigr[n].data());
+        else
+            batch.AddAB(vKeyImages[n], vTxnHashes[n], nRingSize, vRings[n].data(), vSigC[n], vSigr[n].data());
+    }
+    BOOST_CHECK_EQUAL(batch.size(), 10U);
+
+    std::vector<int> vResults;
+    BOOST_CHECK(batch.Verify(vResults));
+    BOOST_CHECK(vResults == std::vector<int>(10, 0));
+
+    // One bad signature fails the batch, and only that entry
+    vSigr[3][0] ^= 1;
+    vRings[6][1] ^= 1;
+    BOOST_CHECK(!batch.Verify(vResults));
+    std::vector<int> vExpected(10, 0);
+    vExpected[3] = 2;
+    BOOST_CHECK(vResults[3] == 2);
+    BOOST_CHECK(vResults[6] != 0);
+    vResults[6] = 0;
+    BOOST_CHECK(vResults == vExpected);
+
+    batch.clear();
+    BOOST_CHECK(batch.Verify(vResults));
+    BOOST_CHECK(vResults.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
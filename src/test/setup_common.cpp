@@ -8,6 +8,9 @@
 #include <chainparams.h>
 #include <consensus/consensus.h>
 #include <consensus/validation.h>
+#include <crypto/pow/Lyra2.h>
+#include <crypto/pow/hashx17.h>
+#include <crypto/pow/scrypt.h>
 #include <crypto/sha256.h>
 #include <validation.h>
 #include <miner.h>
@@ -50,6 +53,9 @@ BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
 	: m_path_root(fs::temp_directory_path() / "test_verge" / strprintf("%lu_%i", (unsigned long)GetTime(), (int)(InsecureRandRange(1 << 30))))
 {
     SHA256AutoDetect();
+    scrypt_detect_multi();
+    LYRA2_detect();
+    x17_detect();
     RandomInit();
     ECC_Start();
     SetupEnvironment();
@@ -108,6 +114,8 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
     nScriptCheckThreads = 3;
     for (int i=0; i < nScriptCheckThreads-1; i++)
         threadGroup.create_thread(&ThreadScriptCheck);
+    for (int i=0; i < nScriptCheckThreads-1; i++)
+        threadGroup.create_thread(&ThreadWorkerJobs);
     
     g_connman = std::unique_ptr<CConnman>(new CConnman(0x1337, 0x1337)); // Deterministic randomness for tests.
     connman = g_connman.get();
@@ -44,6 +44,46 @@ BOOST_AUTO_TEST_CASE(skiplist_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(skiplist_same_algo_test)
+{
+    static const int32_t versions[NUM_ALGOS] = {BLOCK_VERSION_SCRYPT, BLOCK_VERSION_X17, BLOCK_VERSION_LYRA2RE, BLOCK_VERSION_BLAKE, BLOCK_VERSION_GROESTL};
+    std::vector<CBlockIndex> vIndex(SKIPLIST_LENGTH / 10);
+    std::vector<std::vector<CBlockIndex*>> vByAlgo(NUM_ALGOS);
+
+    for (size_t i = 0; i < vIndex.size(); i++) {
+        // The first blocks are all scrypt, as before the multi-algo fork
+        int algo = i < 1000 ? ALGO_SCRYPT : InsecureRandRange(NUM_ALGOS);
+        vIndex[i].nHeight = i;
+        vIndex[i].nVersion = 4 | versions[algo];
+        vIndex[i].pprev = (i == 0) ? nullptr : &vIndex[i - 1];
+        vIndex[i].BuildSkip();
+        vByAlgo[algo].push_back(&vIndex[i]);
+    }
+
+    for (int algo = 0; algo < NUM_ALGOS; algo++) {
+        const std::vector<CBlockIndex*>& chain = vByAlgo[algo];
+        for (size_t n = 0; n < chain.size(); n++) {
+            BOOST_CHECK_EQUAL(chain[n]->GetAlgo(), algo);
+            BOOST_CHECK_EQUAL(chain[n]->nAlgoHeight, (int)n);
+            BOOST_CHECK(chain[n]->pprevSameAlgo == (n ? chain[n - 1] : nullptr));
+            if (n > 0)
+                BOOST_CHECK(chain[n]->pskipSameAlgo == chain[chain[n]->pskipSameAlgo->nAlgoHeight]);
+        }
+        BOOST_CHECK(vIndex.back().GetLastOfAlgo(algo) == chain.back());
+    }
+    BOOST_CHECK(vIndex[999].GetLastOfAlgo(ALGO_X17) == nullptr);
+
+    for (int i = 0; i < 1000; i++) {
+        const std::vector<CBlockIndex*>& chain = vByAlgo[InsecureRandRange(NUM_ALGOS)];
+        int from = InsecureRandRange(chain.size());
+        int to = InsecureRandRange(from + 1);
+
+        BOOST_CHECK(chain.back()->GetAncestorSameAlgo(from) == chain[from]);
+        BOOST_CHECK(chain[from]->GetAncestorSameAlgo(to) == chain[to]);
+        BOOST_CHECK(chain[from]->GetAncestorSameAlgo(from + 1) == nullptr);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(getlocator_test)
 {
     // Build a main chain 100000 blocks long.
@@ -2,6 +2,9 @@
 #include <util/strencodings.h>
 #include <stealth.h>
 
+#include <assert.h>
+#include <string.h>
+
 
 BOOST_AUTO_TEST_SUITE(stealth_tests)
 
@@ -21,4 +24,119 @@ BOOST_AUTO_TEST_CASE(stealth_key)
 
 }
 
+static ec_secret ParseSecret(const char* hex)
+{
+    ec_secret secret;
+    std::vector<uint8_t> v = ParseHex(hex);
+    assert(v.size() == ec_secret_size);
+    memcpy(&secret.e[0], v.data(), ec_secret_size);
+    return secret;
+}
+
+struct StealthVector
+{
+    const char *scan_secret, *spend_secret, *ephem_secret;
+    const char *scan_pubkey, *spend_pubkey, *ephem_pubkey;
+    const char *shared_secret, *pubkey_out, *secret_out;
+};
+
+// Generated with the former OpenSSL implementation
+static const StealthVector stealth_vectors[] = {
+    {"c24fcdc7d3906b8573ecd78e84739e004c789bcd3ba762742817ef75ffedaedb",
+     "c8515896baadd0d18953d0c1fb91cb2d41990ebf6b8d35f6c41d3350a3cb3936",
+     "8a2dfdc108f397d5e8004279444152d17dea3731766041c68811e6c31f5e789b",
+     "03d7c0e452ff0eddfd40e84c03085bf7d37da3aca25f49cda73b3056877a3b8a1b",
+     "02e5243cb87254bcafab035d611a94e416d5e0af14ba3d9d3d7156d1c317fc6e3f",
+     "02486f0b6c5bc3cc3eb05283d92edd1a710b97e20e1eeb2b41635caa96e0906965",
+     "4a28505bf0a8102e28e47deacdcb8a704ad3785fb2beaf21047ed15c37384c01",
+     "02d1f2831bdd60997f18d10204c21dcc0c583e1606fa2a5e18a972b43c604ddcff",
+     "1279a8f2ab55e0ffb2384eacc95d559ed1bdaa386f0344dc08c9a6200acd43f6"},
+    {"ba7fa7fcff542c44d0adfaf26d76502a15477abd644be4af28951111aa1e9f8f",
+     "fa058b7d550c200efe82b9b99eb9552ee899f8a380594a5f050b83afff058d6d",
+     "b9d90094c053ce3cc8ac231db0df2b5ed3c44d7f11c843b729a840a2f1d5e560",
+     "02f6fd247eff8f178ff94270940196eff28ef83e94ba430f30a5244f25b1828548",
+     "03680ea55beaa61a6371817f9c3be3abf55a9404e9770f9bd56872e93f3b2dc3d5",
+     "02822d2a7266f74479eb7417e8b625ef7da0d6e618c70351c2c7baa15057fad9bd",
+     "3bdee9cf605f7c1a20808460b85ed298b39231e051f445229755d8fad043b095",
+     "0200a36a2ae032ff6b0ecf2b1073e6c807f280cbe1f20ce681fdd746b114ddc4eb",
+     "35e4754cb56b9c291f033e1a571827c8e17d4d9d2304ef45dc8efe1dff12fcc1"},
+    {"7eba286d4334d0f93d323766244a3a5ef11a6e138260c7b4aabc6655c87290fb",
+     "05653754f60e365d5bb3b56dbfe168d14b9531674f5a521fde13694a8e045cab",
+     "d1b4ae93328fda2d39a77abf524d2a0cba7b4c755cc89ef8542ee835d3bde650",
+     "0205faf3877b4b96fe5219e04d3a2ef725dbbdb18ade389b201a62d1d2db6ef8ff",
+     "0279dd5fa065642544283a95e6cb2d7bc16def9b8cf3ab31ed930bcbf8c25b643e",
+     "031226c355a27f8abace20085d7f75e3e2e644ca5f2e58364b254b45bd6eefc76f",
+     "371cbb559049c0e12e539d27fe951d974b1bd4f14c7119a942650bd86a56a7d4",
+     "02599e9fe38570cc1f54272c7d08802530b298aa3c61ce0ea6c9e0d9a666f662c7",
+     "3c81f2aa8657f73e8a075295be76866896b106589bcb6bc920787522f85b047f"},
+    // The spend secret derived starts with a zero byte, which the OpenSSL code rejected
+    {"9b3e9e78d8ab6e07c01589c066a9aecf0c1509679a32308fb3f70822a52a2c70",
+     "de7b58f374a88fd3c96f965e84728b2b8f069fa3c09f51412f1cdf0aa754c667",
+     "c08065c67fb855ff49003181b6a64ead8757761ca472263bde8637c1f7beecc6",
+     "03f6b1447a24b922545d716bab8a1f96b63d62380a57a3e3d71f6995b5ca84cf38",
+     "02ae2aaa68cf59622dd073b6921d68f8520c45740c3672c4abedb570417f24e928",
+     "038991458bf60252fce6abafe5e1882ef8edc843801e86e19b8d0aca3a457ce440",
+     "21892902bd3027dac9cb132bf44f38a952c05b129aa43b72cc69395766570dcc",
+     "0251fdf46051f23e4447cd1c5b3caa5956ac9becba5d5a68bbd3e910a0e46674a3",
+     "000481f631d8b7ae933aa98a78c1c3d627181dcfabfaec783bb3b9d53d7592f2"},
+};
+
+BOOST_AUTO_TEST_CASE(stealth_secret_vectors)
+{
+    for (const StealthVector& v : stealth_vectors) {
+        ec_secret scan_secret = ParseSecret(v.scan_secret);
+        ec_secret spend_secret = ParseSecret(v.spend_secret);
+        ec_secret ephem_secret = ParseSecret(v.ephem_secret);
+
+        ec_point scan_pubkey, spend_pubkey, ephem_pubkey;
+        BOOST_CHECK(SecretToPublicKey(scan_secret, scan_pubkey) == 0);
+        BOOST_CHECK(SecretToPublicKey(spend_secret, spend_pubkey) == 0);
+        BOOST_CHECK(SecretToPublicKey(ephem_secret, ephem_pubkey) == 0);
+        BOOST_CHECK_EQUAL(HexStr(scan_pubkey), v.scan_pubkey);
+        BOOST_CHECK_EQUAL(HexStr(spend_pubkey), v.spend_pubkey);
+        BOOST_CHECK_EQUAL(HexStr(ephem_pubkey), v.ephem_pubkey);
+
+        // Sender side
+        ec_secret shared;
+        ec_point pubkey_out;
+        BOOST_CHECK(StealthSecret(ephem_secret, scan_pubkey, spend_pubkey, shared, pubkey_out) == 0);
+        BOOST_CHECK_EQUAL(HexStr(shared.e, shared.e + ec_secret_size), v.shared_secret);
+        BOOST_CHECK_EQUAL(HexStr(pubkey_out), v.pubkey_out);
+
+        // Receiver side, scanning then spending
+        ec_secret shared_recv;
+        ec_point pubkey_recv;
+        BOOST_CHECK(StealthSecret(scan_secret, ephem_pubkey, spend_pubkey, shared_recv, pubkey_recv) == 0);
+        BOOST_CHECK_EQUAL(HexStr(shared_recv.e, shared_recv.e + ec_secret_size), v.shared_secret);
+        BOOST_CHECK_EQUAL(HexStr(pubkey_recv), v.pubkey_out);
+
+        ec_secret secret_out;
+        BOOST_CHECK(StealthSecretSpend(scan_secret, ephem_pubkey, spend_secret, secret_out) == 0);
+        BOOST_CHECK_EQUAL(HexStr(secret_out.e, secret_out.e + ec_secret_size), v.secret_out);
+
+        ec_secret secret_shared_out;
+        BOOST_CHECK(StealthSharedToSecretSpend(shared, spend_secret, secret_shared_out) == 0);
+        BOOST_CHECK_EQUAL(HexStr(secret_shared_out.e, secret_shared_out.e + ec_secret_size), v.secret_out);
+
+        ec_point pubkey_spend;
+        BOOST_CHECK(SecretToPublicKey(secret_out, pubkey_spend) == 0);
+        BOOST_CHECK(pubkey_spend == pubkey_out);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(stealth_secret_invalid)
+{
+    ec_secret zero;
+    memset(zero.e, 0, sizeof(zero.e));
+    ec_point pubkey;
+    BOOST_CHECK(SecretToPublicKey(zero, pubkey) != 0);
+
+    ec_secret secret = ParseSecret(stealth_vectors[0].scan_secret), shared;
+    ec_point bad_point(ec_compressed_size, 0x05), empty, out;
+    ec_point spend_pubkey = ParseHex(stealth_vectors[0].spend_pubkey);
+    BOOST_CHECK(StealthSecret(secret, bad_point, spend_pubkey, shared, out) != 0);
+    BOOST_CHECK(StealthSecret(secret, empty, spend_pubkey, shared, out) != 0);
+    BOOST_CHECK(StealthSecretSpend(secret, bad_point, secret, shared) != 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -10,6 +10,7 @@
 #include <sync.h>
 #include <util/strencodings.h>
 #include <util/moneystr.h>
+#include <util/mappedfile.h>
 #include <test/setup_common.h>
 
 #include <stdint.h>
@@ -1196,6 +1197,42 @@ BOOST_AUTO_TEST_CASE(test_DirIsWritable)
     fs::remove(tmpdirname);
 }
 
+BOOST_AUTO_TEST_CASE(test_MappedFile)
+{
+    fs::path path = SetDataDir("test_MappedFile") / "mapped.dat";
+    CMappedFile mapped;
+    BOOST_CHECK(!mapped.Open(path));
+    BOOST_CHECK(!mapped.IsOpen());
+
+    FILE* file = fsbridge::fopen(path, "wb");
+    BOOST_REQUIRE(file);
+    fclose(file);
+    BOOST_CHECK(mapped.Open(path));
+    BOOST_CHECK_EQUAL(mapped.size(), 0U);
+
+    // Appended data shows up after Remap()
+    file = fsbridge::fopen(path, "ab");
+    BOOST_REQUIRE(file);
+    BOOST_CHECK_EQUAL(fwrite("verge", 1, 5, file), 5U);
+    fclose(file);
+    BOOST_CHECK_EQUAL(mapped.size(), 0U);
+    BOOST_CHECK(mapped.Remap());
+    BOOST_REQUIRE_EQUAL(mapped.size(), 5U);
+    BOOST_CHECK(memcmp(mapped.data(), "verge", 5) == 0);
+
+    // Data rewritten in place shows up at once
+    file = fsbridge::fopen(path, "rb+");
+    BOOST_REQUIRE(file);
+    BOOST_CHECK_EQUAL(fwrite("V", 1, 1, file), 1U);
+    fclose(file);
+    BOOST_CHECK(memcmp(mapped.data(), "Verge", 5) == 0);
+
+    mapped.Close();
+    BOOST_CHECK(!mapped.IsOpen());
+    BOOST_CHECK(mapped.data() == nullptr);
+    fs::remove(path);
+}
+
 BOOST_AUTO_TEST_CASE(test_ToLower)
 {
     BOOST_CHECK_EQUAL(ToLower('@'), '@');
@@ -8,10 +8,15 @@
 #include <chainparams.h>
 #include <consensus/merkle.h>
 #include <consensus/validation.h>
+#include <crypto/common.h>
+#include <crypto/lz4/lz4.h>
 #include <miner.h>
 #include <pow.h>
+#include <primitives/headerhashcache.h>
 #include <random.h>
+#include <streams.h>
 #include <test/setup_common.h>
+#include <util/system.h>
 #include <validation.h>
 #include <validationinterface.h>
 
@@ -235,4 +240,89 @@ BOOST_AUTO_TEST_CASE(reject_blocks_with_invalid_signature)
     BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-blk-signature");
 }
 
+BOOST_AUTO_TEST_CASE(read_block_checked_against_index)
+{
+    const CBlockIndex* pgenesis;
+    {
+        LOCK(cs_main);
+        pgenesis = chainActive.Genesis();
+    }
+    BOOST_REQUIRE(pgenesis);
+
+    // The block takes its hash from the index once the headers match, and
+    // reading it leaves the header hash cache alone
+    HeaderHashCache().Clear();
+    CBlock block;
+    BOOST_CHECK(ReadBlockFromDisk(block, pgenesis, Params().GetConsensus()));
+    BOOST_CHECK(block.hash == pgenesis->GetBlockHash());
+    BOOST_CHECK(block.GetHeaderCacheKey() == Params().GenesisBlock().GetHeaderCacheKey());
+    BOOST_CHECK_EQUAL(HeaderHashCache().Size(), 0U);
+
+    // An index entry for another header at the same position is refused
+    CBlockIndex index(*pgenesis);
+    index.nNonce++;
+    BOOST_CHECK(!ReadBlockFromDisk(block, &index, Params().GetConsensus()));
+}
+
+// Store a block file record of its own for a block, LZ4 compressed
+static void WriteCompressedRecord(int nFile, const std::vector<unsigned char>& block_data, size_t nTruncate = 0)
+{
+    std::vector<unsigned char> record(4 + LZ4_compressBound(block_data.size()));
+    WriteLE32(record.data(), block_data.size());
+    record.resize(4 + LZ4_compress((const char*)block_data.data(), (char*)record.data() + 4, block_data.size()) - nTruncate);
+
+    CAutoFile file(fsbridge::fopen(GetBlocksDir() / strprintf("blk%05u.dat", nFile), "wb"), SER_DISK, CLIENT_VERSION);
+    BOOST_REQUIRE(!file.IsNull());
+    file << Params().MessageStart() << (uint32_t)(record.size() | BLOCK_RECORD_COMPRESSED);
+    file.write((const char*)record.data(), record.size());
+}
+
+BOOST_AUTO_TEST_CASE(read_compressed_block)
+{
+    const CBlockIndex* pgenesis;
+    {
+        LOCK(cs_main);
+        pgenesis = chainActive.Genesis();
+    }
+    BOOST_REQUIRE(pgenesis);
+
+    std::vector<unsigned char> block_data;
+    CVectorWriter(SER_DISK, CLIENT_VERSION, block_data, 0, Params().GenesisBlock());
+
+    // A compressed record reads back as the block, whole or serialized
+    CBlockIndex index(*pgenesis);
+    index.nFile = 90;
+    index.nDataPos = CMessageHeader::MESSAGE_START_SIZE + 4;
+    WriteCompressedRecord(index.nFile, block_data);
+    CBlock block;
+    BOOST_CHECK(ReadBlockFromDisk(block, &index, Params().GetConsensus()));
+    BOOST_CHECK(block.GetHeaderCacheKey() == Params().GenesisBlock().GetHeaderCacheKey());
+    BOOST_CHECK(block.hashMerkleRoot == BlockMerkleRoot(block));
+    std::vector<unsigned char> raw;
+    BOOST_CHECK(ReadRawBlockFromDisk(raw, index.GetBlockPos(), Params().MessageStart()));
+    BOOST_CHECK(raw == block_data);
+
+    // One that doesn't decompress is refused
+    index.nFile = 91;
+    WriteCompressedRecord(index.nFile, block_data, 1);
+    BOOST_CHECK(!ReadBlockFromDisk(block, &index, Params().GetConsensus()));
+    BOOST_CHECK(!ReadRawBlockFromDisk(raw, index.GetBlockPos(), Params().MessageStart()));
+
+    // File info without flags keeps the layout it had before they existed
+    CBlockFileInfo info;
+    info.nBlocks = 1;
+    CDataStream ssPlain(SER_DISK, CLIENT_VERSION);
+    ssPlain << info;
+    info.nFlags = CBlockFileInfo::BLOCK_FILE_COMPRESSED;
+    CDataStream ssFlags(SER_DISK, CLIENT_VERSION);
+    ssFlags << info;
+    BOOST_CHECK_EQUAL(ssFlags.size(), ssPlain.size() + 1);
+    CBlockFileInfo info_read;
+    ssFlags >> info_read;
+    BOOST_CHECK_EQUAL(info_read.nFlags, CBlockFileInfo::BLOCK_FILE_COMPRESSED);
+    ssPlain >> info_read;
+    BOOST_CHECK_EQUAL(info_read.nFlags, 0U);
+    BOOST_CHECK_EQUAL(info_read.nBlocks, 1U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,132 @@
+// Copyright (c) 2018-2020 The Verge Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <util/mappedfile.h>
+
+#ifdef WIN32
+#ifdef _WIN32_WINNT
+#undef _WIN32_WINNT
+#endif
+#define _WIN32_WINNT 0x0501
+#define WIN32_LEAN_AND_MEAN 1
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <limits>
+
+CMappedFile::CMappedFile() : m_open(false), m_data(nullptr), m_size(0)
+#ifdef WIN32
+    , m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr)
+#else
+    , m_fd(-1)
+#endif
+{
+}
+
+CMappedFile::~CMappedFile()
+{
+    Close();
+}
+
+bool CMappedFile::Open(const fs::path& path)
+{
+    Close();
+#ifdef WIN32
+    m_file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE)
+        return false;
+#else
+    m_fd = open(path.string().c_str(), O_RDONLY);
+    if (m_fd < 0)
+        return false;
+#endif
+    m_open = true;
+    if (!Map()) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool CMappedFile::Remap()
+{
+    if (!m_open)
+        return false;
+    Unmap();
+    return Map();
+}
+
+void CMappedFile::Close()
+{
+    Unmap();
+#ifdef WIN32
+    if (m_file != INVALID_HANDLE_VALUE)
+        CloseHandle(m_file);
+    m_file = INVALID_HANDLE_VALUE;
+#else
+    if (m_fd >= 0)
+        close(m_fd);
+    m_fd = -1;
+#endif
+    m_open = false;
+}
+
+bool CMappedFile::Map()
+{
+#ifdef WIN32
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_file, &size) || (uint64_t)size.QuadPart > std::numeric_limits<size_t>::max())
+        return false;
+    if (size.QuadPart == 0)
+        return true;
+    m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mapping)
+        return false;
+    void* p = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!p) {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+        return false;
+    }
+    m_data = static_cast<const unsigned char*>(p);
+    m_size = size.QuadPart;
+#else
+    struct stat st;
+    if (fstat(m_fd, &st) != 0 || (uint64_t)st.st_size > std::numeric_limits<size_t>::max())
+        return false;
+    if (st.st_size == 0)
+        return true;
+    void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, m_fd, 0);
+    if (p == MAP_FAILED)
+        return false;
+    m_data = static_cast<const unsigned char*>(p);
+    m_size = st.st_size;
+#endif
+    return true;
+}
+
+void CMappedFile::Unmap()
+{
+#ifdef WIN32
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mapping)
+        CloseHandle(m_mapping);
+    m_mapping = nullptr;
+#else
+    if (m_data)
+        munmap(const_cast<unsigned char*>(m_data), m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
@@ -0,0 +1,51 @@
+// Copyright (c) 2018-2020 The Verge Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef VERGE_UTIL_MAPPEDFILE_H
+#define VERGE_UTIL_MAPPEDFILE_H
+
+#include <fs.h>
+
+#include <stddef.h>
+
+/**
+ * Read-only memory mapping of a whole file. The mapping is shared, so data
+ * rewritten in place through other handles shows up in it; data appended
+ * after Open() is only visible after Remap().
+ */
+class CMappedFile
+{
+public:
+    CMappedFile();
+    ~CMappedFile();
+
+    CMappedFile(const CMappedFile&) = delete;
+    CMappedFile& operator=(const CMappedFile&) = delete;
+
+    /** Map the file as it is now. An empty file maps to size() 0. */
+    bool Open(const fs::path& path);
+    /** Map the file again at its current size, e.g. after it grew. */
+    bool Remap();
+    void Close();
+
+    bool IsOpen() const { return m_open; }
+    const unsigned char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    bool Map();
+    void Unmap();
+
+    bool m_open;
+    const unsigned char* m_data;
+    size_t m_size;
+#ifdef WIN32
+    void* m_file;
+    void* m_mapping;
+#else
+    int m_fd;
+#endif
+};
+
+#endif // VERGE_UTIL_MAPPEDFILE_H
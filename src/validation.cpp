@@ -7,6 +7,7 @@
 #include <validation.h>
 
 #include <alerter.h>
+#include <algostats.h>
 #include <arith_uint256.h>
 #include <chain.h>
 #include <chainparams.h>
@@ -16,6 +17,8 @@
 #include <consensus/merkle.h>
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
+#include <crypto/lz4/lz4.h>
+#include <crypto/pow/scrypt.h>
 #include <cuckoocache.h>
 #include <flatfile.h>
 #include <hash.h>
@@ -25,8 +28,10 @@
 #include <policy/rbf.h>
 #include <pow.h>
 #include <primitives/block.h>
+#include <primitives/headerhashcache.h>
 #include <primitives/transaction.h>
 #include <random.h>
+#include <rawblockcache.h>
 #include <reverse_iterator.h>
 #include <script/script.h>
 #include <script/sigcache.h>
@@ -46,6 +51,7 @@
 
 #include <future>
 #include <sstream>
+#include <thread>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/algorithm/string/join.hpp>
@@ -238,6 +244,7 @@ bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
 size_t nCoinCacheUsage = 5000 * 300;
 uint64_t nPruneTarget = 0;
+bool fBlockCompression = DEFAULT_BLOCK_COMPRESSION;
 int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
 bool fEnableReplacement = DEFAULT_ENABLE_REPLACEMENT;
 
@@ -319,6 +326,10 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
 static FILE* OpenUndoFile(const FlatFilePos &pos, bool fReadOnly = false);
 static FlatFileSeq BlockFileSeq();
 static FlatFileSeq UndoFileSeq();
+static FlatFileMapPool& BlockFileMaps();
+static FlatFileMapPool& UndoFileMaps();
+static bool CheckBlockCoinbaseTime(const CBlock& block, CValidationState& state, int nTipHeight);
+static bool CheckBlockAtTip(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, const int* pnTipHeight, bool fCheckPOW, bool fCheckMerkleRoot, bool fCheckBlockSignature);
 
 bool CheckFinalTx(const CTransaction &tx, int flags)
 {
@@ -1081,7 +1092,40 @@ bool GetTransaction(const uint256& hash, CTransactionRef& txOut, const Consensus
 // CBlock and CBlockIndex
 //
 
-static bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos, const CMessageHeader::MessageStartChars& messageStart)
+/**
+ * LZ4 compress a block into the record stored for it: the size of the
+ * serialized block, then the compressed bytes. Returns false if that
+ * wouldn't save space, the block is then stored as it is.
+ */
+static bool CompressBlock(const CBlock& block, std::vector<uint8_t>& record)
+{
+    std::vector<uint8_t> block_data;
+    CVectorWriter(SER_DISK, CLIENT_VERSION, block_data, 0, block);
+    record.resize(4 + LZ4_compressBound(block_data.size()));
+    WriteLE32(record.data(), block_data.size());
+    const int nCompressed = LZ4_compress((const char*)block_data.data(), (char*)record.data() + 4, block_data.size());
+    if (nCompressed <= 0 || 4 + (size_t)nCompressed >= block_data.size()) {
+        record.clear();
+        return false;
+    }
+    record.resize(4 + nCompressed);
+    return true;
+}
+
+/** Decompress a record written by CompressBlock back into the serialized block */
+static bool DecompressBlock(const std::vector<uint8_t>& record, std::vector<uint8_t>& block_data)
+{
+    if (record.size() < 4)
+        return false;
+    const uint32_t nSize = ReadLE32(record.data());
+    if (nSize > MAX_SIZE)
+        return false;
+    block_data.resize(nSize);
+    return LZ4_decompress_safe((const char*)record.data() + 4, (char*)block_data.data(), record.size() - 4, nSize) == (int)nSize;
+}
+
+/** Append a block to the block files, as the compressed record if one is given */
+static bool WriteBlockToDisk(const CBlock& block, const std::vector<uint8_t>& compressed, FlatFilePos& pos, const CMessageHeader::MessageStartChars& messageStart)
 {
     // Open history file to append
     CAutoFile fileout(OpenBlockFile(pos), SER_DISK, CLIENT_VERSION);
@@ -1089,7 +1133,7 @@ static bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos, const CMessa
         return error("WriteBlockToDisk: OpenBlockFile failed");
 
     // Write index header
-    unsigned int nSize = GetSerializeSize(fileout, block);
+    unsigned int nSize = compressed.empty() ? GetSerializeSize(fileout, block) : compressed.size() | BLOCK_RECORD_COMPRESSED;
     fileout << messageStart << nSize;
 
     // Write block
@@ -1097,27 +1141,103 @@ static bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos, const CMessa
     if (fileOutPos < 0)
         return error("WriteBlockToDisk: ftell failed");
     pos.nPos = (unsigned int)fileOutPos;
-    fileout << block;
+    if (compressed.empty())
+        fileout << block;
+    else
+        fileout.write((const char*)compressed.data(), compressed.size());
 
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::Params& consensusParams)
+/**
+ * Read a record of the block or undo files through their mappings: the
+ * message start and size in front of it, then the record and nTrailer more
+ * bytes. Returns false if that isn't possible, the file is then read as usual.
+ * With pfCompressed the size may carry BLOCK_RECORD_COMPRESSED, which is
+ * passed back there.
+ */
+static bool ReadMappedRecord(FlatFileMapPool& maps, const FlatFileSeq& seq, const FlatFilePos& pos, CMessageHeader::MessageStartChars& message_start, std::vector<uint8_t>& data, size_t nTrailer = 0, bool* pfCompressed = nullptr)
+{
+    unsigned char header[CMessageHeader::MESSAGE_START_SIZE + 4];
+    if (pos.nPos < sizeof(header) || !maps.Read(seq, FlatFilePos(pos.nFile, pos.nPos - sizeof(header)), header, sizeof(header)))
+        return false;
+    memcpy(message_start, header, CMessageHeader::MESSAGE_START_SIZE);
+    uint32_t nSize = ReadLE32(header + CMessageHeader::MESSAGE_START_SIZE);
+    if (pfCompressed) {
+        *pfCompressed = (nSize & BLOCK_RECORD_COMPRESSED) != 0;
+        nSize &= ~BLOCK_RECORD_COMPRESSED;
+    }
+    if (nSize > MAX_SIZE)
+        return false;
+    data.resize(nSize + nTrailer);
+    return maps.Read(seq, pos, data.data(), data.size());
+}
+
+/**
+ * Read the serialized block of a block file record and the message start in
+ * front of it, decompressing blocks that were stored compressed.
+ */
+static bool ReadBlockRecord(const FlatFilePos& pos, CMessageHeader::MessageStartChars& message_start, std::vector<uint8_t>& block_data)
+{
+    bool fCompressed = false;
+    if (!ReadMappedRecord(BlockFileMaps(), BlockFileSeq(), pos, message_start, block_data, 0, &fCompressed)) {
+        FlatFilePos hpos = pos;
+        hpos.nPos -= 8; // Seek back 8 bytes for meta header
+        CAutoFile filein(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull()) {
+            return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+        }
+
+        try {
+            unsigned int blk_size;
+
+            filein >> message_start >> blk_size;
+
+            fCompressed = (blk_size & BLOCK_RECORD_COMPRESSED) != 0;
+            blk_size &= ~BLOCK_RECORD_COMPRESSED;
+            if (blk_size > MAX_SIZE) {
+                return error("%s: Block data is larger than maximum deserialization size for %s: %s versus %s", __func__, pos.ToString(),
+                        blk_size, MAX_SIZE);
+            }
+
+            block_data.resize(blk_size); // Zeroing of memory is intentional here
+            filein.read((char*)block_data.data(), blk_size);
+        } catch(const std::exception& e) {
+            return error("%s: Read from block file failed: %s for %s", __func__, e.what(), pos.ToString());
+        }
+    }
+
+    if (fCompressed) {
+        std::vector<uint8_t> record;
+        record.swap(block_data);
+        if (!DecompressBlock(record, block_data))
+            return error("%s: Decompressing block failed for %s", __func__, pos.ToString());
+    }
+    return true;
+}
+
+static bool ReadBlockDataFromDisk(CBlock& block, const FlatFilePos& pos)
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+    std::vector<uint8_t> block_data;
+    CMessageHeader::MessageStartChars message_start;
+    if (!ReadBlockRecord(pos, message_start, block_data))
+        return false;
 
-    // Read block
     try {
-        filein >> block;
-    }
-    catch (const std::exception& e) {
+        VectorReader reader(SER_DISK, CLIENT_VERSION, block_data, 0);
+        reader >> block;
+    } catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
     }
+    return true;
+}
+
+bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::Params& consensusParams)
+{
+    if (!ReadBlockDataFromDisk(block, pos))
+        return false;
 
     // Check the header
     if (!CheckProofOfWork(block.GetPoWHash(block.GetAlgo()), block.nBits, consensusParams))
@@ -1133,47 +1253,36 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
         LOCK(cs_main);
         blockPos = pindex->GetBlockPos();
     }
+    return ReadBlockFromDisk(block, pindex, blockPos, consensusParams);
+}
 
-    if (!ReadBlockFromDisk(block, blockPos, consensusParams))
+bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const FlatFilePos& blockPos, const Consensus::Params& consensusParams)
+{
+    if (!ReadBlockDataFromDisk(block, blockPos))
         return false;
-    if (block.GetHash() != pindex->GetBlockHash())
-        return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
-                pindex->ToString(), pindex->GetBlockPos().ToString());
+
+    // The index only holds headers whose proof of work was checked, so a
+    // block with the same header is the one indexed: comparing the SHA256d
+    // of the headers replaces both memory-hard hashes.
+    const uint256 key = block.GetHeaderCacheKey();
+    if (key != pindex->GetBlockHeader().GetHeaderCacheKey())
+        return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): header doesn't match index for %s at %s",
+                pindex->ToString(), blockPos.ToString());
+    block.hash = pindex->GetBlockHash();
     return true;
 }
 
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start)
 {
-    FlatFilePos hpos = pos;
-    hpos.nPos -= 8; // Seek back 8 bytes for meta header
-    CAutoFile filein(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull()) {
-        return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
-    }
-
-    try {
-        CMessageHeader::MessageStartChars blk_start;
-        unsigned int blk_size;
-
-        filein >> blk_start >> blk_size;
-
-        if (memcmp(blk_start, message_start, CMessageHeader::MESSAGE_START_SIZE)) {
-            return error("%s: Block magic mismatch for %s: %s versus expected %s", __func__, pos.ToString(),
-                    HexStr(blk_start, blk_start + CMessageHeader::MESSAGE_START_SIZE),
-                    HexStr(message_start, message_start + CMessageHeader::MESSAGE_START_SIZE));
-        }
-
-        if (blk_size > MAX_SIZE) {
-            return error("%s: Block data is larger than maximum deserialization size for %s: %s versus %s", __func__, pos.ToString(),
-                    blk_size, MAX_SIZE);
-        }
+    CMessageHeader::MessageStartChars blk_start;
+    if (!ReadBlockRecord(pos, blk_start, block))
+        return false;
 
-        block.resize(blk_size); // Zeroing of memory is intentional here
-        filein.read((char*)block.data(), blk_size);
-    } catch(const std::exception& e) {
-        return error("%s: Read from block file failed: %s for %s", __func__, e.what(), pos.ToString());
+    if (memcmp(blk_start, message_start, CMessageHeader::MESSAGE_START_SIZE)) {
+        return error("%s: Block magic mismatch for %s: %s versus expected %s", __func__, pos.ToString(),
+                HexStr(blk_start, blk_start + CMessageHeader::MESSAGE_START_SIZE),
+                HexStr(message_start, message_start + CMessageHeader::MESSAGE_START_SIZE));
     }
-
     return true;
 }
 
@@ -1188,6 +1297,23 @@ bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex
     return ReadRawBlockFromDisk(block, block_pos, message_start);
 }
 
+bool ReadRawBlockFromDisk(std::shared_ptr<const std::vector<uint8_t>>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start)
+{
+    const uint256 hash = pindex->GetBlockHash();
+    if (RawBlockCache().Lookup(hash, block))
+        return true;
+
+    std::shared_ptr<std::vector<uint8_t>> block_data = std::make_shared<std::vector<uint8_t>>();
+    if (!ReadRawBlockFromDisk(*block_data, pindex, message_start))
+        return false;
+    // Only the indexed block is served and cached, checked as ReadBlockFromDisk does
+    if (block_data->size() < 80 || Hash(block_data->begin(), block_data->begin() + 80) != pindex->GetBlockHeader().GetHeaderCacheKey())
+        return error("%s: header doesn't match index for %s", __func__, pindex->ToString());
+    RawBlockCache().Insert(hash, block_data);
+    block = std::move(block_data);
+    return true;
+}
+
 CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams)
 {
     if (nHeight<14001 && nHeight>0)
@@ -1533,6 +1659,26 @@ static bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
         return error("%s: no undo data available", __func__);
     }
 
+    std::vector<uint8_t> undo_data;
+    CMessageHeader::MessageStartChars message_start;
+    if (ReadMappedRecord(UndoFileMaps(), UndoFileSeq(), pos, message_start, undo_data, sizeof(uint256))) {
+        const size_t nSize = undo_data.size() - sizeof(uint256);
+        CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+        hasher << pindex->pprev->GetBlockHash();
+        hasher.write((const char*)undo_data.data(), nSize);
+        uint256 hashChecksum;
+        memcpy(hashChecksum.begin(), undo_data.data() + nSize, sizeof(uint256));
+        if (hashChecksum != hasher.GetHash())
+            return error("%s: Checksum mismatch", __func__);
+        try {
+            CDataStream ssUndo((const char*)undo_data.data(), (const char*)undo_data.data() + nSize, SER_DISK, CLIENT_VERSION);
+            ssUndo >> blockundo;
+        } catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+        }
+        return true;
+    }
+
     // Open history file to read
     CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull())
@@ -1677,6 +1823,12 @@ void static FlushBlockFile(bool fFinalize = false)
     FlatFilePos block_pos_old(nLastBlockFile, vinfoBlockFile[nLastBlockFile].nSize);
     FlatFilePos undo_pos_old(nLastBlockFile, vinfoBlockFile[nLastBlockFile].nUndoSize);
 
+    // Mapped files can't be truncated everywhere
+    if (fFinalize) {
+        BlockFileMaps().Release(BlockFileSeq().FileName(block_pos_old));
+        UndoFileMaps().Release(UndoFileSeq().FileName(undo_pos_old));
+    }
+
     bool status = true;
     status &= BlockFileSeq().Flush(block_pos_old, fFinalize);
     status &= UndoFileSeq().Flush(undo_pos_old, fFinalize);
@@ -1714,6 +1866,178 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+// Its jobs are coarse, a run of headers or a whole block, so take one at a time
+static CCheckQueue<CWorkerJob> workerqueue(1);
+
+void ThreadWorkerJobs() {
+    RenameThread("verge-worker");
+    workerqueue.Thread();
+}
+
+bool RunWorkerJobs(std::vector<CWorkerJob>& vJobs)
+{
+    if (!nScriptCheckThreads) {
+        bool fOk = true;
+        for (CWorkerJob& job : vJobs)
+            fOk &= job();
+        return fOk;
+    }
+    CCheckQueueControl<CWorkerJob> control(&workerqueue);
+    control.Add(vJobs);
+    return control.Wait();
+}
+
+/**
+ * Closure computing the hashes of a run of headers that share an algorithm:
+ * for ALGO_SCRYPT the identity hashes (batched through the multi-way scrypt
+ * kernel), otherwise the proof-of-work hashes of that algorithm.
+ */
+class CHeaderHashCheck
+{
+private:
+    int algo;
+    std::vector<const CBlockHeader*> headers;
+
+public:
+    CHeaderHashCheck() : algo(ALGO_SCRYPT) {}
+    CHeaderHashCheck(int algoIn, std::vector<const CBlockHeader*>&& headersIn) : algo(algoIn), headers(std::move(headersIn)) {}
+
+    bool operator()();
+
+    void swap(CHeaderHashCheck& check)
+    {
+        std::swap(algo, check.algo);
+        headers.swap(check.headers);
+    }
+};
+
+bool CHeaderHashCheck::operator()()
+{
+    if (algo == ALGO_SCRYPT) {
+        std::vector<const char*> in(headers.size());
+        std::vector<uint256> hashes(headers.size());
+        std::vector<char*> out(headers.size());
+        for (size_t i = 0; i < headers.size(); i++) {
+            in[i] = BEGIN(headers[i]->nVersion);
+            out[i] = BEGIN(hashes[i]);
+        }
+        scrypt_1024_1_1_256_multi(in.data(), out.data(), headers.size());
+        for (size_t i = 0; i < headers.size(); i++)
+            HeaderHashCache().Insert(headers[i]->GetHeaderCacheKey(), hashes[i]);
+    } else {
+        for (const CBlockHeader* header : headers)
+            PoWHashCache().Insert(header->GetHeaderCacheKey(), header->GetPoWHash(algo));
+    }
+    return true;
+}
+
+void PrecomputeHeaderHashes(const std::vector<CBlockHeader>& headers, bool fPoWHashes)
+{
+    if (HeaderHashCache().MaxEntries() < headers.size())
+        return;
+
+    // Group by algorithm: scrypt runs fill the multi-way kernel, and the
+    // other algorithms keep their code and tables hot within one closure.
+    std::vector<const CBlockHeader*> vPending[NUM_ALGOS];
+    std::vector<CHeaderHashCheck> vChecks;
+    auto queue = [&](int algo, const CBlockHeader* header) {
+        vPending[algo].push_back(header);
+        if (vPending[algo].size() == HEADER_HASH_CHECK_BATCH) {
+            vChecks.emplace_back(algo, std::move(vPending[algo]));
+            vPending[algo].clear();
+        }
+    };
+
+    uint256 hash;
+    for (const CBlockHeader& header : headers) {
+        const uint256 key = header.GetHeaderCacheKey();
+        if (header.hash.IsNull() && !HeaderHashCache().Lookup(key, hash))
+            queue(ALGO_SCRYPT, &header);
+        const int algo = header.GetAlgo();
+        if (fPoWHashes && algo != ALGO_SCRYPT && !PoWHashCache().Lookup(key, hash))
+            queue(algo, &header);
+    }
+    for (int algo = 0; algo < NUM_ALGOS; algo++) {
+        if (!vPending[algo].empty())
+            vChecks.emplace_back(algo, std::move(vPending[algo]));
+    }
+    if (!vChecks.empty())
+        RunWorkerChecks(vChecks);
+}
+
+/** A block found in an external block file, read and decoded ahead of the import */
+struct CImportBlock
+{
+    //! Where the block starts, and the byte after the message start in front of it
+    uint64_t nBlockPos;
+    uint64_t nScanPos;
+    //! Size field in front of the block, without BLOCK_RECORD_COMPRESSED
+    unsigned int nSize;
+    //! The block was stored compressed, vchBlock holds it decompressed once the batch is decoded
+    bool fCompressed;
+    //! Where the scan for the next block resumes once this one is decoded
+    uint64_t nRewind;
+    std::vector<unsigned char> vchBlock;
+    std::shared_ptr<CBlock> pblock;
+    //! pblock passed all of CheckBlock() but the check that depends on the tip
+    bool fCheckedNoTip;
+    std::string strError;
+
+    CImportBlock() : nBlockPos(0), nScanPos(0), nSize(0), fCompressed(false), nRewind(0), fCheckedNoTip(false) {}
+};
+
+/**
+ * Closure deserializing an imported block and running the checks of
+ * CheckBlock() that do not need cs_main on it, so that AcceptBlock() can
+ * skip them.
+ */
+class CBlockDecodeCheck
+{
+private:
+    CImportBlock* pitem;
+    const Consensus::Params* pconsensus;
+
+public:
+    CBlockDecodeCheck() : pitem(nullptr), pconsensus(nullptr) {}
+    CBlockDecodeCheck(CImportBlock* pitemIn, const Consensus::Params* pconsensusIn) : pitem(pitemIn), pconsensus(pconsensusIn) {}
+
+    bool operator()();
+
+    void swap(CBlockDecodeCheck& check)
+    {
+        std::swap(pitem, check.pitem);
+        std::swap(pconsensus, check.pconsensus);
+    }
+};
+
+bool CBlockDecodeCheck::operator()()
+{
+    if (!pitem->strError.empty()) {
+        pitem->nRewind = pitem->nScanPos;
+        return true;
+    }
+
+    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+    try {
+        VectorReader reader(SER_DISK, CLIENT_VERSION, pitem->vchBlock, 0);
+        reader >> *pblock;
+        // A compressed record is used up whole
+        pitem->nRewind = pitem->nBlockPos + pitem->nSize - (pitem->fCompressed ? 0 : reader.size());
+    } catch (const std::exception& e) {
+        pitem->nRewind = pitem->nScanPos;
+        pitem->strError = e.what();
+        return true;
+    }
+    std::vector<unsigned char>().swap(pitem->vchBlock);
+
+    // A block failing the checks is left for AcceptBlock() to check again and reject
+    CValidationState state;
+    pitem->fCheckedNoTip = CheckBlockAtTip(*pblock, state, *pconsensus, nullptr, true, true, true);
+    pitem->pblock = std::move(pblock);
+    return true;
+}
+
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -2252,6 +2576,8 @@ void static UpdateTip(const CBlockIndex *pindexNew, const CChainParams& chainPar
         g_best_block_cv.notify_all();
     }
 
+    g_algo_stats.UpdateTip(pindexNew);
+
     std::vector<std::string> warningMessages;
     if (!IsInitialBlockDownload())
     {
@@ -2442,6 +2768,10 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
         std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
         if (!ReadBlockFromDisk(*pblockNew, pindexNew, chainparams.GetConsensus()))
             return AbortNode(state, "Failed to read block");
+        // ConnectBlock checks the scrypt proof of work again, the identity
+        // hash the read just took from the index
+        if (pblockNew->GetAlgo() == ALGO_SCRYPT)
+            HeaderHashCache().Insert(pblockNew->GetHeaderCacheKey(), pblockNew->hash);
         pthisBlock = pblockNew;
     } else {
         pthisBlock = pblock;
@@ -3012,7 +3342,7 @@ void CChainState::ReceivedBlockTransactions(const CBlock& block, CBlockIndex* pi
     }
 }
 
-static bool FindBlockPos(FlatFilePos &pos, unsigned int nAddSize, unsigned int nHeight, uint64_t nTime, bool fKnown = false)
+static bool FindBlockPos(FlatFilePos &pos, unsigned int nAddSize, unsigned int nHeight, uint64_t nTime, bool fKnown = false, bool fCompressed = false)
 {
     LOCK(cs_LastBlockFile);
 
@@ -3045,6 +3375,8 @@ static bool FindBlockPos(FlatFilePos &pos, unsigned int nAddSize, unsigned int n
         vinfoBlockFile[nFile].nSize = std::max(pos.nPos + nAddSize, vinfoBlockFile[nFile].nSize);
     else
         vinfoBlockFile[nFile].nSize += nAddSize;
+    if (fCompressed)
+        vinfoBlockFile[nFile].nFlags |= CBlockFileInfo::BLOCK_FILE_COMPRESSED;
 
     if (!fKnown) {
         bool out_of_space;
@@ -3083,6 +3415,19 @@ static bool FindUndoPos(CValidationState &state, int nFile, FlatFilePos &pos, un
     return true;
 }
 
+/**
+ * Proof-of-work hash of a header for its own algorithm, served from
+ * PoWHashCache() when PrecomputeHeaderHashes() already computed it.
+ */
+static uint256 GetHeaderPoWHash(const CBlockHeader& block)
+{
+    const int algo = block.GetAlgo();
+    uint256 hash;
+    if (algo != ALGO_SCRYPT && PoWHashCache().Lookup(block.GetHeaderCacheKey(), hash))
+        return hash;
+    return block.GetPoWHash(algo);
+}
+
 static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true)
 {
     if (block.nVersion > 4) {
@@ -3100,13 +3445,27 @@ static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state,
     }
     
     // Check proof of work matches claimed amount
-    if (fCheckPOW && !CheckProofOfWork(block.GetPoWHash(block.GetAlgo()), block.nBits, consensusParams))
+    if (fCheckPOW && !CheckProofOfWork(GetHeaderPoWHash(block), block.nBits, consensusParams))
         return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
 
     return true;
 }
 
-bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, bool fCheckMerkleRoot, bool fCheckBlockSignature)
+/** The coinbase timestamp check of CheckBlock(), the one that depends on the height of the tip */
+static bool CheckBlockCoinbaseTime(const CBlock& block, CValidationState& state, int nTipHeight)
+{
+    if (block.GetBlockTime() > (int64_t)block.vtx[0]->nTime + GetMaxClockDrift(nTipHeight)){
+        return state.DoS(50, false, REJECT_INVALID, "transaction-time-too-new", false, "block timestamp earlier than transaction timestamp");
+    }
+    return true;
+}
+
+/**
+ * CheckBlock() for a tip at *pnTipHeight. Without one, the coinbase
+ * timestamp is not checked and fChecked is left alone, so that the checks
+ * can run off cs_main and CheckBlockCoinbaseTime() completes them later.
+ */
+static bool CheckBlockAtTip(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, const int* pnTipHeight, bool fCheckPOW, bool fCheckMerkleRoot, bool fCheckBlockSignature)
 {
     // These are checks that are independent of context.
 
@@ -3149,9 +3508,8 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
         if (block.vtx[i]->IsCoinBase())
             return state.DoS(100, false, REJECT_INVALID, "bad-cb-multiple", false, "more than one coinbase");
     // Check coinbase timestamp
-    if (block.GetBlockTime() > (int64_t)block.vtx[0]->nTime + GetMaxClockDrift(chainActive.Height())){
-        return state.DoS(50, false, REJECT_INVALID, "transaction-time-too-new", false, "block timestamp earlier than transaction timestamp");
-    }
+    if (pnTipHeight && !CheckBlockCoinbaseTime(block, state, *pnTipHeight))
+        return false;
 
     // Check transactions
     for (const auto& tx : block.vtx)
@@ -3174,7 +3532,7 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
     if (nSigOps * WITNESS_SCALE_FACTOR > MAX_BLOCK_SIGOPS_COST)
         return state.DoS(100, false, REJECT_INVALID, "bad-blk-sigops", false, "out-of-bounds SigOpCount");
 
-    if (fCheckPOW && fCheckMerkleRoot)
+    if (fCheckPOW && fCheckMerkleRoot && pnTipHeight)
         block.fChecked = true;
 
     if (fCheckBlockSignature) {
@@ -3186,6 +3544,15 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
     return true;
 }
 
+bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, bool fCheckMerkleRoot, bool fCheckBlockSignature)
+{
+    if (block.fChecked)
+        return true;
+
+    const int nTipHeight = chainActive.Height();
+    return CheckBlockAtTip(block, state, consensusParams, &nTipHeight, fCheckPOW, fCheckMerkleRoot, fCheckBlockSignature);
+}
+
 bool IsWitnessEnabled(const CBlockIndex* pindexPrev, const Consensus::Params& params)
 {
     LOCK(cs_main);
@@ -3509,18 +3876,54 @@ bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidatio
     return true;
 }
 
+/**
+ * Size of the block file record at pos, without BLOCK_RECORD_COMPRESSED,
+ * and whether that flag was set.
+ */
+static bool ReadBlockRecordSize(const FlatFilePos& pos, unsigned int& nSize, bool& fCompressed)
+{
+    if (pos.nPos < 4)
+        return false;
+    FlatFilePos spos(pos.nFile, pos.nPos - 4);
+    unsigned char size_field[4];
+    if (!BlockFileMaps().Read(BlockFileSeq(), spos, size_field, sizeof(size_field))) {
+        CAutoFile filein(OpenBlockFile(spos, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return false;
+        try {
+            filein.read((char*)size_field, sizeof(size_field));
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    const uint32_t nField = ReadLE32(size_field);
+    fCompressed = (nField & BLOCK_RECORD_COMPRESSED) != 0;
+    nSize = nField & ~BLOCK_RECORD_COMPRESSED;
+    return true;
+}
+
 /** Store block on disk. If dbp is non-nullptr, the file is known to already reside on disk */
 static FlatFilePos SaveBlockToDisk(const CBlock& block, int nHeight, const CChainParams& chainparams, const FlatFilePos* dbp) {
     unsigned int nBlockSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+    std::vector<uint8_t> compressed;
+    bool fCompressed = false;
+    if (dbp == nullptr) {
+        fCompressed = fBlockCompression && CompressBlock(block, compressed);
+        if (fCompressed)
+            nBlockSize = compressed.size();
+    } else {
+        // The record found on disk may be compressed, one that can't be read keeps the serialized size
+        ReadBlockRecordSize(*dbp, nBlockSize, fCompressed);
+    }
     FlatFilePos blockPos;
     if (dbp != nullptr)
         blockPos = *dbp;
-    if (!FindBlockPos(blockPos, nBlockSize+8, nHeight, block.GetBlockTime(), dbp != nullptr)) {
+    if (!FindBlockPos(blockPos, nBlockSize+8, nHeight, block.GetBlockTime(), dbp != nullptr, fCompressed)) {
         error("%s: FindBlockPos failed", __func__);
         return FlatFilePos();
     }
     if (dbp == nullptr) {
-        if (!WriteBlockToDisk(block, blockPos, chainparams.MessageStart())) {
+        if (!WriteBlockToDisk(block, compressed, blockPos, chainparams.MessageStart())) {
             AbortNode("Failed to write block");
             return FlatFilePos();
         }
@@ -3722,6 +4125,8 @@ void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
 {
     for (std::set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         FlatFilePos pos(*it, 0);
+        BlockFileMaps().Release(BlockFileSeq().FileName(pos));
+        UndoFileMaps().Release(UndoFileSeq().FileName(pos));
         fs::remove(BlockFileSeq().FileName(pos));
         fs::remove(UndoFileSeq().FileName(pos));
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
@@ -3832,6 +4237,18 @@ static FlatFileSeq UndoFileSeq()
     return FlatFileSeq(GetBlocksDir(), "rev", UNDOFILE_CHUNK_SIZE);;
 }
 
+static FlatFileMapPool& BlockFileMaps()
+{
+    static FlatFileMapPool maps(MAX_MAPPED_BLOCK_FILES);
+    return maps;
+}
+
+static FlatFileMapPool& UndoFileMaps()
+{
+    static FlatFileMapPool maps(MAX_MAPPED_BLOCK_FILES);
+    return maps;
+}
+
 FILE* OpenBlockFile(const FlatFilePos &pos, bool fReadOnly) {
     return BlockFileSeq().Open(pos, fReadOnly);
 }
@@ -3927,6 +4344,15 @@ bool CChainState::LoadBlockIndex(const CChainParams& chainparams, const Consensu
             pindexBestHeader = pindex;
     }
 
+    // Seed the header hash cache from the stored identity hashes, most recent
+    // last so they are evicted last. Re-announced headers and block reads for
+    // these entries then skip scrypt entirely.
+    const size_t nSeed = std::min(vSortedByHeight.size(), HeaderHashCache().MaxEntries());
+    for (auto it = vSortedByHeight.end() - nSeed; it != vSortedByHeight.end(); ++it) {
+        const CBlockIndex* pindex = it->second;
+        HeaderHashCache().Insert(pindex->GetBlockHeader().GetHeaderCacheKey(), pindex->GetBlockHash());
+    }
+
     return true;
 }
 
@@ -4006,6 +4432,7 @@ bool LoadChainTip(const CChainParams& chainparams)
         return false;
     }
     chainActive.SetTip(pindex);
+    g_algo_stats.UpdateTip(pindex);
 
     g_chainstate.PruneBlockIndexCandidates();
 
@@ -4332,7 +4759,10 @@ void CChainState::UnloadBlockIndex() {
 void UnloadBlockIndex()
 {
     LOCK(cs_main);
+    BlockFileMaps().Clear();
+    UndoFileMaps().Clear();
     chainActive.SetTip(nullptr);
+    g_algo_stats.Clear();
     pindexBestInvalid = nullptr;
     pindexBestHeader = nullptr;
     mempool.clear();
@@ -4407,6 +4837,183 @@ bool LoadGenesisBlock(const CChainParams& chainparams)
     return g_chainstate.LoadGenesisBlock(chainparams);
 }
 
+/**
+ * Scan an external block file for the next batch of blocks and read them
+ * whole. Returns false once no further block can be found in the file.
+ */
+static bool ReadImportBatch(const CChainParams& chainparams, CBufferedFile& blkdat, uint64_t& nRewind, std::vector<CImportBlock>& vBatch)
+{
+    size_t nBytes = 0;
+    while (vBatch.size() < IMPORT_BATCH_BLOCKS && nBytes < IMPORT_BATCH_BYTES) {
+        if (blkdat.eof())
+            return false;
+
+        blkdat.SetPos(nRewind);
+        nRewind++; // start one byte further next time, in case of failure
+        blkdat.SetLimit(); // remove former limit
+        unsigned int nSize = 0;
+        bool fCompressed = false;
+        try {
+            // locate a header
+            unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
+            blkdat.FindByte(chainparams.MessageStart()[0]);
+            nRewind = blkdat.GetPos()+1;
+            blkdat >> buf;
+            if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
+                continue;
+            // read size
+            blkdat >> nSize;
+            fCompressed = (nSize & BLOCK_RECORD_COMPRESSED) != 0;
+            nSize &= ~BLOCK_RECORD_COMPRESSED;
+            if (nSize < (fCompressed ? 4 : 80) || nSize > MAX_BLOCK_SERIALIZED_SIZE)
+                continue;
+        } catch (const std::exception&) {
+            // no valid block header found; don't complain
+            return false;
+        }
+        try {
+            // read block, in pieces that leave the buffer its rewind margin
+            CImportBlock item;
+            item.nBlockPos = blkdat.GetPos();
+            item.nScanPos = nRewind;
+            item.nSize = nSize;
+            item.fCompressed = fCompressed;
+            blkdat.SetLimit(item.nBlockPos + nSize);
+            item.vchBlock.resize(nSize);
+            for (unsigned int nRead = 0; nRead < nSize; ) {
+                unsigned int nChunk = std::min<unsigned int>(nSize - nRead, 1 << 16);
+                blkdat.read((char*)&item.vchBlock[nRead], nChunk);
+                nRead += nChunk;
+            }
+            nRewind = blkdat.GetPos();
+            nBytes += nSize;
+            vBatch.push_back(std::move(item));
+        } catch (const std::exception& e) {
+            LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+        }
+    }
+    return true;
+}
+
+/**
+ * Decompress the compressed blocks of a batch of imported blocks and hash
+ * their headers, then deserialize and check the blocks, both on the worker
+ * threads.
+ */
+static void DecodeImportBatch(const Consensus::Params& consensus, std::vector<CImportBlock>& vBatch)
+{
+    std::vector<CBlockHeader> headers;
+    headers.reserve(vBatch.size());
+    for (CImportBlock& item : vBatch) {
+        if (item.fCompressed) {
+            std::vector<unsigned char> vchRecord;
+            vchRecord.swap(item.vchBlock);
+            if (!DecompressBlock(vchRecord, item.vchBlock) || item.vchBlock.size() < 80) {
+                item.strError = "LZ4 decompression failed";
+                continue;
+            }
+        }
+        headers.emplace_back();
+        VectorReader reader(SER_DISK, CLIENT_VERSION, item.vchBlock, 0);
+        reader >> headers.back();
+    }
+    PrecomputeHeaderHashes(headers);
+
+    std::vector<CBlockDecodeCheck> vChecks;
+    vChecks.reserve(vBatch.size());
+    for (CImportBlock& item : vBatch)
+        vChecks.emplace_back(&item, &consensus);
+    RunWorkerChecks(vChecks);
+}
+
+/** Accept one imported block, in file order. Returns false when the import has to stop. */
+static bool AcceptImportedBlock(const CChainParams& chainparams, const CImportBlock& item, FlatFilePos* dbp, std::multimap<uint256, FlatFilePos>& mapBlocksUnknownParent, int& nLoaded)
+{
+    if (!item.pblock) {
+        LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, item.strError);
+        return true;
+    }
+
+    try {
+        if (dbp)
+            dbp->nPos = item.nBlockPos;
+        std::shared_ptr<CBlock> pblock = item.pblock;
+        CBlock& block = *pblock;
+
+        uint256 hash = block.GetHash();
+        {
+            LOCK(cs_main);
+            // detect out of order blocks, and store them for later
+            if (hash != chainparams.GetConsensus().hashGenesisBlock && !LookupBlockIndex(block.hashPrevBlock)) {
+                LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
+                        block.hashPrevBlock.ToString());
+                if (dbp)
+                    mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
+                return true;
+            }
+
+            // process in case the block isn't known yet
+            CBlockIndex* pindex = LookupBlockIndex(hash);
+            if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
+              // Complete the checks done while decoding against the tip CheckBlock() would see now
+              CValidationState stateTime;
+              if (item.fCheckedNoTip && CheckBlockCoinbaseTime(block, stateTime, chainActive.Height()))
+                  block.fChecked = true;
+              CValidationState state;
+              if (g_chainstate.AcceptBlock(pblock, state, chainparams, nullptr, true, dbp, nullptr)) {
+                  nLoaded++;
+              }
+              if (state.IsError()) {
+                  return false;
+              }
+            } else if (hash != chainparams.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
+              LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
+            }
+        }
+
+        // Activate the genesis block so normal node progress can continue
+        if (hash == chainparams.GetConsensus().hashGenesisBlock) {
+            CValidationState state;
+            if (!ActivateBestChain(state, chainparams)) {
+                return false;
+            }
+        }
+
+        NotifyHeaderTip();
+
+        // Recursively process earlier encountered successors of this block
+        std::deque<uint256> queue;
+        queue.push_back(hash);
+        while (!queue.empty()) {
+            uint256 head = queue.front();
+            queue.pop_front();
+            std::pair<std::multimap<uint256, FlatFilePos>::iterator, std::multimap<uint256, FlatFilePos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
+            while (range.first != range.second) {
+                std::multimap<uint256, FlatFilePos>::iterator it = range.first;
+                std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
+                if (ReadBlockFromDisk(*pblockrecursive, it->second, chainparams.GetConsensus()))
+                {
+                    LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
+                            head.ToString());
+                    LOCK(cs_main);
+                    CValidationState dummy;
+                    if (g_chainstate.AcceptBlock(pblockrecursive, dummy, chainparams, nullptr, true, &it->second, nullptr))
+                    {
+                        nLoaded++;
+                        queue.push_back(pblockrecursive->GetHash());
+                    }
+                }
+                range.first++;
+                mapBlocksUnknownParent.erase(it);
+                NotifyHeaderTip();
+            }
+        }
+    } catch (const std::exception& e) {
+        LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+    }
+    return true;
+}
+
 bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFilePos *dbp)
 {
     // Map of disk positions for blocks with unknown parent (only used for reindex)
@@ -4418,107 +5025,66 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFi
         // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
         CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SERIALIZED_SIZE, MAX_BLOCK_SERIALIZED_SIZE+8, SER_DISK, CLIENT_VERSION);
         uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
-            boost::this_thread::interruption_point();
 
-            blkdat.SetPos(nRewind);
-            nRewind++; // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
-                blkdat.FindByte(chainparams.MessageStart()[0]);
-                nRewind = blkdat.GetPos()+1;
-                blkdat >> buf;
-                if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
-                    continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
+        // The next batch of blocks is read, hashed and decoded on another thread
+        // while the blocks of this one are accepted here, one by one in file order.
+        std::vector<CImportBlock> vBatch, vNext;
+        bool fMore = ReadImportBatch(chainparams, blkdat, nRewind, vBatch);
+        DecodeImportBatch(chainparams.GetConsensus(), vBatch);
+        bool fAbort = false;
+        while (!vBatch.empty() && !fAbort) {
+            // The prefetch scans on from its own copy of the position, which
+            // only becomes the position of the import once the thread is joined
+            std::thread prefetch;
+            bool fNextMore = false;
+            uint64_t nNextRewind = nRewind;
+            if (fMore) {
+                prefetch = std::thread([&chainparams, &blkdat, &nNextRewind, &vNext, &fNextMore]() {
+                    fNextMore = ReadImportBatch(chainparams, blkdat, nNextRewind, vNext);
+                    DecodeImportBatch(chainparams.GetConsensus(), vNext);
+                });
             }
-            try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-                CBlock& block = *pblock;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
-
-                uint256 hash = block.GetHash();
-                {
-                    LOCK(cs_main);
-                    // detect out of order blocks, and store them for later
-                    if (hash != chainparams.GetConsensus().hashGenesisBlock && !LookupBlockIndex(block.hashPrevBlock)) {
-                        LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
-                                block.hashPrevBlock.ToString());
-                        if (dbp)
-                            mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
-                        continue;
-                    }
 
-                    // process in case the block isn't known yet
-                    CBlockIndex* pindex = LookupBlockIndex(hash);
-                    if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
-                      CValidationState state;
-                      if (g_chainstate.AcceptBlock(pblock, state, chainparams, nullptr, true, dbp, nullptr)) {
-                          nLoaded++;
-                      }
-                      if (state.IsError()) {
-                          break;
-                      }
-                    } else if (hash != chainparams.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
-                      LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
+            // A block that could not be decoded, or ended before the size in
+            // front of it said, makes the scan resume where it would have
+            // without reading ahead, and what was read past it is dropped.
+            bool fResync = false;
+            uint64_t nResyncPos = 0;
+            try {
+                for (const CImportBlock& item : vBatch) {
+                    boost::this_thread::interruption_point();
+                    if (!AcceptImportedBlock(chainparams, item, dbp, mapBlocksUnknownParent, nLoaded)) {
+                        fAbort = true;
+                        break;
                     }
-                }
-
-                // Activate the genesis block so normal node progress can continue
-                if (hash == chainparams.GetConsensus().hashGenesisBlock) {
-                    CValidationState state;
-                    if (!ActivateBestChain(state, chainparams)) {
+                    if (item.nRewind != item.nBlockPos + item.nSize) {
+                        nResyncPos = item.nRewind;
+                        fResync = true;
                         break;
                     }
                 }
-
-                NotifyHeaderTip();
-
-                // Recursively process earlier encountered successors of this block
-                std::deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, FlatFilePos>::iterator, std::multimap<uint256, FlatFilePos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, FlatFilePos>::iterator it = range.first;
-                        std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
-                        if (ReadBlockFromDisk(*pblockrecursive, it->second, chainparams.GetConsensus()))
-                        {
-                            LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
-                                    head.ToString());
-                            LOCK(cs_main);
-                            CValidationState dummy;
-                            if (g_chainstate.AcceptBlock(pblockrecursive, dummy, chainparams, nullptr, true, &it->second, nullptr))
-                            {
-                                nLoaded++;
-                                queue.push_back(pblockrecursive->GetHash());
-                            }
-                        }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
-                        NotifyHeaderTip();
-                    }
+            } catch (...) {
+                if (prefetch.joinable())
+                    prefetch.join();
+                throw;
+            }
+            if (prefetch.joinable())
+                prefetch.join();
+
+            vBatch.clear();
+            if (fResync) {
+                vNext.clear();
+                nRewind = nResyncPos;
+                if (!blkdat.SetPos(nRewind) && !blkdat.Seek(nRewind)) {
+                    LogPrintf("%s: Cannot seek back to position %u\n", __func__, nRewind);
+                    break;
                 }
-            } catch (const std::exception& e) {
-                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+                fMore = ReadImportBatch(chainparams, blkdat, nRewind, vBatch);
+                DecodeImportBatch(chainparams.GetConsensus(), vBatch);
+            } else {
+                vBatch.swap(vNext);
+                nRewind = nNextRewind;
+                fMore = fNextMore;
             }
         }
     } catch (const std::runtime_error& e) {
@@ -4605,6 +5171,7 @@ void CChainState::CheckBlockIndex(const Consensus::Params& consensusParams)
         assert(pindex->nHeight == nHeight); // nHeight must be consistent.
         assert(pindex->pprev == nullptr || pindex->nChainWork >= pindex->pprev->nChainWork); // For every block except the genesis block, the chainwork must be larger than the parent's.
         assert(nHeight < 2 || (pindex->pskip && (pindex->pskip->nHeight < nHeight))); // The pskip pointer must point back for all but the first 2 blocks.
+        assert(pindex->pprevSameAlgo == (pindex->pprev ? pindex->pprev->GetLastOfAlgo(pindex->GetAlgo()) : nullptr)); // pprevSameAlgo must be the nearest same-algorithm predecessor.
         assert(pindexFirstNotTreeValid == nullptr); // All mapBlockIndex entries must at least be TREE valid
         if ((pindex->nStatus & BLOCK_VALID_MASK) >= BLOCK_VALID_TREE) assert(pindexFirstNotTreeValid == nullptr); // TREE valid implies all parents are TREE valid
         if ((pindex->nStatus & BLOCK_VALID_MASK) >= BLOCK_VALID_CHAIN) assert(pindexFirstNotChainValid == nullptr); // CHAIN valid implies all parents are CHAIN valid
@@ -4715,7 +5282,7 @@ void CChainState::CheckBlockIndex(const Consensus::Params& consensusParams)
 
 std::string CBlockFileInfo::ToString() const
 {
-    return strprintf("CBlockFileInfo(blocks=%u, size=%u, heights=%u...%u, time=%s...%s)", nBlocks, nSize, nHeightFirst, nHeightLast, FormatISO8601Date(nTimeFirst), FormatISO8601Date(nTimeLast));
+    return strprintf("CBlockFileInfo(blocks=%u, size=%u, heights=%u...%u, time=%s...%s, flags=%u)", nBlocks, nSize, nHeightFirst, nHeightLast, FormatISO8601Date(nTimeFirst), FormatISO8601Date(nTimeLast), nFlags);
 }
 
 CBlockFileInfo* GetBlockFileInfo(size_t n)
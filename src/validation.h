@@ -22,6 +22,7 @@
 
 #include <algorithm>
 #include <exception>
+#include <functional>
 #include <map>
 #include <memory>
 #include <set>
@@ -77,11 +78,23 @@ static const unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
 static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
 /** The pre-allocation chunk size for rev?????.dat files (since 0.8) */
 static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
+/** Number of block files, and of undo files, kept memory mapped for reading. Address space is too scarce for it on 32-bit systems. */
+static const size_t MAX_MAPPED_BLOCK_FILES = sizeof(void*) >= 8 ? 16 : 0;
+/** Default for -blockcompression, storing new blocks LZ4 compressed */
+static const bool DEFAULT_BLOCK_COMPRESSION = false;
+/** Flag in the size field of a block file record whose block is LZ4 compressed. Older versions take such records for oversized and skip them. */
+static const uint32_t BLOCK_RECORD_COMPRESSED = 0x80000000;
 
 /** Maximum number of script-checking threads allowed */
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Number of same-algorithm headers hashed by one worker job */
+static const size_t HEADER_HASH_CHECK_BATCH = 8;
+/** Number of blocks an import from block files reads and decodes ahead of accepting them */
+static const size_t IMPORT_BATCH_BLOCKS = 256;
+/** Serialized size of blocks after which such a batch is cut short */
+static const size_t IMPORT_BATCH_BYTES = 16 << 20;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 256;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -205,6 +218,8 @@ extern bool fHavePruned;
 extern bool fPruneMode;
 /** Number of MiB of block files that we're trying to stay below. */
 extern uint64_t nPruneTarget;
+/** True if new blocks are written LZ4 compressed (-blockcompression). */
+extern bool fBlockCompression;
 /** Block files containing a block-height within MIN_BLOCKS_TO_KEEP of chainActive.Tip() will not be pruned. */
 static const unsigned int MIN_BLOCKS_TO_KEEP = 288;
 /** Minimum blocks required to signal NODE_NETWORK_LIMITED */
@@ -259,6 +274,15 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
  */
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& block, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex=nullptr, CBlockHeader *first_invalid=nullptr);
 
+/**
+ * Compute the identity and, if fPoWHashes, the proof-of-work hashes of a
+ * batch of headers on the worker threads and store them in the header hash
+ * caches, so that validating the headers afterwards does not hash them
+ * again. The headers are not checked, so only pass a batch that got past
+ * the checks that need no hashing.
+ */
+void PrecomputeHeaderHashes(const std::vector<CBlockHeader>& headers, bool fPoWHashes = true);
+
 /** Open a block file (blk?????.dat) */
 FILE* OpenBlockFile(const FlatFilePos &pos, bool fReadOnly = false);
 /** Translation to a filesystem path */
@@ -276,6 +300,41 @@ bool LoadChainTip(const CChainParams& chainparams);
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/**
+ * A job for the worker threads: header hashing and block file imports
+ * share one set of -par sized threads. The wallet runs its scans on its own.
+ */
+class CWorkerJob
+{
+private:
+    std::function<bool()> func;
+
+public:
+    CWorkerJob() {}
+    explicit CWorkerJob(std::function<bool()> funcIn) : func(std::move(funcIn)) {}
+
+    bool operator()() { return func(); }
+
+    void swap(CWorkerJob& job) { func.swap(job.func); }
+};
+/** Run an instance of the worker thread */
+void ThreadWorkerJobs();
+/**
+ * Run jobs on the worker threads and wait for them, or on this thread if
+ * there are none. Callers take turns, so a job must not run jobs itself.
+ * Jobs must not take cs_main either: callers may hold it while they wait.
+ */
+bool RunWorkerJobs(std::vector<CWorkerJob>& vJobs);
+/** Run a vector of check closures through RunWorkerJobs */
+template <typename T>
+bool RunWorkerChecks(std::vector<T>& vChecks)
+{
+    std::vector<CWorkerJob> vJobs;
+    vJobs.reserve(vChecks.size());
+    for (T& check : vChecks)
+        vJobs.emplace_back(std::ref(check));
+    return RunWorkerJobs(vJobs);
+}
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
@@ -405,8 +464,12 @@ void InitScriptExecutionCache();
 /** Functions for disk access for blocks */
 bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Same, for the position of pindex the caller read under cs_main; does not take cs_main */
+bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const FlatFilePos& pos, const Consensus::Params& consensusParams);
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start);
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start);
+/** Serialized block of an index entry, shared with and kept in the raw block cache */
+bool ReadRawBlockFromDisk(std::shared_ptr<const std::vector<uint8_t>>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start);
 
 /** Functions for validating blocks and updating the block tree */
 
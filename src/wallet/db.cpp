@@ -10,6 +10,7 @@
 #include <hash.h>
 #include <protocol.h>
 #include <util/strencodings.h>
+#include <wallet/ldb.h>
 #include <wallet/walletutil.h>
 
 #include <stdint.h>
@@ -444,7 +445,7 @@ void BerkeleyEnvironment::CheckpointLSN(const std::string& strFile)
 }
 
 
-BerkeleyBatch::BerkeleyBatch(BerkeleyDatabase& database, const char* pszMode, bool fFlushOnCloseIn) : pdb(nullptr), activeTxn(nullptr)
+BerkeleyBatch::BerkeleyBatch(BerkeleyDatabase& database, const char* pszMode, bool fFlushOnCloseIn) : pdb(nullptr), activeTxn(nullptr), m_cursor(nullptr)
 {
     fReadOnly = (!strchr(pszMode, '+') && !strchr(pszMode, 'w'));
     fFlushOnClose = fFlushOnCloseIn;
@@ -536,7 +537,7 @@ void BerkeleyBatch::Flush()
     env->dbenv->txn_checkpoint(nMinutes ? gArgs.GetArg("-dblogsize", DEFAULT_WALLET_DBLOGSIZE) * 1024 : 0, nMinutes, 0);
 }
 
-void BerkeleyDatabase::IncrementUpdateCounter()
+void WalletDatabase::IncrementUpdateCounter()
 {
     ++nUpdateCounter;
 }
@@ -545,6 +546,7 @@ void BerkeleyBatch::Close()
 {
     if (!pdb)
         return;
+    CloseCursor();
     if (activeTxn)
         activeTxn->abort();
     activeTxn = nullptr;
@@ -559,6 +561,155 @@ void BerkeleyBatch::Close()
     }
 }
 
+bool BerkeleyBatch::ReadKey(CDataStream& ssKey, CDataStream& ssValue)
+{
+    if (!pdb)
+        return false;
+
+    Dbt datKey(ssKey.data(), ssKey.size());
+
+    // Read
+    Dbt datValue;
+    datValue.set_flags(DB_DBT_MALLOC);
+    int ret = pdb->get(activeTxn, &datKey, &datValue, 0);
+    if (datValue.get_data() == nullptr)
+        return false;
+    ssValue.write((char*)datValue.get_data(), datValue.get_size());
+
+    // Clear and free memory
+    memory_cleanse(datValue.get_data(), datValue.get_size());
+    free(datValue.get_data());
+    return ret == 0;
+}
+
+bool BerkeleyBatch::WriteKey(CDataStream& ssKey, CDataStream& ssValue, bool fOverwrite)
+{
+    if (!pdb)
+        return true;
+    if (fReadOnly)
+        assert(!"Write called on database in read-only mode");
+
+    Dbt datKey(ssKey.data(), ssKey.size());
+    Dbt datValue(ssValue.data(), ssValue.size());
+
+    // Write
+    int ret = pdb->put(activeTxn, &datKey, &datValue, (fOverwrite ? 0 : DB_NOOVERWRITE));
+    return (ret == 0);
+}
+
+bool BerkeleyBatch::EraseKey(CDataStream& ssKey)
+{
+    if (!pdb)
+        return false;
+    if (fReadOnly)
+        assert(!"Erase called on database in read-only mode");
+
+    Dbt datKey(ssKey.data(), ssKey.size());
+
+    // Erase
+    int ret = pdb->del(activeTxn, &datKey, 0);
+    return (ret == 0 || ret == DB_NOTFOUND);
+}
+
+bool BerkeleyBatch::HasKey(CDataStream& ssKey)
+{
+    if (!pdb)
+        return false;
+
+    Dbt datKey(ssKey.data(), ssKey.size());
+
+    // Exists
+    int ret = pdb->exists(activeTxn, &datKey, 0);
+    return (ret == 0);
+}
+
+bool BerkeleyBatch::StartCursor()
+{
+    assert(!m_cursor);
+    if (!pdb)
+        return false;
+    int ret = pdb->cursor(nullptr, &m_cursor, 0);
+    return ret == 0;
+}
+
+bool BerkeleyBatch::ReadAtCursor(CDataStream& ssKey, CDataStream& ssValue, bool& complete, bool setRange)
+{
+    complete = false;
+    if (m_cursor == nullptr)
+        return false;
+
+    // Read at cursor
+    Dbt datKey;
+    unsigned int fFlags = DB_NEXT;
+    if (setRange) {
+        datKey.set_data(ssKey.data());
+        datKey.set_size(ssKey.size());
+        fFlags = DB_SET_RANGE;
+    }
+    Dbt datValue;
+    datKey.set_flags(DB_DBT_MALLOC);
+    datValue.set_flags(DB_DBT_MALLOC);
+    int ret = m_cursor->get(&datKey, &datValue, fFlags);
+    if (ret == DB_NOTFOUND) {
+        complete = true;
+        return false;
+    }
+    if (ret != 0 || datKey.get_data() == nullptr || datValue.get_data() == nullptr)
+        return false;
+
+    // Convert to streams
+    ssKey.SetType(SER_DISK);
+    ssKey.clear();
+    ssKey.write((char*)datKey.get_data(), datKey.get_size());
+    ssValue.SetType(SER_DISK);
+    ssValue.clear();
+    ssValue.write((char*)datValue.get_data(), datValue.get_size());
+
+    // Clear and free memory
+    memory_cleanse(datKey.get_data(), datKey.get_size());
+    memory_cleanse(datValue.get_data(), datValue.get_size());
+    free(datKey.get_data());
+    free(datValue.get_data());
+    return true;
+}
+
+void BerkeleyBatch::CloseCursor()
+{
+    if (!m_cursor)
+        return;
+    m_cursor->close();
+    m_cursor = nullptr;
+}
+
+bool BerkeleyBatch::TxnBegin()
+{
+    if (!pdb || activeTxn)
+        return false;
+    DbTxn* ptxn = env->TxnBegin();
+    if (!ptxn)
+        return false;
+    activeTxn = ptxn;
+    return true;
+}
+
+bool BerkeleyBatch::TxnCommit()
+{
+    if (!pdb || !activeTxn)
+        return false;
+    int ret = activeTxn->commit(0);
+    activeTxn = nullptr;
+    return (ret == 0);
+}
+
+bool BerkeleyBatch::TxnAbort()
+{
+    if (!pdb || !activeTxn)
+        return false;
+    int ret = activeTxn->abort();
+    activeTxn = nullptr;
+    return (ret == 0);
+}
+
 void BerkeleyEnvironment::CloseDb(const std::string& strFile)
 {
     {
@@ -607,17 +758,15 @@ bool BerkeleyBatch::Rewrite(BerkeleyDatabase& database, const char* pszSkip)
                         fSuccess = false;
                     }
 
-                    Dbc* pcursor = db.GetCursor();
-                    if (pcursor)
+                    if (db.StartCursor())
                         while (fSuccess) {
                             CDataStream ssKey(SER_DISK, CLIENT_VERSION);
                             CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-                            int ret1 = db.ReadAtCursor(pcursor, ssKey, ssValue);
-                            if (ret1 == DB_NOTFOUND) {
-                                pcursor->close();
+                            bool complete;
+                            bool ret1 = db.ReadAtCursor(ssKey, ssValue, complete);
+                            if (complete) {
                                 break;
-                            } else if (ret1 != 0) {
-                                pcursor->close();
+                            } else if (!ret1) {
                                 fSuccess = false;
                                 break;
                             }
@@ -635,6 +784,7 @@ bool BerkeleyBatch::Rewrite(BerkeleyDatabase& database, const char* pszSkip)
                             if (ret2 > 0)
                                 fSuccess = false;
                         }
+                    db.CloseCursor();
                     if (fSuccess) {
                         db.Close();
                         env->CloseDb(strFile);
@@ -745,6 +895,23 @@ bool BerkeleyBatch::PeriodicFlush(BerkeleyDatabase& database)
     return ret;
 }
 
+bool BerkeleyDatabase::Exists(const fs::path& wallet_path)
+{
+    if (fs::is_regular_file(wallet_path))
+        return true;
+    return fs::exists(wallet_path / "wallet.dat");
+}
+
+std::unique_ptr<DatabaseBatch> BerkeleyDatabase::MakeBatch(const char* pszMode, bool fFlushOnClose)
+{
+    return MakeUnique<BerkeleyBatch>(*this, pszMode, fFlushOnClose);
+}
+
+bool BerkeleyDatabase::PeriodicFlush()
+{
+    return BerkeleyBatch::PeriodicFlush(*this);
+}
+
 bool BerkeleyDatabase::Rewrite(const char* pszSkip)
 {
     return BerkeleyBatch::Rewrite(*this, pszSkip);
@@ -797,3 +964,70 @@ void BerkeleyDatabase::Flush(bool shutdown)
         env->Flush(shutdown);
     }
 }
+
+std::unique_ptr<WalletDatabase> WalletDatabase::Create(const fs::path& path)
+{
+    if (IsLevelDBWallet(path)) {
+        return MakeUnique<LevelDBDatabase>(LevelDBDatabase::StorePath(path));
+    }
+    return MakeUnique<BerkeleyDatabase>(path);
+}
+
+std::unique_ptr<WalletDatabase> WalletDatabase::CreateDummy()
+{
+    return MakeUnique<BerkeleyDatabase>();
+}
+
+std::unique_ptr<WalletDatabase> WalletDatabase::CreateMock()
+{
+    return MakeUnique<BerkeleyDatabase>("", true /* mock */);
+}
+
+bool IsLevelDBWallet(const fs::path& wallet_path)
+{
+    if (fs::is_directory(LevelDBDatabase::StorePath(wallet_path)))
+        return true;
+    // A BerkeleyDB wallet is only moved over by WalletBatch::MigrateDatabase
+    return gArgs.GetArg("-walletbackend", DEFAULT_WALLET_BACKEND) == "leveldb" && !BerkeleyDatabase::Exists(wallet_path);
+}
+
+bool CopyDatabase(WalletDatabase& from, WalletDatabase& to, const char* pszSkip)
+{
+    std::unique_ptr<DatabaseBatch> source = from.MakeBatch("r", false);
+    std::unique_ptr<DatabaseBatch> target = to.MakeBatch("cr+");
+    if (!source->StartCursor())
+        return false;
+
+    // Write in transactions of bounded size, so a large wallet isn't held in memory twice
+    const unsigned int nTxnRecords = 10000;
+    unsigned int nRecords = 0;
+    bool fSuccess = target->TxnBegin();
+    while (fSuccess) {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        bool complete;
+        bool ret = source->ReadAtCursor(ssKey, ssValue, complete);
+        if (complete) {
+            break;
+        } else if (!ret) {
+            fSuccess = false;
+            break;
+        }
+        if (pszSkip &&
+            strncmp(ssKey.data(), pszSkip, std::min(ssKey.size(), strlen(pszSkip))) == 0)
+            continue;
+
+        fSuccess = target->Write(SerializedRecord(ssKey), SerializedRecord(ssValue));
+        if (fSuccess && ++nRecords % nTxnRecords == 0) {
+            fSuccess = target->TxnCommit() && target->TxnBegin();
+        }
+    }
+    source->CloseCursor();
+
+    if (fSuccess) {
+        fSuccess = target->TxnCommit();
+    } else {
+        target->TxnAbort();
+    }
+    return fSuccess;
+}
@@ -73,6 +73,7 @@ void WalletInit::AddWalletOptions() const
     gArgs.AddArg("-txconfirmtarget=<n>", strprintf("If paytxfee is not set, include enough fee so transactions begin confirmation on average within n blocks (default: %u)", DEFAULT_TX_CONFIRM_TARGET), false, OptionsCategory::WALLET);
     gArgs.AddArg("-upgradewallet", "Upgrade wallet to latest format on startup", false, OptionsCategory::WALLET);
     gArgs.AddArg("-wallet=<path>", "Specify wallet database path. Can be specified multiple times to load multiple wallets. Path is interpreted relative to <walletdir> if it is not absolute, and will be created if it does not exist (as a directory containing a wallet.dat file and log files). For backwards compatibility this will also accept names of existing data files in <walletdir>.)", false, OptionsCategory::WALLET);
+    gArgs.AddArg("-walletbackend=<backend>", strprintf("Database to keep new wallets in, \"bdb\" or \"leveldb\". BerkeleyDB wallets are moved to LevelDB when loaded with \"leveldb\" (default: %s)", DEFAULT_WALLET_BACKEND), false, OptionsCategory::WALLET);
     gArgs.AddArg("-walletbroadcast",  strprintf("Make the wallet broadcast transactions (default: %u)", DEFAULT_WALLETBROADCAST), false, OptionsCategory::WALLET);
     gArgs.AddArg("-walletdir=<dir>", "Specify directory to hold wallets (default: <datadir>/wallets if it exists, otherwise <datadir>)", false, OptionsCategory::WALLET);
     gArgs.AddArg("-walletnotify=<cmd>", "Execute command when a wallet transaction changes (%s in cmd is replaced by TxID)", false, OptionsCategory::WALLET);
@@ -111,6 +112,11 @@ bool WalletInit::ParameterInteraction() const
     
     LogPrintf("%s: Using algo: %s %d\n", __func__, strAlgo.c_str(), ALGO);
 
+    const std::string backend = gArgs.GetArg("-walletbackend", DEFAULT_WALLET_BACKEND);
+    if (backend != "bdb" && backend != "leveldb") {
+        return InitError(strprintf(_("Unknown wallet backend requested (-walletbackend=%s)"), backend));
+    }
+
     if (gArgs.GetBoolArg("-salvagewallet", false)) {
         if (is_multiwallet) {
             return InitError(strprintf("%s is only allowed with a single wallet file", "-salvagewallet"));
@@ -235,6 +241,9 @@ bool WalletInit::Open() const
         return true;
     }
 
+    // Loading a wallet may rescan, so have the scan threads ready first
+    StartWalletScanThreads();
+
     for (const std::string& walletFile : gArgs.GetArgs("-wallet")) {
         std::shared_ptr<CWallet> pwallet = CWallet::CreateWalletFromFile(walletFile, fs::absolute(walletFile, GetWalletDir()));
         if (!pwallet) {
@@ -275,4 +284,5 @@ void WalletInit::Close() const
     for (const std::shared_ptr<CWallet>& pwallet : GetWallets()) {
         RemoveWallet(pwallet);
     }
+    StopWalletScanThreads();
 }
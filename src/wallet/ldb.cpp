@@ -0,0 +1,354 @@
+// Copyright (c) 2018-2020 The Verge Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <wallet/ldb.h>
+
+#include <dbwrapper.h>
+#include <util/system.h>
+#include <util/time.h>
+
+LevelDBDatabase::LevelDBDatabase(const fs::path& path, bool mock, bool wipe) :
+    m_path(path), m_mock(mock), m_wipe(wipe)
+{
+}
+
+LevelDBDatabase::~LevelDBDatabase()
+{
+}
+
+std::unique_ptr<LevelDBDatabase> LevelDBDatabase::CreateMock()
+{
+    return MakeUnique<LevelDBDatabase>("mock", true /* mock */);
+}
+
+fs::path LevelDBDatabase::StorePath(const fs::path& wallet_path)
+{
+    if (fs::is_directory(wallet_path))
+        return wallet_path / "wallet.ldb";
+    // For backwards compatibility wallets can be data files in -walletdir,
+    // which are renamed once moved over
+    const fs::path file_store_path = wallet_path.string() + ".ldb";
+    if (fs::is_regular_file(wallet_path) || fs::is_directory(file_store_path))
+        return file_store_path;
+    return wallet_path / "wallet.ldb";
+}
+
+bool LevelDBDatabase::Migrate(const fs::path& wallet_path, std::string& warningStr, std::string& errorStr)
+{
+    const fs::path store_path = StorePath(wallet_path);
+    const fs::path temp_path = store_path.string() + ".tmp";
+    const fs::path data_path = fs::is_regular_file(wallet_path) ? wallet_path : wallet_path / "wallet.dat";
+    const fs::path migrated_path = data_path.string() + ".migrated";
+    LogPrintf("Moving wallet %s to LevelDB...\n", wallet_path.string());
+    int64_t nStart = GetTimeMillis();
+
+    try {
+        BerkeleyDatabase source(wallet_path);
+        bool fSuccess;
+        {
+            // Whatever an interrupted attempt left behind is wiped
+            LevelDBDatabase target(temp_path, false /* mock */, true /* wipe */);
+            fSuccess = CopyDatabase(source, target);
+        }
+        source.Flush(false);
+        if (!fSuccess) {
+            errorStr = strprintf("Error moving wallet %s to LevelDB, could not copy all records", wallet_path.string());
+            return false;
+        }
+        fs::rename(temp_path, store_path);
+    } catch (const std::exception& e) {
+        errorStr = strprintf("Error moving wallet %s to LevelDB: %s", wallet_path.string(), e.what());
+        return false;
+    }
+    LogPrintf("Moved wallet %s to %s in %dms\n", wallet_path.string(), store_path.string(), GetTimeMillis() - nStart);
+
+    // The store is in use from here on, so an old copy of the wallet only
+    // has to be kept out of the way of anything still opening wallet.dat
+    try {
+        fs::rename(data_path, migrated_path);
+    } catch (const fs::filesystem_error& e) {
+        LogPrintf("Could not rename %s: %s\n", data_path.string(), e.what());
+        warningStr = strprintf(_("Wallet %s was moved to %s, but %s could not be renamed. It is no longer kept up to date and should not be used."),
+            wallet_path.string(), store_path.string(), data_path.string());
+        return true;
+    }
+    warningStr = strprintf(_("Wallet %s was moved to %s. The old wallet file, no longer kept up to date, was renamed to %s."),
+        wallet_path.string(), store_path.string(), migrated_path.string());
+    return true;
+}
+
+std::shared_ptr<CDBWrapper> LevelDBDatabase::GetDB()
+{
+    LOCK(cs_ldb);
+    if (!m_db) {
+        m_db = std::make_shared<CDBWrapper>(m_path, WALLET_LDB_CACHE_SIZE, m_mock, m_wipe);
+        m_wipe = false;
+    }
+    return m_db;
+}
+
+std::unique_ptr<DatabaseBatch> LevelDBDatabase::MakeBatch(const char* pszMode, bool fFlushOnClose)
+{
+    return MakeUnique<LevelDBBatch>(*this, pszMode, fFlushOnClose);
+}
+
+bool LevelDBDatabase::Rewrite(const char* pszSkip)
+{
+    std::shared_ptr<CDBWrapper> db = GetDB();
+    LogPrintf("LevelDBDatabase::Rewrite: Rewriting %s...\n", m_path.string());
+
+    CDBBatch batch(*db);
+    if (pszSkip) {
+        std::unique_ptr<CDBIterator> pcursor(db->NewIterator());
+        const size_t nSkip = strlen(pszSkip);
+        for (pcursor->SeekToFirst(); pcursor->Valid(); pcursor->Next()) {
+            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+            SerializedRecord key(ssKey);
+            if (!pcursor->GetKey(key))
+                return false;
+            if (strncmp(ssKey.data(), pszSkip, std::min(ssKey.size(), nSkip)) == 0)
+                batch.Erase(key);
+        }
+    }
+    batch.Write(std::string("version"), CLIENT_VERSION);
+    if (!db->WriteBatch(batch, true))
+        return false;
+
+    // Erased records stay in older tables until they are compacted away
+    db->CompactFull();
+    return true;
+}
+
+bool LevelDBDatabase::Backup(const std::string& strDest)
+{
+    fs::path pathDest(strDest);
+    if (fs::is_directory(pathDest))
+        pathDest /= m_path.filename();
+
+    try {
+        if (fs::exists(pathDest) && fs::equivalent(m_path, pathDest)) {
+            LogPrintf("cannot backup to wallet source file %s\n", pathDest.string());
+            return false;
+        }
+
+        LevelDBDatabase backup(pathDest, false /* mock */, true /* wipe */);
+        if (!CopyDatabase(*this, backup)) {
+            LogPrintf("error copying %s to %s\n", m_path.string(), pathDest.string());
+            return false;
+        }
+        backup.Flush(true);
+        LogPrintf("copied %s to %s\n", m_path.string(), pathDest.string());
+        return true;
+    } catch (const std::exception& e) {
+        LogPrintf("error copying %s to %s - %s\n", m_path.string(), pathDest.string(), e.what());
+        return false;
+    }
+}
+
+void LevelDBDatabase::Flush(bool shutdown)
+{
+    LOCK(cs_ldb);
+    if (!m_db)
+        return;
+    m_db->Sync();
+    if (shutdown && !m_mock)
+        m_db.reset();
+}
+
+bool LevelDBDatabase::PeriodicFlush()
+{
+    LOCK(cs_ldb);
+    if (m_db) {
+        int64_t nStart = GetTimeMillis();
+        m_db->Sync();
+        LogPrint(BCLog::DB, "Flushed %s %dms\n", m_path.string(), GetTimeMillis() - nStart);
+    }
+    return true;
+}
+
+
+LevelDBBatch::LevelDBBatch(LevelDBDatabase& database, const char* pszMode, bool fFlushOnCloseIn) :
+    m_db(database.GetDB()), m_cursor_started(false), m_unsynced(false), m_txn_active(false)
+{
+    fReadOnly = (!strchr(pszMode, '+') && !strchr(pszMode, 'w'));
+    fFlushOnClose = fFlushOnCloseIn;
+
+    if (strchr(pszMode, 'c') != nullptr && !Exists(std::string("version"))) {
+        bool fTmp = fReadOnly;
+        fReadOnly = false;
+        WriteVersion(CLIENT_VERSION);
+        fReadOnly = fTmp;
+    }
+}
+
+LevelDBBatch::~LevelDBBatch()
+{
+    Close();
+}
+
+bool LevelDBBatch::ReadKey(CDataStream& ssKey, CDataStream& ssValue)
+{
+    if (!m_db)
+        return false;
+
+    if (m_txn_active) {
+        auto it = m_txn.find(CSerializeData(ssKey.begin(), ssKey.end()));
+        if (it != m_txn.end()) {
+            if (it->second.first)
+                return false;
+            ssValue.write(it->second.second.data(), it->second.second.size());
+            return true;
+        }
+    }
+    SerializedRecord value(ssValue);
+    return m_db->Read(SerializedRecord(ssKey), value);
+}
+
+bool LevelDBBatch::WriteKey(CDataStream& ssKey, CDataStream& ssValue, bool fOverwrite)
+{
+    if (!m_db)
+        return false;
+    if (fReadOnly)
+        assert(!"Write called on database in read-only mode");
+    if (!fOverwrite && HasKey(ssKey))
+        return false;
+
+    if (m_txn_active) {
+        m_txn[CSerializeData(ssKey.begin(), ssKey.end())] = std::make_pair(false, CSerializeData(ssValue.begin(), ssValue.end()));
+        return true;
+    }
+    m_unsynced = true;
+    return m_db->Write(SerializedRecord(ssKey), SerializedRecord(ssValue));
+}
+
+bool LevelDBBatch::EraseKey(CDataStream& ssKey)
+{
+    if (!m_db)
+        return false;
+    if (fReadOnly)
+        assert(!"Erase called on database in read-only mode");
+
+    if (m_txn_active) {
+        m_txn[CSerializeData(ssKey.begin(), ssKey.end())] = std::make_pair(true, CSerializeData());
+        return true;
+    }
+    m_unsynced = true;
+    return m_db->Erase(SerializedRecord(ssKey));
+}
+
+bool LevelDBBatch::HasKey(CDataStream& ssKey)
+{
+    if (!m_db)
+        return false;
+
+    if (m_txn_active) {
+        auto it = m_txn.find(CSerializeData(ssKey.begin(), ssKey.end()));
+        if (it != m_txn.end())
+            return !it->second.first;
+    }
+    return m_db->Exists(SerializedRecord(ssKey));
+}
+
+void LevelDBBatch::Flush()
+{
+    if (!m_db || m_txn_active || !m_unsynced)
+        return;
+
+    // Only the log needs to reach the disk, which is a single append
+    m_db->Sync();
+    m_unsynced = false;
+}
+
+void LevelDBBatch::Close()
+{
+    if (!m_db)
+        return;
+    CloseCursor();
+    TxnAbort();
+
+    if (fFlushOnClose)
+        Flush();
+    m_db.reset();
+}
+
+bool LevelDBBatch::StartCursor()
+{
+    assert(!m_cursor);
+    if (!m_db)
+        return false;
+    m_cursor.reset(m_db->NewIterator());
+    m_cursor_started = false;
+    return true;
+}
+
+bool LevelDBBatch::ReadAtCursor(CDataStream& ssKey, CDataStream& ssValue, bool& complete, bool setRange)
+{
+    complete = false;
+    if (!m_cursor)
+        return false;
+
+    if (setRange) {
+        m_cursor->Seek(SerializedRecord(ssKey));
+    } else if (m_cursor_started) {
+        m_cursor->Next();
+    } else {
+        m_cursor->SeekToFirst();
+    }
+    m_cursor_started = true;
+    if (!m_cursor->Valid()) {
+        complete = true;
+        return false;
+    }
+
+    ssKey.SetType(SER_DISK);
+    ssKey.clear();
+    ssValue.SetType(SER_DISK);
+    ssValue.clear();
+    SerializedRecord key(ssKey);
+    SerializedRecord value(ssValue);
+    return m_cursor->GetKey(key) && m_cursor->GetValue(value);
+}
+
+void LevelDBBatch::CloseCursor()
+{
+    m_cursor.reset();
+}
+
+bool LevelDBBatch::TxnBegin()
+{
+    if (!m_db || m_txn_active)
+        return false;
+    m_txn_active = true;
+    return true;
+}
+
+bool LevelDBBatch::TxnCommit()
+{
+    if (!m_db || !m_txn_active)
+        return false;
+
+    CDBBatch batch(*m_db);
+    for (const auto& entry : m_txn) {
+        CDataStream ssKey(entry.first.begin(), entry.first.end(), SER_DISK, CLIENT_VERSION);
+        if (entry.second.first) {
+            batch.Erase(SerializedRecord(ssKey));
+        } else {
+            CDataStream ssValue(entry.second.second.begin(), entry.second.second.end(), SER_DISK, CLIENT_VERSION);
+            batch.Write(SerializedRecord(ssKey), SerializedRecord(ssValue));
+        }
+    }
+    m_txn.clear();
+    m_txn_active = false;
+    m_unsynced = true;
+    return m_db->WriteBatch(batch);
+}
+
+bool LevelDBBatch::TxnAbort()
+{
+    if (!m_db || !m_txn_active)
+        return false;
+    m_txn.clear();
+    m_txn_active = false;
+    return true;
+}
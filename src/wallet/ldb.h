@@ -0,0 +1,112 @@
+// Copyright (c) 2018-2020 The Verge Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef VERGE_WALLET_LDB_H
+#define VERGE_WALLET_LDB_H
+
+#include <wallet/db.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+class CDBIterator;
+class CDBWrapper;
+
+//! LevelDB block cache of each open wallet
+static const size_t WALLET_LDB_CACHE_SIZE = 8 << 20;
+
+/**
+ * Wallet database kept in a LevelDB store instead of a BerkeleyDB file.
+ *
+ * The records are the same serialized key/value pairs in the same bytewise
+ * key order, so WalletBatch works on either. LevelDB only appends to its
+ * log and sorted tables: a write costs about the size of the record rather
+ * than a page and a log entry, and loading reads the tables sequentially.
+ */
+class LevelDBDatabase : public WalletDatabase
+{
+    friend class LevelDBBatch;
+public:
+    /** Open the store at path on first use, wiping it first if asked to. A mock store lives in memory. */
+    explicit LevelDBDatabase(const fs::path& path, bool mock = false, bool wipe = false);
+    ~LevelDBDatabase() override;
+
+    /** Return object for accessing temporary in-memory database. */
+    static std::unique_ptr<LevelDBDatabase> CreateMock();
+
+    /** Location of the store of the wallet at wallet_path, next to where its wallet.dat would be. */
+    static fs::path StorePath(const fs::path& wallet_path);
+
+    /**
+     * Copy the BerkeleyDB wallet at wallet_path into a new store. The store
+     * only takes its place once complete; wallet.dat is then renamed to
+     * wallet.dat.migrated and warningStr says so.
+     */
+    static bool Migrate(const fs::path& wallet_path, std::string& warningStr, std::string& errorStr);
+
+    std::unique_ptr<DatabaseBatch> MakeBatch(const char* pszMode = "r+", bool fFlushOnClose = true) override;
+
+    bool Rewrite(const char* pszSkip = nullptr) override;
+
+    /** Copy the records into a new store at strDest, or in it if it is a directory. */
+    bool Backup(const std::string& strDest) override;
+
+    void Flush(bool shutdown) override;
+
+    bool PeriodicFlush() override;
+
+private:
+    std::shared_ptr<CDBWrapper> GetDB();
+
+    CCriticalSection cs_ldb;
+    //! Shared with the open batches, so the store stays open until the last of them is gone
+    std::shared_ptr<CDBWrapper> m_db GUARDED_BY(cs_ldb);
+    const fs::path m_path;
+    const bool m_mock;
+    bool m_wipe GUARDED_BY(cs_ldb);
+};
+
+/**
+ * RAII class that provides access to a LevelDB wallet store. Writes in a
+ * transaction are held back and written as one atomic LevelDB batch on
+ * commit; reads in it see them, cursors do not.
+ */
+class LevelDBBatch : public DatabaseBatch
+{
+private:
+    std::shared_ptr<CDBWrapper> m_db;
+    std::unique_ptr<CDBIterator> m_cursor;
+    bool m_cursor_started;
+    bool fReadOnly;
+    bool fFlushOnClose;
+    //! Whether writes went out since the last sync
+    bool m_unsynced;
+    bool m_txn_active;
+    //! Writes of the open transaction by key, with whether they erase it
+    std::map<CSerializeData, std::pair<bool, CSerializeData>> m_txn;
+
+    bool ReadKey(CDataStream& ssKey, CDataStream& ssValue) override;
+    bool WriteKey(CDataStream& ssKey, CDataStream& ssValue, bool fOverwrite = true) override;
+    bool EraseKey(CDataStream& ssKey) override;
+    bool HasKey(CDataStream& ssKey) override;
+
+public:
+    explicit LevelDBBatch(LevelDBDatabase& database, const char* pszMode = "r+", bool fFlushOnCloseIn = true);
+    ~LevelDBBatch() override;
+
+    void Flush() override;
+    void Close() override;
+
+    bool StartCursor() override;
+    bool ReadAtCursor(CDataStream& ssKey, CDataStream& ssValue, bool& complete, bool setRange = false) override;
+    void CloseCursor() override;
+
+    bool TxnBegin() override;
+    bool TxnCommit() override;
+    bool TxnAbort() override;
+};
+
+#endif // VERGE_WALLET_LDB_H
@@ -4691,6 +4691,81 @@ UniValue liststealthaddresses(const JSONRPCRequest& request)
     return results;
 }
 
+UniValue liststealthreceipts(const JSONRPCRequest& request)
+{
+    std::shared_ptr<CWallet> const wallet = GetWalletForJSONRPCRequest(request);
+    CWallet* const pwallet = wallet.get();
+    if (!EnsureWalletIsAvailable(pwallet, request.fHelp)) {
+        return NullUniValue;
+    }
+
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "liststealthreceipts \"label/address\"\n"
+            "\nList the outputs received by an owned stealth address.\n"
+            "\nArguments:\n"
+            "1. \"label/address\"   (string, required) Label or address of the stealth address.\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"txid\": \"str\",           (string) The transaction id.\n"
+            "    \"vout\": n,               (numeric) The output number.\n"
+            "    \"amount\": x.xxx,         (numeric) The amount in " + CURRENCY_UNIT + ".\n"
+            "    \"ephemeral_pubkey\": \"str\", (string) The ephemeral key of the payment.\n"
+            "    \"confirmations\": n,      (numeric) The number of confirmations.\n"
+            "    \"spent\": true|false      (boolean) Whether the output is spent.\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("liststealthreceipts", "mystealthaddress")
+            + HelpExampleRpc("liststealthreceipts", "mystealthaddress")
+        );
+
+    // Make sure the results are valid at least up to the most recent block
+    // the user could have gotten from another RPC command prior to now
+    pwallet->BlockUntilSyncedToCurrentChain();
+
+    std::string stealth_address_label = request.params[0].get_str();
+
+    LOCK2(cs_main, pwallet->cs_wallet);
+
+    std::set<CStealthAddress>::iterator it;
+    for (it = pwallet->stealthAddresses.begin(); it != pwallet->stealthAddresses.end(); ++it)
+    {
+        if (it->scan_secret.size() < 1)
+            continue; // stealth address is not owned
+        if (stealth_address_label == it->label || stealth_address_label == it->Encoded())
+            break;
+    }
+    if (it == pwallet->stealthAddresses.end())
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Stealth address not found in wallet");
+
+    std::vector<std::pair<COutPoint, CPubKey>> vReceipts;
+    if (!pwallet->ListStealthReceipts(*it, vReceipts))
+        throw JSONRPCError(RPC_WALLET_ERROR, "Error reading stealth receipts from the wallet database");
+
+    UniValue results(UniValue::VARR);
+    for (const std::pair<COutPoint, CPubKey>& receipt : vReceipts)
+    {
+        const COutPoint& outpoint = receipt.first;
+        const CWalletTx* wtx = pwallet->GetWalletTx(outpoint.hash);
+        if (!wtx || outpoint.n >= wtx->tx->vout.size())
+            continue; // abandoned or zapped since
+
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("txid", outpoint.hash.GetHex());
+        entry.pushKV("vout", (int)outpoint.n);
+        entry.pushKV("amount", ValueFromAmount(wtx->tx->vout[outpoint.n].nValue));
+        entry.pushKV("ephemeral_pubkey", HexStr(receipt.second));
+        entry.pushKV("confirmations", wtx->GetDepthInMainChain());
+        entry.pushKV("spent", pwallet->IsSpent(outpoint.hash, outpoint.n));
+        results.push_back(entry);
+    }
+
+    return results;
+}
+
 UniValue exportstealthaddress(const JSONRPCRequest& request)
 {
     std::shared_ptr<CWallet> const wallet = GetWalletForJSONRPCRequest(request);
@@ -4960,6 +5035,7 @@ static const CRPCCommand commands[] =
     { "wallet",             "listreceivedbyaddress",            &listreceivedbyaddress,         {"minconf","include_empty","include_watchonly","address_filter"} },
     { "wallet",             "listsinceblock",                   &listsinceblock,                {"blockhash","target_confirmations","include_watchonly","include_removed"} },
 	{ "wallet",             "liststealthaddresses",     		&liststealthaddresses,     		{"show_secrets"} },
+    { "wallet",             "liststealthreceipts",              &liststealthreceipts,           {"address"} },
     { "wallet",             "listtransactions",                 &listtransactions,              {"account|dummy","count","skip","include_watchonly"} },
     { "wallet",             "listunspent",                      &listunspent,                   {"minconf","maxconf","addresses","include_unsafe","query_options"} },
     { "wallet",             "listwallets",                      &listwallets,                   {} },
@@ -0,0 +1,192 @@
+// Copyright (c) 2018-2020 The Verge Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <wallet/db.h>
+#include <wallet/ldb.h>
+#include <wallet/wallet.h>
+#include <wallet/walletutil.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <test/setup_common.h>
+#include <wallet/test/wallet_test_fixture.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(db_tests, WalletTestingSetup)
+
+static std::pair<std::string, int> Key(const std::string& strType, int n)
+{
+    return std::make_pair(strType, n);
+}
+
+// Number of records of a type, found the way WalletBatch scans for them
+static int CountRecords(WalletDatabase& database, const std::string& strType)
+{
+    std::unique_ptr<DatabaseBatch> batch = database.MakeBatch("r");
+    BOOST_CHECK(batch->StartCursor());
+    int nRecords = 0;
+    bool setRange = true;
+    while (true) {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        if (setRange)
+            ssKey << strType;
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        bool complete;
+        bool ret = batch->ReadAtCursor(ssKey, ssValue, complete, setRange);
+        setRange = false;
+        if (complete)
+            break;
+        BOOST_CHECK(ret);
+        std::string strRecordType;
+        ssKey >> strRecordType;
+        if (strRecordType != strType)
+            break;
+        nRecords++;
+    }
+    batch->CloseCursor();
+    return nRecords;
+}
+
+BOOST_AUTO_TEST_CASE(ldb_batch)
+{
+    std::unique_ptr<LevelDBDatabase> database = LevelDBDatabase::CreateMock();
+    std::unique_ptr<DatabaseBatch> batch = database->MakeBatch("cr+");
+    int nVersion;
+    BOOST_CHECK(batch->ReadVersion(nVersion));
+    BOOST_CHECK_EQUAL(nVersion, CLIENT_VERSION);
+
+    BOOST_CHECK(batch->Write(Key("pool", 1), 1));
+    BOOST_CHECK(batch->Write(Key("pool", 2), 2));
+    BOOST_CHECK(batch->Write(Key("tx", 1), 1));
+    BOOST_CHECK(!batch->Write(Key("tx", 1), 2, false));
+
+    // Writes in a transaction are seen by the batch, and only kept on commit
+    BOOST_CHECK(batch->TxnBegin());
+    BOOST_CHECK(batch->Write(Key("tx", 2), 2));
+    BOOST_CHECK(batch->Erase(Key("tx", 1)));
+    int n;
+    BOOST_CHECK(batch->Read(Key("tx", 2), n) && n == 2);
+    BOOST_CHECK(!batch->Exists(Key("tx", 1)));
+    BOOST_CHECK(batch->TxnAbort());
+    BOOST_CHECK(batch->Exists(Key("tx", 1)));
+    BOOST_CHECK(!batch->Exists(Key("tx", 2)));
+
+    BOOST_CHECK(batch->TxnBegin());
+    BOOST_CHECK(batch->Write(Key("tx", 2), 2));
+    BOOST_CHECK(batch->Erase(Key("tx", 1)));
+    BOOST_CHECK(batch->TxnCommit());
+    BOOST_CHECK(!batch->Exists(Key("tx", 1)));
+    BOOST_CHECK(batch->Read(Key("tx", 2), n) && n == 2);
+    batch.reset();
+
+    BOOST_CHECK_EQUAL(CountRecords(*database, "pool"), 2);
+    BOOST_CHECK_EQUAL(CountRecords(*database, "tx"), 1);
+    BOOST_CHECK(database->Rewrite("\x04pool"));
+    BOOST_CHECK_EQUAL(CountRecords(*database, "pool"), 0);
+    BOOST_CHECK_EQUAL(CountRecords(*database, "tx"), 1);
+}
+
+BOOST_AUTO_TEST_CASE(ldb_wallet_reload)
+{
+    fs::path path = GetDataDir() / "ldb_wallet" / "wallet.ldb";
+    CKey key;
+    key.MakeNewKey(true);
+    {
+        CWallet wallet("ldb_wallet", MakeUnique<LevelDBDatabase>(path));
+        bool fFirstRun;
+        BOOST_CHECK(wallet.LoadWallet(fFirstRun) == DBErrors::LOAD_OK);
+        BOOST_CHECK(fFirstRun);
+        LOCK(wallet.cs_wallet);
+        BOOST_CHECK(wallet.AddKeyPubKey(key, key.GetPubKey()));
+    }
+    {
+        CWallet wallet("ldb_wallet", MakeUnique<LevelDBDatabase>(path));
+        bool fFirstRun;
+        BOOST_CHECK(wallet.LoadWallet(fFirstRun) == DBErrors::LOAD_OK);
+        BOOST_CHECK(!fFirstRun);
+        LOCK(wallet.cs_wallet);
+        BOOST_CHECK(wallet.HaveKey(key.GetPubKey().GetID()));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ldb_migrate)
+{
+    fs::path wallet_path = GetDataDir() / "bdb_wallet";
+    fs::create_directories(wallet_path);
+    {
+        BerkeleyDatabase database(wallet_path);
+        std::unique_ptr<DatabaseBatch> batch = database.MakeBatch("cr+");
+        for (int i = 0; i < 100; i++)
+            BOOST_CHECK(batch->Write(Key("tx", i), i));
+    }
+    BOOST_CHECK(!IsLevelDBWallet(wallet_path));
+
+    std::string strWarning, strError;
+    BOOST_CHECK(LevelDBDatabase::Migrate(wallet_path, strWarning, strError));
+    BOOST_CHECK(strError.empty());
+    BOOST_CHECK(!strWarning.empty());
+    BOOST_CHECK(IsLevelDBWallet(wallet_path));
+    BOOST_CHECK(!fs::exists(wallet_path / "wallet.dat"));
+    BOOST_CHECK(fs::exists(wallet_path / "wallet.dat.migrated"));
+
+    std::unique_ptr<WalletDatabase> database = WalletDatabase::Create(wallet_path);
+    BOOST_CHECK_EQUAL(CountRecords(*database, "tx"), 100);
+    std::unique_ptr<DatabaseBatch> batch = database->MakeBatch("r");
+    int n;
+    BOOST_CHECK(batch->Read(Key("tx", 42), n) && n == 42);
+}
+
+// A wallet that is a data file in -walletdir is moved over when verified
+// with -walletbackend=leveldb, and loads from its store afterwards
+BOOST_AUTO_TEST_CASE(ldb_migrate_verify)
+{
+    const std::string wallet_file = "bdb_wallet_file.dat";
+    const fs::path wallet_path = fs::absolute(wallet_file, GetWalletDir());
+    CKey key;
+    key.MakeNewKey(true);
+    {
+        // Made as a directory wallet, whose flushed wallet.dat stands alone
+        const fs::path dir_path = GetDataDir() / "bdb_wallet_dir";
+        CWallet wallet("bdb_wallet_dir", WalletDatabase::Create(dir_path));
+        bool fFirstRun;
+        BOOST_CHECK(wallet.LoadWallet(fFirstRun) == DBErrors::LOAD_OK);
+        {
+            LOCK(wallet.cs_wallet);
+            BOOST_CHECK(wallet.AddKeyPubKey(key, key.GetPubKey()));
+        }
+        wallet.GetDBHandle().Flush(false);
+        fs::copy_file(dir_path / "wallet.dat", wallet_path);
+    }
+    BOOST_CHECK(fs::is_regular_file(wallet_path));
+    BOOST_CHECK(!IsLevelDBWallet(wallet_path));
+
+    gArgs.ForceSetArg("-walletbackend", "leveldb");
+    std::string strWarning, strError;
+    BOOST_CHECK(CWallet::Verify(wallet_file, false, strError, strWarning));
+    BOOST_CHECK(strError.empty());
+    BOOST_CHECK(!strWarning.empty());
+    BOOST_CHECK(!fs::exists(wallet_path));
+    BOOST_CHECK(fs::is_regular_file(wallet_path.string() + ".migrated"));
+    BOOST_CHECK(IsLevelDBWallet(wallet_path));
+
+    // Verifying again finds the store and leaves it alone
+    strWarning.clear();
+    BOOST_CHECK(CWallet::Verify(wallet_file, false, strError, strWarning));
+    BOOST_CHECK(strWarning.empty());
+
+    {
+        CWallet wallet(wallet_file, WalletDatabase::Create(wallet_path));
+        bool fFirstRun;
+        BOOST_CHECK(wallet.LoadWallet(fFirstRun) == DBErrors::LOAD_OK);
+        BOOST_CHECK(!fFirstRun);
+        LOCK(wallet.cs_wallet);
+        BOOST_CHECK(wallet.HaveKey(key.GetPubKey().GetID()));
+    }
+    gArgs.ForceSetArg("-walletbackend", DEFAULT_WALLET_BACKEND);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
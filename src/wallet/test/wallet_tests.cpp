@@ -13,6 +13,7 @@
 
 #include <consensus/validation.h>
 #include <rpc/server.h>
+#include <stealth.h>
 #include <test/setup_common.h>
 #include <validation.h>
 #include <wallet/coincontrol.h>
@@ -110,6 +111,73 @@ BOOST_FIXTURE_TEST_CASE(rescan, TestChain100Setup)
     }
 }
 
+// Verify a key added while the rescan takes in a batch is looked for in the
+// rest of the batch, which was matched against a copy of the keys from before.
+BOOST_FIXTURE_TEST_CASE(rescan_key_added, TestChain100Setup)
+{
+    CKey newKey;
+    newKey.MakeNewKey(true);
+    CreateAndProcessBlock({}, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+    CBlockIndex* const pindexStart = chainActive.Tip();
+    CBlock block = CreateAndProcessBlock({}, GetScriptForRawPubKey(newKey.GetPubKey()));
+
+    CWallet wallet("dummy", WalletDatabase::CreateDummy());
+    AddKey(wallet, coinbaseKey);
+
+    // Both blocks make one batch; the key comes in with the first coinbase
+    bool fAdded = false;
+    boost::signals2::scoped_connection conn = wallet.NotifyTransactionChanged.connect(
+        [&](CWallet* pwallet, const uint256& hashTx, ChangeType status) {
+            if (!fAdded) {
+                fAdded = true;
+                AddKey(*pwallet, newKey);
+            }
+        });
+
+    LOCK(cs_main);
+    WalletRescanReserver reserver(&wallet);
+    reserver.reserve();
+    BOOST_CHECK(wallet.ScanForWalletTransactions(pindexStart, nullptr, reserver) == nullptr);
+    BOOST_CHECK(fAdded);
+
+    LOCK(wallet.cs_wallet);
+    BOOST_CHECK_EQUAL(wallet.mapWallet.size(), 2U);
+    BOOST_CHECK(wallet.GetWalletTx(block.vtx[0]->GetHash()));
+}
+
+// Verify a wallet picks up a rescan cut short by a shutdown when it is loaded
+// again, from the block the rescan had got to rather than its best block.
+BOOST_FIXTURE_TEST_CASE(rescan_resume, TestChain100Setup)
+{
+    const fs::path wallet_path = GetDataDir() / "rescan_resume";
+    const int nResumeHeight = 50;
+    {
+        std::shared_ptr<CWallet> wallet = CWallet::CreateWalletFromFile("rescan_resume", wallet_path);
+        BOOST_REQUIRE(wallet);
+        UnregisterValidationInterface(wallet.get());
+        AddKey(*wallet, coinbaseKey);
+
+        LOCK(cs_main);
+        WalletBatch batch(wallet->GetDBHandle());
+        BOOST_CHECK(batch.WriteRescanProgress(chainActive.GetLocator(chainActive[nResumeHeight])));
+    }
+
+    std::shared_ptr<CWallet> wallet = CWallet::CreateWalletFromFile("rescan_resume", wallet_path);
+    BOOST_REQUIRE(wallet);
+    UnregisterValidationInterface(wallet.get());
+
+    LOCK2(cs_main, wallet->cs_wallet);
+    BOOST_CHECK_EQUAL(wallet->mapWallet.size(), (size_t)(chainActive.Height() - nResumeHeight + 1));
+    for (int nHeight = 1; nHeight <= chainActive.Height(); ++nHeight) {
+        bool found = wallet->GetWalletTx(m_coinbase_txns[nHeight - 1]->GetHash());
+        BOOST_CHECK_EQUAL(found, nHeight >= nResumeHeight);
+    }
+
+    // The rescan finished, so nothing is left to resume
+    CBlockLocator locator;
+    BOOST_CHECK(!WalletBatch(wallet->GetDBHandle()).ReadRescanProgress(locator));
+}
+
 // Verify importwallet RPC starts rescan at earliest block with timestamp
 // greater or equal than key birthday. Previously there was a bug where
 // importwallet RPC would start the scan at the latest block with timestamp less
@@ -270,6 +338,88 @@ BOOST_AUTO_TEST_CASE(LoadReceiveRequests)
     BOOST_CHECK_EQUAL(values[1], "val_rr1");
 }
 
+/** A transaction paying a stealth address, as SendStealthMoneyToDestination builds it */
+static CTransactionRef StealthPayment(const CStealthAddress& sxAddr, CKeyID& keyIDOut)
+{
+    ec_secret ephem_secret;
+    ec_secret secretShared;
+    ec_point pkSendTo;
+    ec_point ephem_pubkey;
+    BOOST_CHECK(GenerateRandomSecret(ephem_secret) == 0);
+    BOOST_CHECK(StealthSecret(ephem_secret, sxAddr.scan_pubkey, sxAddr.spend_pubkey, secretShared, pkSendTo) == 0);
+    BOOST_CHECK(SecretToPublicKey(ephem_secret, ephem_pubkey) == 0);
+    keyIDOut = CPubKey(pkSendTo).GetID();
+
+    CKey change;
+    change.MakeNewKey(true);
+
+    CMutableTransaction mtx;
+    mtx.vout.resize(3);
+    mtx.vout[0].nValue = 1 * COIN;
+    mtx.vout[0].scriptPubKey = GetScriptForDestination(change.GetPubKey().GetID());
+    mtx.vout[1].nValue = 2 * COIN;
+    mtx.vout[1].scriptPubKey = GetScriptForDestination(keyIDOut);
+    mtx.vout[2].scriptPubKey = CScript() << OP_RETURN << ephem_pubkey;
+    return MakeTransactionRef(mtx);
+}
+
+BOOST_AUTO_TEST_CASE(stealth_scan)
+{
+    std::string sError, sLabel = "stealth";
+    CStealthAddress sxAddr, sxOther;
+    BOOST_CHECK(GenerateNewStealthAddress(sError, sLabel, sxAddr));
+    BOOST_CHECK(GenerateNewStealthAddress(sError, sLabel, sxOther));
+    BOOST_CHECK(m_wallet.AddStealthAddress(sxAddr));
+
+    // Payments to the wallet among payments to another stealth address,
+    // scanned inline, then over the wallet scan threads
+    const int nThreadsSaved = nScriptCheckThreads;
+    std::set<COutPoint> setReceived;
+    for (int nThreads : {0, nThreadsSaved}) {
+        nScriptCheckThreads = nThreads;
+        StartWalletScanThreads();
+
+        std::vector<CTransactionRef> vtx;
+        std::vector<CKeyID> vMine, vOther;
+        for (int i = 0; i < 20; i++) {
+            CKeyID keyID;
+            vtx.push_back(StealthPayment(i % 4 == 0 ? sxAddr : sxOther, keyID));
+            (i % 4 == 0 ? vMine : vOther).push_back(keyID);
+            if (i % 4 == 0)
+                setReceived.insert(COutPoint(vtx.back()->GetHash(), 1));
+        }
+        m_wallet.ScanStealthTransactions(vtx);
+
+        {
+            LOCK(m_wallet.cs_wallet);
+            for (const CKeyID& keyID : vMine) {
+                CKey key;
+                BOOST_CHECK(m_wallet.GetKey(keyID, key));
+                BOOST_CHECK(key.GetPubKey().GetID() == keyID);
+            }
+            for (const CKeyID& keyID : vOther)
+                BOOST_CHECK(!m_wallet.HaveKey(keyID));
+        }
+
+        StopWalletScanThreads();
+    }
+    nScriptCheckThreads = nThreadsSaved;
+
+    // Only the payments to the wallet are indexed, under their address and ephemeral key
+    std::vector<std::pair<COutPoint, CPubKey>> vReceipts;
+    BOOST_CHECK(m_wallet.ListStealthReceipts(sxAddr, vReceipts));
+    BOOST_CHECK_EQUAL(vReceipts.size(), setReceived.size());
+    for (const std::pair<COutPoint, CPubKey>& receipt : vReceipts) {
+        BOOST_CHECK(setReceived.count(receipt.first));
+        COutPoint outpoint;
+        BOOST_CHECK(m_wallet.FindStealthReceipt(receipt.second, outpoint));
+        BOOST_CHECK(outpoint == receipt.first);
+    }
+    vReceipts.clear();
+    BOOST_CHECK(m_wallet.ListStealthReceipts(sxOther, vReceipts));
+    BOOST_CHECK(vReceipts.empty());
+}
+
 class ListCoinsTestingSetup : public TestChain100Setup
 {
 public:
@@ -368,4 +518,28 @@ BOOST_FIXTURE_TEST_CASE(ListCoins, ListCoinsTestingSetup)
     BOOST_CHECK_EQUAL(list.begin()->second.size(), 2U);
 }
 
+static CAmount AvailableCoinsTotal(CWallet& wallet)
+{
+    LOCK2(cs_main, wallet.cs_wallet);
+    std::vector<COutput> available;
+    wallet.AvailableCoins(available);
+    CAmount nTotal = 0;
+    for (const COutput& out : available)
+        nTotal += out.tx->tx->vout[out.i].nValue;
+    return nTotal;
+}
+
+BOOST_FIXTURE_TEST_CASE(cached_balance, ListCoinsTestingSetup)
+{
+    // Fill the cache, then check a spend and a new block both refresh it
+    BOOST_CHECK_EQUAL(wallet->GetBalance(), 200000 * COIN);
+    BOOST_CHECK_EQUAL(wallet->GetBalance(), AvailableCoinsTotal(*wallet));
+
+    AddTx(CRecipient{GetScriptForRawPubKey({}), 1 * COIN, false});
+    BOOST_CHECK(wallet->GetBalance() != 200000 * COIN);
+    BOOST_CHECK_EQUAL(wallet->GetBalance(), AvailableCoinsTotal(*wallet));
+    BOOST_CHECK_EQUAL(wallet->GetBalance(ISMINE_SPENDABLE, 1), wallet->GetBalance());
+    BOOST_CHECK_EQUAL(wallet->GetUnconfirmedBalance(), 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -8,6 +8,7 @@
 
 #include <checkpoints.h>
 #include <chain.h>
+#include <checkqueue.h>
 #include <wallet/coincontrol.h>
 #include <consensus/consensus.h>
 #include <consensus/validation.h>
@@ -34,8 +35,10 @@
 #include <algorithm>
 #include <assert.h>
 #include <future>
+#include <thread>
 
 #include <boost/algorithm/string/replace.hpp>
+#include <boost/thread.hpp>
 
 static CCriticalSection cs_wallets;
 static std::vector<std::shared_ptr<CWallet>> vpwallets GUARDED_BY(cs_wallets);
@@ -252,6 +255,7 @@ bool CWallet::AddKeyPubKeyWithDB(WalletBatch &batch, const CKey& secret, const C
         return false;
     }
     if (needsDB) encrypted_batch = nullptr;
+    nKeyStoreUpdates++;
 
     // check if we need to remove from watch-only
     CScript script;
@@ -283,6 +287,7 @@ bool CWallet::AddCryptedKey(const CPubKey &vchPubKey,
 {
     if (!CCryptoKeyStore::AddCryptedKey(vchPubKey, vchCryptedSecret))
         return false;
+    nKeyStoreUpdates++;
     {
         LOCK(cs_wallet);
         if (encrypted_batch)
@@ -337,6 +342,7 @@ bool CWallet::AddCScript(const CScript& redeemScript)
 {
     if (!CCryptoKeyStore::AddCScript(redeemScript))
         return false;
+    nKeyStoreUpdates++;
     return WalletBatch(*database).WriteCScript(Hash160(redeemScript), redeemScript);
 }
 
@@ -360,6 +366,7 @@ bool CWallet::AddWatchOnly(const CScript& dest)
 {
     if (!CCryptoKeyStore::AddWatchOnly(dest))
         return false;
+    nKeyStoreUpdates++;
     const CKeyMetadata& meta = m_script_metadata[CScriptID(dest)];
     UpdateTimeFirstKey(meta.nCreateTime);
     NotifyWatchonlyChanged(true);
@@ -377,6 +384,7 @@ bool CWallet::RemoveWatchOnly(const CScript &dest)
     AssertLockHeld(cs_wallet);
     if (!CCryptoKeyStore::RemoveWatchOnly(dest))
         return false;
+    nKeyStoreUpdates++;
     if (!HaveWatchOnly())
         NotifyWatchonlyChanged(false);
     if (!WalletBatch(*database).EraseWatchOnly(dest))
@@ -919,6 +927,19 @@ void CWallet::MarkDirty()
     }
 }
 
+void CWallet::MarkUnspentDirty(const uint256& hash) const
+{
+    LOCK(cs_wallet);
+    setUnspentTxs.insert(hash);
+    fBalanceCached = false;
+}
+
+void CWallet::MarkBalanceDirty() const
+{
+    LOCK(cs_wallet);
+    fBalanceCached = false;
+}
+
 bool CWallet::MarkReplaced(const uint256& originalHash, const uint256& newHash)
 {
     LOCK(cs_wallet);
@@ -1090,9 +1111,6 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransactionRef& ptx, const CBlockI
         bool fExisted = mapWallet.count(tx.GetHash()) != 0;
         if (fExisted && !fUpdate) return false;
 
-        mapValue_t mapNarr;
-        FindStealthTransactions(tx, mapNarr);
-        
         if (fExisted || IsMine(tx) || IsFromMe(tx))
         {
             /* Check if any keys in the wallet keypool that were supposed to be unused
@@ -1276,6 +1294,8 @@ void CWallet::SyncTransaction(const CTransactionRef& ptx, const CBlockIndex *pin
 }
 
 void CWallet::TransactionAddedToMempool(const CTransactionRef& ptx) {
+    ScanStealthTransactions({ptx});
+
     LOCK2(cs_main, cs_wallet);
     SyncTransaction(ptx);
 
@@ -1283,6 +1303,7 @@ void CWallet::TransactionAddedToMempool(const CTransactionRef& ptx) {
     if (it != mapWallet.end()) {
         it->second.fInMempool = true;
     }
+    MarkBalanceDirty();
 }
 
 void CWallet::TransactionRemovedFromMempool(const CTransactionRef &ptx) {
@@ -1290,10 +1311,14 @@ void CWallet::TransactionRemovedFromMempool(const CTransactionRef &ptx) {
     auto it = mapWallet.find(ptx->GetHash());
     if (it != mapWallet.end()) {
         it->second.fInMempool = false;
+        MarkBalanceDirty();
     }
 }
 
 void CWallet::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex, const std::vector<CTransactionRef>& vtxConflicted) {
+    ScanStealthTransactions(vtxConflicted);
+    ScanStealthTransactions(pblock->vtx);
+
     LOCK2(cs_main, cs_wallet);
     // TODO: Temporarily ensure that mempool removals are notified before
     // connected transactions.  This shouldn't matter, but the abandoned
@@ -1313,6 +1338,8 @@ void CWallet::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const
     }
 
     m_last_block_processed = pindex;
+    // Every depth changed
+    MarkBalanceDirty();
 }
 
 void CWallet::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock) {
@@ -1321,6 +1348,7 @@ void CWallet::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock) {
     for (const CTransactionRef& ptx : pblock->vtx) {
         SyncTransaction(ptx);
     }
+    MarkBalanceDirty();
 }
 
 
@@ -1760,11 +1788,195 @@ int64_t CWallet::RescanFromTime(int64_t startTime, const WalletRescanReserver& r
     return startTime;
 }
 
+/** Blocks a rescan reads ahead while the wallet takes in the ones before */
+static const size_t RESCAN_BATCH_SIZE = 32;
+
+/**
+ * Keys and scripts of a wallet, copied for the wallet scan threads to match
+ * outputs against with ::IsMine without taking cs_wallet. Holds no secrets
+ * and can't be changed once made.
+ */
+class CRescanKeyStore : public CKeyStore
+{
+private:
+    std::set<CKeyID> setKeyIDs;
+    ScriptMap mapScripts;
+    WatchOnlySet setWatchOnly;
+
+public:
+    //! nKeyStoreUpdates of the wallet at the time of the copy
+    const uint64_t nUpdates;
+
+    explicit CRescanKeyStore(const CWallet& wallet) : nUpdates(wallet.nKeyStoreUpdates)
+    {
+        // Read the update count first, so a key added meanwhile can only make the copy look stale
+        LOCK(wallet.cs_KeyStore);
+        setKeyIDs = wallet.GetKeys();
+        mapScripts = wallet.mapScripts;
+        setWatchOnly = wallet.setWatchOnly;
+    }
+
+    bool AddKeyPubKey(const CKey& key, const CPubKey& pubkey) override { return false; }
+    bool HaveKey(const CKeyID& address) const override { return setKeyIDs.count(address) > 0; }
+    std::set<CKeyID> GetKeys() const override { return setKeyIDs; }
+    bool GetKey(const CKeyID& address, CKey& keyOut) const override { return false; }
+    bool GetPubKey(const CKeyID& address, CPubKey& vchPubKeyOut) const override { return false; }
+
+    bool AddCScript(const CScript& redeemScript) override { return false; }
+    bool HaveCScript(const CScriptID& hash) const override { return mapScripts.count(hash) > 0; }
+    std::set<CScriptID> GetCScripts() const override
+    {
+        std::set<CScriptID> setScripts;
+        for (const auto& script : mapScripts)
+            setScripts.insert(script.first);
+        return setScripts;
+    }
+    bool GetCScript(const CScriptID& hash, CScript& redeemScriptOut) const override
+    {
+        ScriptMap::const_iterator mi = mapScripts.find(hash);
+        if (mi == mapScripts.end())
+            return false;
+        redeemScriptOut = mi->second;
+        return true;
+    }
+
+    bool AddWatchOnly(const CScript& dest) override { return false; }
+    bool RemoveWatchOnly(const CScript& dest) override { return false; }
+    bool HaveWatchOnly(const CScript& dest) const override { return setWatchOnly.count(dest) > 0; }
+    bool HaveWatchOnly() const override { return !setWatchOnly.empty(); }
+};
+
+/** A block of a rescan, read ahead of the wallet taking in its transactions */
+struct CRescanBlock
+{
+    CBlockIndex* pindex;
+    FlatFilePos pos;          // of pindex, read under cs_main when the batch was made
+    CBlock block;
+    bool fRead;
+    std::vector<bool> vMatch; // whether the copied key store owns an output of each transaction
+    uint64_t nUpdates;        // of the key store copy vMatch was made with
+
+    CRescanBlock(CBlockIndex* pindexIn, const FlatFilePos& posIn) : pindex(pindexIn), pos(posIn), fRead(false), nUpdates(0) {}
+};
+
+/**
+ * Closure reading one block of a rescan from disk and matching its outputs.
+ * It must not take cs_main: a wallet catching up on the blocks connected
+ * during its startup rescan waits for it holding cs_main.
+ */
+class CRescanBlockCheck
+{
+private:
+    CRescanBlock *item;
+    const CRescanKeyStore *keystore;
+
+public:
+    CRescanBlockCheck() : item(nullptr), keystore(nullptr) {}
+    CRescanBlockCheck(CRescanBlock *itemIn, const CRescanKeyStore *keystoreIn) : item(itemIn), keystore(keystoreIn) {}
+
+    bool operator()()
+    {
+        item->fRead = ReadBlockFromDisk(item->block, item->pindex, item->pos, Params().GetConsensus());
+        if (!item->fRead)
+            return true;
+        item->nUpdates = keystore->nUpdates;
+        item->vMatch.assign(item->block.vtx.size(), false);
+        for (size_t i = 0; i < item->block.vtx.size(); ++i) {
+            for (const CTxOut& txout : item->block.vtx[i]->vout) {
+                if (::IsMine(*keystore, txout.scriptPubKey) != ISMINE_NO) {
+                    item->vMatch[i] = true;
+                    break;
+                }
+            }
+        }
+        return true;
+    }
+
+    void swap(CRescanBlockCheck &check)
+    {
+        std::swap(item, check.item);
+        std::swap(keystore, check.keystore);
+    }
+};
+
+/**
+ * Rescans and stealth scans have their own worker queue. On the one the
+ * node validates with, a wallet with many stealth addresses or a long
+ * rescan would hold up header sync and block imports.
+ */
+static CCheckQueue<CWorkerJob> walletscanqueue(1);
+static boost::thread_group threadGroupWalletScan;
+
+static void ThreadWalletScan()
+{
+    walletscanqueue.Thread();
+}
+
+void StartWalletScanThreads()
+{
+    for (int i = 0; i < nScriptCheckThreads - 1; ++i)
+        threadGroupWalletScan.create_thread(boost::bind(&TraceThread<void (*)()>, "walletscan", &ThreadWalletScan));
+}
+
+void StopWalletScanThreads()
+{
+    threadGroupWalletScan.interrupt_all();
+    threadGroupWalletScan.join_all();
+}
+
+/** Run a vector of scan closures on the wallet scan threads, or on this thread if there are none */
+template <typename T>
+static void RunWalletScanChecks(std::vector<T>& vChecks)
+{
+    if (!nScriptCheckThreads) {
+        for (T& check : vChecks)
+            check();
+        return;
+    }
+    std::vector<CWorkerJob> vJobs;
+    vJobs.reserve(vChecks.size());
+    for (T& check : vChecks)
+        vJobs.emplace_back(std::ref(check));
+    CCheckQueueControl<CWorkerJob> control(&walletscanqueue);
+    control.Add(vJobs);
+    control.Wait();
+}
+
+/** The blocks of the active chain from pindex on, up to pindexStop, that make the next rescan batch */
+static std::vector<CRescanBlock> NextRescanBatch(CBlockIndex* pindex, const CBlockIndex* pindexStop)
+{
+    std::vector<CRescanBlock> vBlocks;
+    LOCK(cs_main);
+    while (pindex && vBlocks.size() < RESCAN_BATCH_SIZE) {
+        vBlocks.emplace_back(pindex, pindex->GetBlockPos());
+        if (pindex == pindexStop)
+            break;
+        pindex = chainActive.Next(pindex);
+    }
+    return vBlocks;
+}
+
+/** Read and match a rescan batch on the wallet scan threads */
+static void ReadRescanBatch(std::vector<CRescanBlock>& vBlocks, const CRescanKeyStore* keystore)
+{
+    std::vector<CRescanBlockCheck> vChecks;
+    vChecks.reserve(vBlocks.size());
+    for (CRescanBlock& item : vBlocks)
+        vChecks.emplace_back(&item, keystore);
+    RunWalletScanChecks(vChecks);
+}
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
  * exist in the wallet will be updated.
  *
+ * Blocks are read and matched against a copy of the wallet's keys in
+ * batches on the wallet scan threads, the next batch while the wallet takes in
+ * the transactions of the current one, in chain order. How far the scan
+ * got is saved in the wallet, so a rescan cut short by a shutdown picks
+ * up from there on the next start.
+ *
  * Returns null if scan was successful. Otherwise, if a complete rescan was not
  * possible (due to pruning or corruption), returns pointer to the most recent
  * block that could not be scanned.
@@ -1791,6 +2003,21 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlock
 
     if (pindex) LogPrintf("Rescan started from block %d...\n", pindex->nHeight);
 
+    // Save the first block still to scan, or clear the record if null
+    auto record_progress = [this](const CBlockIndex* pindexNext) {
+        WalletBatch batch(*database, "r+", false);
+        if (!pindexNext) {
+            batch.EraseRescanProgress();
+            return;
+        }
+        CBlockLocator locator;
+        {
+            LOCK(cs_main);
+            locator = chainActive.GetLocator(pindexNext);
+        }
+        batch.WriteRescanProgress(locator);
+    };
+
     {
         fAbortRescan = false;
         ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
@@ -1808,48 +2035,133 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlock
             }
         }
         double progress_current = progress_begin;
-        while (pindex && !fAbortRescan && !ShutdownRequested())
+
+        // An unfinished rescan of an earlier run that starts further back
+        // covers this one, leave its record alone then
+        CBlockIndex* pindexUnfinished = nullptr;
         {
-            if (pindex->nHeight % 100 == 0 && progress_end - progress_begin > 0.0) {
-                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((progress_current - progress_begin) / (progress_end - progress_begin) * 100))));
+            CBlockLocator locator;
+            if (WalletBatch(*database).ReadRescanProgress(locator)) {
+                LOCK(cs_main);
+                pindexUnfinished = FindForkInGlobalIndex(chainActive, locator);
             }
-            if (GetTime() >= nNow + 60) {
-                nNow = GetTime();
-                LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, progress_current);
+        }
+        const bool fRecordProgress = pindex && (!pindexUnfinished || pindexUnfinished->nHeight >= pindex->nHeight);
+        if (fRecordProgress)
+            record_progress(pindex);
+
+        std::shared_ptr<const CRescanKeyStore> keystore;
+        auto current_keystore = [this, &keystore]() {
+            if (!keystore || keystore->nUpdates != nKeyStoreUpdates) {
+                LOCK(cs_wallet);
+                keystore = std::make_shared<const CRescanKeyStore>(*this);
             }
+            return keystore;
+        };
 
-            CBlock block;
-            if (ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
-                LOCK2(cs_main, cs_wallet);
-                if (pindex && !chainActive.Contains(pindex)) {
-                    // Abort scan if current block is no longer active, to prevent
-                    // marking transactions as coming from the wrong block.
-                    ret = pindex;
-                    break;
+        bool fComplete = true;
+        std::vector<CRescanBlock> vBlocks = NextRescanBatch(pindex, pindexStop);
+        ReadRescanBatch(vBlocks, current_keystore().get());
+        while (!vBlocks.empty())
+        {
+            // Read the next batch while this one is taken in
+            std::vector<CRescanBlock> vNext;
+            if (vBlocks.back().pindex != pindexStop) {
+                CBlockIndex* pindexNext;
+                {
+                    LOCK(cs_main);
+                    pindexNext = chainActive.Next(vBlocks.back().pindex);
                 }
-                for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
-                    AddToWalletIfInvolvingMe(block.vtx[posInBlock], pindex, posInBlock, fUpdate);
+                vNext = NextRescanBatch(pindexNext, pindexStop);
+            }
+            std::thread prefetch;
+            if (!vNext.empty()) {
+                std::shared_ptr<const CRescanKeyStore> keystoreNext = current_keystore();
+                prefetch = std::thread([&vNext, keystoreNext]() { ReadRescanBatch(vNext, keystoreNext.get()); });
+            }
+
+            try {
+                std::vector<CTransactionRef> vtx;
+                for (const CRescanBlock& item : vBlocks) {
+                    if (item.fRead)
+                        vtx.insert(vtx.end(), item.block.vtx.begin(), item.block.vtx.end());
                 }
-            } else {
-                ret = pindex;
+                ScanStealthTransactions(vtx);
+
+                for (const CRescanBlock& item : vBlocks)
+                {
+                    pindex = item.pindex;
+                    if (fAbortRescan || ShutdownRequested()) {
+                        fComplete = false;
+                        break;
+                    }
+                    if (pindex->nHeight % 100 == 0 && progress_end - progress_begin > 0.0) {
+                        ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((progress_current - progress_begin) / (progress_end - progress_begin) * 100))));
+                    }
+                    if (GetTime() >= nNow + 60) {
+                        nNow = GetTime();
+                        LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, progress_current);
+                    }
+
+                    if (item.fRead) {
+                        LOCK2(cs_main, cs_wallet);
+                        if (!chainActive.Contains(pindex)) {
+                            // Abort scan if current block is no longer active, to prevent
+                            // marking transactions as coming from the wrong block.
+                            ret = pindex;
+                            fComplete = false;
+                            break;
+                        }
+                        for (size_t posInBlock = 0; posInBlock < item.block.vtx.size(); ++posInBlock) {
+                            // A transaction paying none of the copied keys can still be in
+                            // the wallet, spend from it, or pay a key added since the copy
+                            const CTransaction& tx = *item.block.vtx[posInBlock];
+                            bool fCheck = item.vMatch[posInBlock] || item.nUpdates != nKeyStoreUpdates || mapWallet.count(tx.GetHash());
+                            for (size_t i = 0; !fCheck && i < tx.vin.size(); ++i)
+                                fCheck = mapWallet.count(tx.vin[i].prevout.hash) || mapTxSpends.count(tx.vin[i].prevout);
+                            if (fCheck)
+                                AddToWalletIfInvolvingMe(item.block.vtx[posInBlock], pindex, posInBlock, fUpdate);
+                        }
+                    } else {
+                        ret = pindex;
+                    }
+                    {
+                        LOCK(cs_main);
+                        progress_current = GuessVerificationProgress(chainParams.TxData(), pindex);
+                        if (pindexStop == nullptr && tip != chainActive.Tip()) {
+                            tip = chainActive.Tip();
+                            // in case the tip has changed, update progress max
+                            progress_end = GuessVerificationProgress(chainParams.TxData(), tip);
+                        }
+                    }
+                }
+            } catch (...) {
+                if (prefetch.joinable())
+                    prefetch.join();
+                throw;
             }
-            if (pindex == pindexStop) {
+            if (prefetch.joinable())
+                prefetch.join();
+            if (!fComplete)
                 break;
-            }
-            {
+
+            if (fRecordProgress && !vNext.empty())
+                record_progress(vNext.front().pindex);
+            vBlocks = std::move(vNext);
+        }
+
+        if (fRecordProgress && fComplete) {
+            // Only blocks past pindexStop an earlier unfinished rescan needs are left
+            const CBlockIndex* pindexLeft = nullptr;
+            if (pindexUnfinished && pindexStop) {
                 LOCK(cs_main);
-                pindex = chainActive.Next(pindex);
-                progress_current = GuessVerificationProgress(chainParams.TxData(), pindex);
-                if (pindexStop == nullptr && tip != chainActive.Tip()) {
-                    tip = chainActive.Tip();
-                    // in case the tip has changed, update progress max
-                    progress_end = GuessVerificationProgress(chainParams.TxData(), tip);
-                }
+                pindexLeft = pindexUnfinished->nHeight > pindexStop->nHeight ? pindexUnfinished : chainActive.Next(pindexStop);
             }
+            record_progress(pindexLeft);
         }
-        if (pindex && fAbortRescan) {
+        if (!fComplete && fAbortRescan) {
             LogPrintf("Rescan aborted at block %d. Progress=%f\n", pindex->nHeight, progress_current);
-        } else if (pindex && ShutdownRequested()) {
+        } else if (!fComplete && ShutdownRequested()) {
             LogPrintf("Rescan interrupted by shutdown request at block %d. Progress=%f\n", pindex->nHeight, progress_current);
         }
         ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
@@ -1921,6 +2233,21 @@ std::set<uint256> CWalletTx::GetConflicts() const
     return result;
 }
 
+void CWalletTx::MarkDirty()
+{
+    fCreditCached = false;
+    fAvailableCreditCached = false;
+    fImmatureCreditCached = false;
+    fWatchDebitCached = false;
+    fWatchCreditCached = false;
+    fAvailableWatchCreditCached = false;
+    fImmatureWatchCreditCached = false;
+    fDebitCached = false;
+    fChangeCached = false;
+    if (pwallet)
+        pwallet->MarkUnspentDirty(GetHash());
+}
+
 CAmount CWalletTx::GetDebit(const isminefilter& filter) const
 {
     if (tx->vin.empty())
@@ -2168,14 +2495,81 @@ void CWallet::ResendWalletTransactions(int64_t nBestBlockTime, CConnman* connman
  */
 
 
+bool CWallet::HasUnspentOutput(const CWalletTx& wtx) const
+{
+    // Immature coinbase credit counts whether spent or not
+    if (wtx.IsCoinBase() && wtx.GetBlocksToMaturity() > 0)
+        return true;
+    const uint256& hash = wtx.GetHash();
+    for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+        if (IsMine(wtx.tx->vout[i]) != ISMINE_NO && !IsSpent(hash, i))
+            return true;
+    }
+    return false;
+}
+
+std::vector<const CWalletTx*> CWallet::GetUnspentTxs() const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    std::vector<const CWalletTx*> vTxs;
+    std::set<uint256>::iterator it = setUnspentTxs.begin();
+    while (it != setUnspentTxs.end()) {
+        std::map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(*it);
+        if (mi == mapWallet.end() || !HasUnspentOutput(mi->second)) {
+            it = setUnspentTxs.erase(it);
+            continue;
+        }
+        vTxs.push_back(&mi->second);
+        ++it;
+    }
+    return vTxs;
+}
+
+CWalletBalance CWallet::GetBalances() const
+{
+    LOCK2(cs_main, cs_wallet);
+    if (fBalanceCached)
+        return balanceCached;
+
+    CWalletBalance balance;
+    bool fAllFinal = true;
+    for (const CWalletTx* pcoin : GetUnspentTxs())
+    {
+        // Finality by time can change without the wallet hearing of it
+        fAllFinal &= CheckFinalTx(*pcoin->tx);
+        const bool fTrusted = pcoin->IsTrusted();
+        const int nDepth = pcoin->GetDepthInMainChain();
+        if (fTrusted && nDepth >= 0) {
+            balance.nTrusted += pcoin->GetAvailableCredit(true, ISMINE_SPENDABLE);
+            balance.nWatchOnlyTrusted += pcoin->GetAvailableCredit(true, ISMINE_WATCH_ONLY);
+        }
+        if (!fTrusted && nDepth == 0 && pcoin->InMempool()) {
+            balance.nUntrustedPending += pcoin->GetAvailableCredit(true, ISMINE_SPENDABLE);
+            balance.nWatchOnlyUntrustedPending += pcoin->GetAvailableCredit(true, ISMINE_WATCH_ONLY);
+        }
+        balance.nImmature += pcoin->GetImmatureCredit();
+        balance.nWatchOnlyImmature += pcoin->GetImmatureWatchOnlyCredit();
+    }
+
+    balanceCached = balance;
+    fBalanceCached = fAllFinal;
+    return balance;
+}
+
 CAmount CWallet::GetBalance(const isminefilter& filter, const int min_depth) const
 {
+    if (min_depth == 0 && (filter & ~ISMINE_ALL) == 0) {
+        CWalletBalance balance = GetBalances();
+        return (filter & ISMINE_SPENDABLE ? balance.nTrusted : 0) + (filter & ISMINE_WATCH_ONLY ? balance.nWatchOnlyTrusted : 0);
+    }
+
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (const auto& entry : mapWallet)
+        for (const CWalletTx* pcoin : GetUnspentTxs())
         {
-            const CWalletTx* pcoin = &entry.second;
             if (pcoin->IsTrusted() && pcoin->GetDepthInMainChain() >= min_depth) {
                 nTotal += pcoin->GetAvailableCredit(true, filter);
             }
@@ -2187,60 +2581,22 @@ CAmount CWallet::GetBalance(const isminefilter& filter, const int min_depth) con
 
 CAmount CWallet::GetUnconfirmedBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (const auto& entry : mapWallet)
-        {
-            const CWalletTx* pcoin = &entry.second;
-            if (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0 && pcoin->InMempool())
-                nTotal += pcoin->GetAvailableCredit();
-        }
-    }
-    return nTotal;
+    return GetBalances().nUntrustedPending;
 }
 
 CAmount CWallet::GetImmatureBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (const auto& entry : mapWallet)
-        {
-            const CWalletTx* pcoin = &entry.second;
-            nTotal += pcoin->GetImmatureCredit();
-        }
-    }
-    return nTotal;
+    return GetBalances().nImmature;
 }
 
 CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (const auto& entry : mapWallet)
-        {
-            const CWalletTx* pcoin = &entry.second;
-            if (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0 && pcoin->InMempool())
-                nTotal += pcoin->GetAvailableCredit(true, ISMINE_WATCH_ONLY);
-        }
-    }
-    return nTotal;
+    return GetBalances().nWatchOnlyUntrustedPending;
 }
 
 CAmount CWallet::GetImmatureWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (const auto& entry : mapWallet)
-        {
-            const CWalletTx* pcoin = &entry.second;
-            nTotal += pcoin->GetImmatureWatchOnlyCredit();
-        }
-    }
-    return nTotal;
+    return GetBalances().nWatchOnlyImmature;
 }
 
 // Calculate total balance in a different way from GetBalance. The biggest
@@ -2309,10 +2665,9 @@ void CWallet::AvailableCoins(std::vector<COutput> &vCoins, bool fOnlySafe, const
     vCoins.clear();
     CAmount nTotal = 0;
 
-    for (const auto& entry : mapWallet)
+    for (const CWalletTx* pcoin : GetUnspentTxs())
     {
-        const uint256& wtxid = entry.first;
-        const CWalletTx* pcoin = &entry.second;
+        const uint256& wtxid = pcoin->GetHash();
 
         if (!CheckFinalTx(*pcoin->tx))
             continue;
@@ -2373,10 +2728,10 @@ void CWallet::AvailableCoins(std::vector<COutput> &vCoins, bool fOnlySafe, const
             if (pcoin->tx->vout[i].nValue < nMinimumAmount || pcoin->tx->vout[i].nValue > nMaximumAmount)
                 continue;
 
-            if (coinControl && coinControl->HasSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsSelected(COutPoint(entry.first, i)))
+            if (coinControl && coinControl->HasSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsSelected(COutPoint(wtxid, i)))
                 continue;
 
-            if (IsLockedCoin(entry.first, i))
+            if (IsLockedCoin(wtxid, i))
                 continue;
 
             if (IsSpent(wtxid, i))
@@ -3603,218 +3958,238 @@ bool CWallet::SendStealthMoneyToDestination(CStealthAddress& sxAddress, int64_t
     return true;
 }
 
-bool CWallet::FindStealthTransactions(const CTransaction& tx, mapValue_t& mapNarr)
+/** A stealth address of the wallet that can scan, copied out from under cs_wallet */
+struct CStealthScanKey
 {
-    LogPrintf("FindStealthTransactions() tx: %s\n", tx.GetHash().GetHex().c_str());
-    
-    mapNarr.clear();
-    
-    LOCK(cs_wallet);
-    ec_secret sSpendR;
-    ec_secret sSpend;
-    ec_secret sScan;
-    ec_secret sShared;
-    
-    ec_point pkExtracted;
-    
-    std::vector<uint8_t> vectorPubKey;
-    std::vector<uint8_t> vchDataB;
-    std::vector<uint8_t> vchENarr;
-    opcodetype opCode;
-    char cbuf[256];
-    
-    int32_t nOutputIdOuter = -1;
-    for(const CTxOut& txout: tx.vout)
-    {
-        nOutputIdOuter++;
-        CScript::const_iterator scriptIterator = txout.scriptPubKey.begin();
-        CScript outScript = txout.scriptPubKey;
+    CStealthAddress sxAddr;
+    ec_secret scan_secret;
+};
 
-        // ensure a valid stealth code is present
-        bool retreiveOPReturn = outScript.GetOp(scriptIterator, opCode);
-        if (!retreiveOPReturn || opCode != OP_RETURN)
-            continue;
+/** An ephemeral public key found in a transaction, and the outputs it may have paid */
+struct CStealthScanItem
+{
+    ec_point ephemPubkey;
+    uint256 txid;
+    std::vector<std::pair<CKeyID, uint32_t>> vKeyIDs; // key hash outputs and their index
+    size_t nMatch; // index in the scan keys, or their count if none matched
+    uint32_t nOut; // the output paid to the matched key
+};
 
-        // ensure pubkey is available
-        bool retreivePubKey = txout.scriptPubKey.GetOp(scriptIterator, opCode, vectorPubKey);
-        if (!retreivePubKey || vectorPubKey.size() != ec_compressed_size)
-        {
-            // -- look for plaintext narrations
-            if (vectorPubKey.size() > 1
-                && vectorPubKey[0] == 'n'
-                && vectorPubKey[1] == 'p')
-            {
-                if (txout.scriptPubKey.GetOp(scriptIterator, opCode, vchENarr)
-                    && opCode == OP_RETURN
-                    && txout.scriptPubKey.GetOp(scriptIterator, opCode, vchENarr)
-                    && vchENarr.size() > 0)
-                {
-                    std::string sNarr = std::string(vchENarr.begin(), vchENarr.end());
-                    
-                    snprintf(cbuf, sizeof(cbuf), "n_%d", nOutputIdOuter-1); // plaintext narration always matches preceding value output
-                    mapNarr[cbuf] = sNarr;
-                } 
-                else
-                {
-                    LogPrintf("Warning: FindStealthTransactions() tx: %s, Could not extract plaintext narration.\n", tx.GetHash().GetHex().c_str());
-                };
+/** Closure deriving the destination of one ephemeral key for every scan key:
+    records the first scan key whose destination the transaction pays. */
+class CStealthScanCheck
+{
+private:
+    CStealthScanItem *item;
+    const std::vector<CStealthScanKey> *keys;
+
+public:
+    CStealthScanCheck() : item(nullptr), keys(nullptr) {}
+    CStealthScanCheck(CStealthScanItem *itemIn, const std::vector<CStealthScanKey> *keysIn) : item(itemIn), keys(keysIn) {}
+
+    bool operator()()
+    {
+        item->nMatch = keys->size();
+        ec_secret sShared;
+        ec_point pkExtracted;
+        for (size_t k = 0; k < keys->size(); ++k) {
+            ec_secret sScan = (*keys)[k].scan_secret;
+            if (StealthSecret(sScan, item->ephemPubkey, (*keys)[k].sxAddr.spend_pubkey, sShared, pkExtracted) != 0)
+                continue;
+            CKeyID ckidE = CPubKey(pkExtracted).GetID();
+            for (const std::pair<CKeyID, uint32_t>& keyID : item->vKeyIDs) {
+                if (keyID.first == ckidE) {
+                    item->nMatch = k;
+                    item->nOut = keyID.second;
+                    return true;
+                }
             }
-            
-            continue;
         }
-        
-        int32_t nOutputId = -1;
-        nStealth++;
-        for(const CTxOut& txoutB: tx.vout)
-        {
-            nOutputId++;
-            
-            if (&txoutB == &txout)
+        return true;
+    }
+
+    void swap(CStealthScanCheck &check)
+    {
+        std::swap(item, check.item);
+        std::swap(keys, check.keys);
+    }
+};
+
+/** Ephemeral public key pushed right after OP_RETURN by a stealth send */
+static bool GetStealthEphemeral(const CScript& script, ec_point& ephemPubkey)
+{
+    if (script.size() < 2 + ec_compressed_size || script[0] != OP_RETURN)
+        return false;
+    CScript::const_iterator pc = script.begin() + 1;
+    opcodetype opCode;
+    if (!script.GetOp(pc, opCode, ephemPubkey) || ephemPubkey.size() != ec_compressed_size)
+        return false;
+    return ephemPubkey[0] == 0x02 || ephemPubkey[0] == 0x03;
+}
+
+void CWallet::ScanStealthTransactions(const std::vector<CTransactionRef>& vtx)
+{
+    // Ephemeral keys and the key hash outputs next to them, the only
+    // outputs a stealth send can pay
+    std::vector<CStealthScanItem> vItems;
+    for (const CTransactionRef& ptx : vtx) {
+        std::vector<std::pair<CKeyID, uint32_t>> vKeyIDs;
+        size_t nFirstItem = vItems.size();
+        for (uint32_t n = 0; n < ptx->vout.size(); ++n) {
+            const CTxOut& txout = ptx->vout[n];
+            CStealthScanItem item;
+            if (GetStealthEphemeral(txout.scriptPubKey, item.ephemPubkey)) {
+                item.txid = ptx->GetHash();
+                vItems.push_back(std::move(item));
                 continue;
-            
-            bool txnMatch = false; // only 1 txn will match an ephem pk
-            
+            }
             CTxDestination address;
-            if (!ExtractDestination(txoutB.scriptPubKey, address))
-                continue;
-            
-            if (address.type() != typeid(CKeyID))
-                continue;
-            
-            CKeyID ckidMatch = boost::get<CKeyID>(address);
-            
-            if (HaveKey(ckidMatch)) // no point checking if already have key
+            if (ExtractDestination(txout.scriptPubKey, address) && address.type() == typeid(CKeyID))
+                vKeyIDs.emplace_back(boost::get<CKeyID>(address), n);
+        }
+        if (vKeyIDs.empty()) {
+            vItems.resize(nFirstItem);
+            continue;
+        }
+        for (size_t i = nFirstItem; i < vItems.size(); ++i)
+            vItems[i].vKeyIDs = vKeyIDs;
+    }
+    if (vItems.empty())
+        return;
+
+    std::vector<CStealthScanKey> vKeys;
+    {
+        LOCK(cs_wallet);
+        nStealth += vItems.size();
+        for (const CStealthAddress& sxAddr : stealthAddresses) {
+            if (sxAddr.scan_secret.size() != ec_secret_size)
                 continue;
-            
-            std::set<CStealthAddress>::iterator it;
-            for (it = stealthAddresses.begin(); it != stealthAddresses.end(); ++it)
-            {
-                if (it->scan_secret.size() != ec_secret_size)
-                    continue;
+            CStealthScanKey key;
+            key.sxAddr = sxAddr;
+            memcpy(&key.scan_secret.e[0], &sxAddr.scan_secret[0], ec_secret_size);
+            vKeys.push_back(std::move(key));
+        }
+    }
+    if (vKeys.empty())
+        return;
 
-                memcpy(&sScan.e[0], &it->scan_secret[0], ec_secret_size);
-                
-                if (StealthSecret(sScan, vectorPubKey, it->spend_pubkey, sShared, pkExtracted) != 0)
-                {
-                    printf("StealthSecret failed.\n");
-                    continue;
-                };
-                
-                CPubKey cpkE(pkExtracted);
-                
-                if (!cpkE.IsValid())
-                    continue;
+    std::vector<CStealthScanCheck> vChecks;
+    vChecks.reserve(vItems.size());
+    for (CStealthScanItem& item : vItems)
+        vChecks.emplace_back(&item, &vKeys);
+    RunWalletScanChecks(vChecks);
 
-                CKeyID ckidE = cpkE.GetID();
-                
-                if (ckidMatch != ckidE)
-                    continue;
-                
-                LogPrintf("Found stealth txn to address %s\n", it->Encoded().c_str());
-                
-                if (IsLocked())
-                {
-                    LogPrintf("Wallet is locked, adding key without secret.\n");
-                    
-                    // -- add key without secret
-                    std::vector<uint8_t> vchEmpty;
-                    AddCryptedKey(cpkE, vchEmpty);
-                    CKeyID keyId = cpkE.GetID();
-                    std::string sLabel = it->Encoded();
-                    SetAddressBook(keyId, sLabel, "");
-                    
-                    CPubKey cpkEphem(vectorPubKey);
-                    CPubKey cpkScan(it->scan_pubkey);
-                    CStealthKeyMetadata lockedSkMeta(cpkEphem, cpkScan);
-                    
-                    WalletBatch batch(*database);
-                    if (!batch.WriteStealthKeyMeta(keyId, lockedSkMeta))
-                        LogPrintf("WriteStealthKeyMeta failed \n");
-                    
-                    mapStealthKeyMeta[keyId] = lockedSkMeta;
-                    nFoundStealth++;
-                } else
-                {
-                    if (it->spend_secret.size() != ec_secret_size)
-                        continue;
+    for (const CStealthScanItem& item : vItems) {
+        if (item.nMatch >= vKeys.size())
+            continue;
+        LOCK(cs_wallet);
+        AddStealthKey(vKeys[item.nMatch], item.ephemPubkey);
 
-                    memcpy(&sSpend.e[0], &it->spend_secret[0], ec_secret_size);
-                    
-                    if (StealthSharedToSecretSpend(sShared, sSpend, sSpendR) != 0)
-                    {
-                        LogPrintf("StealthSharedToSecretSpend() failed.\n");
-                        continue;
-                    };
-                    
-                    CKeyingMaterial vchSecret;
-                    vchSecret.resize(ec_secret_size);
-                    
-                    memcpy(&vchSecret[0], &sSpendR.e[0], ec_secret_size);
-                    CKey ckey;
-                    
-                    try {
-                        ckey.Set(vchSecret.begin(), vchSecret.end(), true);
-                    } catch (std::exception& e) {
-                        LogPrintf("ckey.SetSecret() threw: %s.\n", e.what());
-                        continue;
-                    };
-                    
-                    CPubKey cpkT = ckey.GetPubKey();
-                    if (!cpkT.IsValid())
-                    {
-                        LogPrintf("cpkT is invalid.\n");
-                        continue;
-                    };
-                    
-                    if (!ckey.IsValid())
-                    {
-                        LogPrintf("Reconstructed key is invalid.\n");
-                        continue;
-                    };
-                    
-                    CKeyID keyID = cpkT.GetID();
-                    
-                    if (!AddKeyPubKey(ckey, cpkT))
-                    {
-                        LogPrintf("AddKey failed.\n");
-                        continue;
-                    };
-                    
-                    std::string sLabel = it->Encoded();
-                    SetAddressBook(keyID, sLabel, "");
-                    nFoundStealth++;
-                };
-                
-                // TODO: Implement secmes and allow narr
-                /*if (txout.scriptPubKey.GetOp(scriptIterator, opCode, vchENarr)
-                    && opCode == OP_RETURN
-                    && txout.scriptPubKey.GetOp(scriptIterator, opCode, vchENarr)
-                    && vchENarr.size() > 0)
-                {
-                    SecMsgCrypter crypter;
-                    crypter.SetKey(&sShared.e[0], &vectorPubKey[0]);
-                    std::vector<uint8_t> vchNarr;
-                    if (!crypter.Decrypt(&vchENarr[0], vchENarr.size(), vchNarr))
-                    {
-                        LogPrintf("Decrypt narration failed.\n");
-                        continue;
-                    };
-                    std::string sNarr = std::string(vchNarr.begin(), vchNarr.end());
-                    
-                    snprintf(cbuf, sizeof(cbuf), "n_%d", nOutputId);
-                    mapNarr[cbuf] = sNarr;
-                };*/
-                
-                txnMatch = true;
-                break;
-            };
-            if (txnMatch)
-                break;
-        };
+        // Written again when a payment is seen in the mempool and then in a
+        // block, or rescanned, which also fills the index of older wallets
+        WalletBatch batch(*database);
+        if (!batch.WriteStealthOutput(vKeys[item.nMatch].sxAddr, COutPoint(item.txid, item.nOut), CPubKey(item.ephemPubkey)))
+            LogPrintf("WriteStealthOutput failed\n");
+    }
+}
+
+bool CWallet::ListStealthReceipts(const CStealthAddress& sxAddr, std::vector<std::pair<COutPoint, CPubKey>>& vReceipts)
+{
+    WalletBatch batch(*database, "r");
+    return batch.ListStealthOutputs(sxAddr, vReceipts);
+}
+
+bool CWallet::FindStealthReceipt(const CPubKey& pkEphem, COutPoint& outpoint)
+{
+    WalletBatch batch(*database, "r");
+    return batch.ReadStealthEphemeral(pkEphem, outpoint);
+}
+
+bool CWallet::AddStealthKey(const CStealthScanKey& key, const ec_point& ephemPubkey)
+{
+    AssertLockHeld(cs_wallet);
+
+    const CStealthAddress& sxAddr = key.sxAddr;
+    ec_secret sScan = key.scan_secret;
+    ec_secret sShared;
+    ec_point pkExtracted;
+    if (StealthSecret(sScan, ephemPubkey, sxAddr.spend_pubkey, sShared, pkExtracted) != 0)
+        return false;
+
+    CPubKey cpkE(pkExtracted);
+    if (!cpkE.IsValid())
+        return false;
+
+    if (HaveKey(cpkE.GetID())) // found before, e.g. by an earlier scan
+        return false;
+
+    LogPrintf("Found stealth txn to address %s\n", sxAddr.Encoded().c_str());
+
+    if (IsLocked())
+    {
+        LogPrintf("Wallet is locked, adding key without secret.\n");
+
+        // -- add key without secret
+        std::vector<uint8_t> vchEmpty;
+        AddCryptedKey(cpkE, vchEmpty);
+        CKeyID keyId = cpkE.GetID();
+        std::string sLabel = sxAddr.Encoded();
+        SetAddressBook(keyId, sLabel, "");
+
+        CPubKey cpkEphem(ephemPubkey);
+        CPubKey cpkScan(sxAddr.scan_pubkey);
+        CStealthKeyMetadata lockedSkMeta(cpkEphem, cpkScan);
+
+        WalletBatch batch(*database);
+        if (!batch.WriteStealthKeyMeta(keyId, lockedSkMeta))
+            LogPrintf("WriteStealthKeyMeta failed \n");
+
+        mapStealthKeyMeta[keyId] = lockedSkMeta;
+        nFoundStealth++;
+        return true;
+    }
+
+    if (sxAddr.spend_secret.size() != ec_secret_size)
+        return false;
+
+    ec_secret sSpend;
+    ec_secret sSpendR;
+    memcpy(&sSpend.e[0], &sxAddr.spend_secret[0], ec_secret_size);
+
+    if (StealthSharedToSecretSpend(sShared, sSpend, sSpendR) != 0)
+    {
+        LogPrintf("StealthSharedToSecretSpend() failed.\n");
+        return false;
     };
-    
+
+    CKey ckey;
+    ckey.Set(&sSpendR.e[0], &sSpendR.e[ec_secret_size], true);
+    if (!ckey.IsValid())
+    {
+        LogPrintf("Reconstructed key is invalid.\n");
+        return false;
+    };
+
+    CPubKey cpkT = ckey.GetPubKey();
+    if (!cpkT.IsValid())
+    {
+        LogPrintf("cpkT is invalid.\n");
+        return false;
+    };
+
+    CKeyID keyID = cpkT.GetID();
+
+    if (!AddKeyPubKey(ckey, cpkT))
+    {
+        LogPrintf("AddKey failed.\n");
+        return false;
+    };
+
+    std::string sLabel = sxAddr.Encoded();
+    SetAddressBook(keyID, sLabel, "");
+    nFoundStealth++;
     return true;
-};
+}
 
 void CWallet::ListAccountCreditDebit(const std::string& strAccount, std::list<CAccountingEntry>& entries) {
     WalletBatch batch(*database);
@@ -4702,7 +5077,11 @@ bool CWallet::Verify(std::string wallet_file, bool salvage_wallet, std::string&
         }
     }
 
-    return WalletBatch::VerifyDatabaseFile(wallet_path, warning_string, error_string);
+    if (!WalletBatch::VerifyDatabaseFile(wallet_path, warning_string, error_string)) {
+        return false;
+    }
+
+    return WalletBatch::MigrateDatabase(wallet_path, warning_string, error_string);
 }
 
 std::shared_ptr<CWallet> CWallet::CreateWalletFromFile(const std::string& name, const fs::path& path)
@@ -4929,54 +5308,95 @@ std::shared_ptr<CWallet> CWallet::CreateWalletFromFile(const std::string& name,
     // Try to top up keypool. No-op if the wallet is locked.
     walletInstance->TopUpKeyPool();
 
-    LOCK(cs_main);
-
-    CBlockIndex *pindexRescan = chainActive.Genesis();
-    if (!gArgs.GetBoolArg("-rescan", false))
+    CBlockIndex *pindexRescan = nullptr;
+    CBlockIndex *pindexRescanTip = nullptr;
+    bool fRescan = false;
     {
-        WalletBatch batch(*walletInstance->database);
-        CBlockLocator locator;
-        if (batch.ReadBestBlock(locator))
-            pindexRescan = FindForkInGlobalIndex(chainActive, locator);
-    }
+        LOCK(cs_main);
 
-    walletInstance->m_last_block_processed = chainActive.Tip();
+        pindexRescan = chainActive.Genesis();
+        if (!gArgs.GetBoolArg("-rescan", false))
+        {
+            WalletBatch batch(*walletInstance->database);
+            CBlockLocator locator;
+            if (batch.ReadBestBlock(locator))
+                pindexRescan = FindForkInGlobalIndex(chainActive, locator);
+
+            // Resume a rescan the last run did not finish, e.g. of imported keys
+            if (batch.ReadRescanProgress(locator)) {
+                CBlockIndex* pindexUnfinished = FindForkInGlobalIndex(chainActive, locator);
+                if (pindexUnfinished && (!pindexRescan || pindexUnfinished->nHeight < pindexRescan->nHeight)) {
+                    LogPrintf("Resuming unfinished rescan from block %d\n", pindexUnfinished->nHeight);
+                    pindexRescan = pindexUnfinished;
+                }
+            }
+        }
 
-    if (chainActive.Tip() && chainActive.Tip() != pindexRescan)
-    {
-        //We can't rescan beyond non-pruned blocks, stop and throw an error
-        //this might happen if a user uses an old wallet within a pruned node
-        // or if he ran -disablewallet for a longer time, then decided to re-enable
-        if (fPruneMode)
+        if (chainActive.Tip() && chainActive.Tip() != pindexRescan)
         {
-            CBlockIndex *block = chainActive.Tip();
-            while (block && block->pprev && (block->pprev->nStatus & BLOCK_HAVE_DATA) && block->pprev->nTx > 0 && pindexRescan != block)
-                block = block->pprev;
+            //We can't rescan beyond non-pruned blocks, stop and throw an error
+            //this might happen if a user uses an old wallet within a pruned node
+            // or if he ran -disablewallet for a longer time, then decided to re-enable
+            if (fPruneMode)
+            {
+                CBlockIndex *block = chainActive.Tip();
+                while (block && block->pprev && (block->pprev->nStatus & BLOCK_HAVE_DATA) && block->pprev->nTx > 0 && pindexRescan != block)
+                    block = block->pprev;
 
-            if (pindexRescan != block) {
-                InitError(_("Prune: last wallet synchronisation goes beyond pruned data. You need to -reindex (download the whole blockchain again in case of pruned node)"));
-                return nullptr;
+                if (pindexRescan != block) {
+                    InitError(_("Prune: last wallet synchronisation goes beyond pruned data. You need to -reindex (download the whole blockchain again in case of pruned node)"));
+                    return nullptr;
+                }
             }
-        }
 
-        uiInterface.InitMessage(_("Rescanning..."));
-        LogPrintf("Rescanning last %i blocks (from block %i)...\n", chainActive.Height() - pindexRescan->nHeight, pindexRescan->nHeight);
+            uiInterface.InitMessage(_("Rescanning..."));
+            LogPrintf("Rescanning last %i blocks (from block %i)...\n", chainActive.Height() - pindexRescan->nHeight, pindexRescan->nHeight);
 
-        // No need to read and scan block if block was created before
-        // our wallet birthday (as adjusted for block time variability)
-        while (pindexRescan && walletInstance->nTimeFirstKey && (pindexRescan->GetBlockTime() < (walletInstance->nTimeFirstKey - TIMESTAMP_WINDOW))) {
-            pindexRescan = chainActive.Next(pindexRescan);
+            // No need to read and scan block if block was created before
+            // our wallet birthday (as adjusted for block time variability)
+            while (pindexRescan && walletInstance->nTimeFirstKey && (pindexRescan->GetBlockTime() < (walletInstance->nTimeFirstKey - TIMESTAMP_WINDOW))) {
+                pindexRescan = chainActive.Next(pindexRescan);
+            }
+            fRescan = true;
         }
+        pindexRescanTip = chainActive.Tip();
+    }
 
-        nStart = GetTimeMillis();
-        {
-            WalletRescanReserver reserver(walletInstance.get());
-            if (!reserver.reserve()) {
-                InitError(_("Failed to rescan the wallet during initialization"));
-                return nullptr;
-            }
-            walletInstance->ScanForWalletTransactions(pindexRescan, nullptr, reserver, true);
+    // Scan up to the tip without cs_main, as rescanblockchain does, so that
+    // the node goes on validating meanwhile
+    nStart = GetTimeMillis();
+    if (fRescan && pindexRescan) {
+        WalletRescanReserver reserver(walletInstance.get());
+        if (!reserver.reserve()) {
+            InitError(_("Failed to rescan the wallet during initialization"));
+            return nullptr;
         }
+        walletInstance->ScanForWalletTransactions(pindexRescan, pindexRescanTip, reserver, true);
+    }
+
+    LOCK(cs_main);
+
+    walletInstance->m_last_block_processed = chainActive.Tip();
+
+    // Catch up on the blocks connected or reorganized since cs_main was
+    // released above. It is now held until the wallet is registered below,
+    // so none is missed.
+    const CBlockIndex* pindexFork = chainActive.FindFork(pindexRescanTip);
+    if (chainActive.Tip() != pindexFork) {
+        CBlockIndex* pindexCatchUp = pindexFork ? chainActive.Next(pindexFork) : chainActive.Genesis();
+        if (fRescan && pindexRescan && pindexCatchUp->nHeight < pindexRescan->nHeight)
+            pindexCatchUp = pindexRescan;
+        WalletRescanReserver reserver(walletInstance.get());
+        if (!reserver.reserve()) {
+            InitError(_("Failed to rescan the wallet during initialization"));
+            return nullptr;
+        }
+        walletInstance->ScanForWalletTransactions(pindexCatchUp, nullptr, reserver, true);
+        fRescan = true;
+    }
+
+    if (fRescan)
+    {
         LogPrintf(" rescan      %15dms\n", GetTimeMillis() - nStart);
         walletInstance->ChainStateFlushed(chainActive.GetLocator());
         walletInstance->database->IncrementUpdateCounter();
@@ -5098,6 +5518,8 @@ bool CWalletTx::AcceptToMemoryPool(const CAmount& nAbsurdFee, CValidationState&
     bool ret = ::AcceptToMemoryPool(mempool, state, tx, nullptr /* pfMissingInputs */,
                                 nullptr /* plTxnReplaced */, false /* bypass_limits */, nAbsurdFee);
     fInMempool |= ret;
+    if (ret && pwallet)
+        pwallet->MarkBalanceDirty();
     return ret;
 }
 
@@ -42,6 +42,10 @@ bool HasWallets();
 std::vector<std::shared_ptr<CWallet>> GetWallets();
 std::shared_ptr<CWallet> GetWallet(const std::string& name);
 
+/** Worker threads reading blocks for rescans and deriving stealth destinations, -par sized like script checks */
+void StartWalletScanThreads();
+void StopWalletScanThreads();
+
 //! Default for -keypool
 static const unsigned int DEFAULT_KEYPOOL_SIZE = 1000;
 //! -paytxfee default
@@ -75,6 +79,7 @@ class CScript;
 class CTxMemPool;
 class CBlockPolicyEstimator;
 class CWalletTx;
+struct CStealthScanKey;
 struct FeeCalculation;
 enum class FeeEstimateMode;
 
@@ -442,18 +447,7 @@ public:
     }
 
     //! make sure balances are recalculated
-    void MarkDirty()
-    {
-        fCreditCached = false;
-        fAvailableCreditCached = false;
-        fImmatureCreditCached = false;
-        fWatchDebitCached = false;
-        fWatchCreditCached = false;
-        fAvailableWatchCreditCached = false;
-        fImmatureWatchCreditCached = false;
-        fDebitCached = false;
-        fChangeCached = false;
-    }
+    void MarkDirty();
 
     void BindWallet(CWallet *pwalletIn)
     {
@@ -673,6 +667,17 @@ struct CoinEligibilityFilter
     CoinEligibilityFilter(int conf_mine, int conf_theirs, uint64_t max_ancestors, uint64_t max_descendants) : conf_mine(conf_mine), conf_theirs(conf_theirs), max_ancestors(max_ancestors), max_descendants(max_descendants) {}
 };
 
+/** The balances of a wallet, as returned by the CWallet::Get*Balance() calls */
+struct CWalletBalance
+{
+    CAmount nTrusted = 0;
+    CAmount nUntrustedPending = 0;
+    CAmount nImmature = 0;
+    CAmount nWatchOnlyTrusted = 0;
+    CAmount nWatchOnlyUntrustedPending = 0;
+    CAmount nWatchOnlyImmature = 0;
+};
+
 class WalletRescanReserver; //forward declarations for ScanForWalletTransactions/RescanFromTime
 /**
  * A CWallet is an extension of a keystore, which also maintains a set of transactions and balances,
@@ -686,6 +691,26 @@ private:
     std::mutex mutexScanning;
     friend class WalletRescanReserver;
 
+    //! Bumped when keys or scripts are added to or removed from the key store,
+    //! to tell a rescan its copy of them went stale
+    std::atomic<uint64_t> nKeyStoreUpdates{0};
+    friend class CRescanKeyStore;
+
+    /**
+     * Wallet transactions that may still have an unspent output of ours.
+     * Balances and AvailableCoins only look at these. A transaction is
+     * dropped once all its outputs are spent or not ours, and put back
+     * whenever it is marked dirty: a spend of it being conflicted or
+     * abandoned, or keys being imported, all do that.
+     */
+    mutable std::set<uint256> setUnspentTxs;
+    //! Balances of the transactions above, until the wallet, chain or mempool changes
+    mutable CWalletBalance balanceCached;
+    mutable bool fBalanceCached = false;
+
+    bool HasUnspentOutput(const CWalletTx& wtx) const EXCLUSIVE_LOCKS_REQUIRED(cs_main, cs_wallet);
+    std::vector<const CWalletTx*> GetUnspentTxs() const EXCLUSIVE_LOCKS_REQUIRED(cs_main, cs_wallet);
+
     WalletBatch *encrypted_batch = nullptr;
 
     //! the current wallet version: clients below this version are not able to load the wallet
@@ -717,6 +742,9 @@ private:
      * Should be called with pindexBlock and posInBlock if this is for a transaction that is included in a block. */
     void SyncTransaction(const CTransactionRef& tx, const CBlockIndex *pindex = nullptr, int posInBlock = 0) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
+    /* Add the one-time key a stealth address was paid to, found by ScanStealthTransactions. */
+    bool AddStealthKey(const CStealthScanKey& key, const ec_point& ephemPubkey) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
     /* the HD chain data model (external chain counters) */
     CHDChain hdChain;
 
@@ -943,6 +971,10 @@ public:
     bool GetLabelDestination(CTxDestination &dest, const std::string& label, bool bForceNew = false);
 
     void MarkDirty();
+    /** Put a transaction back among the ones with unspent outputs, called by CWalletTx::MarkDirty */
+    void MarkUnspentDirty(const uint256& hash) const;
+    /** Forget the cached balances, e.g. when depths or mempool state change */
+    void MarkBalanceDirty() const;
     bool AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose=true);
     bool LoadToWallet(const CWalletTx& wtxIn);
     void TransactionAddedToMempool(const CTransactionRef& tx) override;
@@ -956,6 +988,7 @@ public:
     void ResendWalletTransactions(int64_t nBestBlockTime, CConnman* connman) override;
     // ResendWalletTransactionsBefore may only be called if fBroadcastTransactions!
     std::vector<uint256> ResendWalletTransactionsBefore(int64_t nTime, CConnman* connman);
+    CWalletBalance GetBalances() const;
     CAmount GetBalance(const isminefilter& filter=ISMINE_SPENDABLE, const int min_depth=0) const;
     CAmount GetUnconfirmedBalance() const;
     CAmount GetImmatureBalance() const;
@@ -989,7 +1022,16 @@ public:
     bool CreateStealthTransaction(CScript scriptPubKey, int64_t nValue, std::vector<uint8_t>& P, std::vector<uint8_t>& narr, std::string& sNarr, CTransactionRef& wtxNew, CReserveKey& reservekey, int64_t& nFeeRet);
     std::string SendStealthMoney(CScript scriptPubKey, int64_t nValue, std::vector<uint8_t>& P, std::vector<uint8_t>& narr, std::string& sNarr, CTransactionRef& wtxNew, bool fAskFee);   
     bool SendStealthMoneyToDestination(CStealthAddress& sxAddress, int64_t nValue, std::string& sNarr, CTransactionRef& txNew, std::string& sError, bool fAskFee=false);
-    bool FindStealthTransactions(const CTransaction& tx, mapValue_t& mapNarr);
+    /**
+     * Add the keys of stealth payments to this wallet's stealth addresses.
+     * Outputs are derived on the wallet scan threads without holding
+     * cs_wallet, so call this before the transactions are synced.
+     */
+    void ScanStealthTransactions(const std::vector<CTransactionRef>& vtx);
+    /** Outputs found paying a stealth address, with their ephemeral keys, from the wallet database index */
+    bool ListStealthReceipts(const CStealthAddress& sxAddr, std::vector<std::pair<COutPoint, CPubKey>>& vReceipts);
+    /** The output a stealth payment with this ephemeral key was found in */
+    bool FindStealthReceipt(const CPubKey& pkEphem, COutPoint& outpoint);
 
     void ListAccountCreditDebit(const std::string& strAccount, std::list<CAccountingEntry>& entries);
     bool AddAccountingEntry(const CAccountingEntry&);
@@ -15,6 +15,7 @@
 #include <sync.h>
 #include <util/system.h>
 #include <util/time.h>
+#include <wallet/ldb.h>
 #include <wallet/wallet.h>
 
 #include <atomic>
@@ -111,7 +112,63 @@ bool WalletBatch::WriteStealthAddress(const CStealthAddress& sxAddr)
 bool WalletBatch::ReadStealthAddress(CStealthAddress& sxAddr)
 {
     // -- set scan_pubkey before reading
-    return m_batch.Read(std::make_pair(std::string("sxAddr"), sxAddr.scan_pubkey), sxAddr);
+    return m_batch->Read(std::make_pair(std::string("sxAddr"), sxAddr.scan_pubkey), sxAddr);
+}
+
+bool WalletBatch::WriteStealthOutput(const CStealthAddress& sxAddr, const COutPoint& outpoint, const CPubKey& pkEphem)
+{
+    if (!WriteIC(std::make_pair(std::string("sxout"), std::make_pair(sxAddr.scan_pubkey, outpoint)), pkEphem)) {
+        return false;
+    }
+    return WriteIC(std::make_pair(std::string("sxephem"), pkEphem), outpoint);
+}
+
+bool WalletBatch::ListStealthOutputs(const CStealthAddress& sxAddr, std::vector<std::pair<COutPoint, CPubKey>>& vOutputs)
+{
+    if (!m_batch->StartCursor())
+        return false;
+    bool setRange = true;
+    bool fSuccess = true;
+    while (true)
+    {
+        // Records of one address are contiguous, starting right at its key prefix
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        if (setRange)
+            ssKey << std::make_pair(std::string("sxout"), sxAddr.scan_pubkey);
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        bool complete;
+        bool ret = m_batch->ReadAtCursor(ssKey, ssValue, complete, setRange);
+        setRange = false;
+        if (complete)
+            break;
+        else if (!ret)
+        {
+            fSuccess = false;
+            break;
+        }
+
+        std::string strType;
+        ec_point scan_pubkey;
+        ssKey >> strType;
+        if (strType != "sxout")
+            break;
+        ssKey >> scan_pubkey;
+        if (scan_pubkey != sxAddr.scan_pubkey)
+            break;
+
+        std::pair<COutPoint, CPubKey> output;
+        ssKey >> output.first;
+        ssValue >> output.second;
+        vOutputs.push_back(output);
+    }
+
+    m_batch->CloseCursor();
+    return fSuccess;
+}
+
+bool WalletBatch::ReadStealthEphemeral(const CPubKey& pkEphem, COutPoint& outpoint)
+{
+    return m_batch->Read(std::make_pair(std::string("sxephem"), pkEphem), outpoint);
 }
 
 bool WalletBatch::WriteCScript(const uint160& hash, const CScript& redeemScript)
@@ -143,8 +200,23 @@ bool WalletBatch::WriteBestBlock(const CBlockLocator& locator)
 
 bool WalletBatch::ReadBestBlock(CBlockLocator& locator)
 {
-    if (m_batch.Read(std::string("bestblock"), locator) && !locator.vHave.empty()) return true;
-    return m_batch.Read(std::string("bestblock_nomerkle"), locator);
+    if (m_batch->Read(std::string("bestblock"), locator) && !locator.vHave.empty()) return true;
+    return m_batch->Read(std::string("bestblock_nomerkle"), locator);
+}
+
+bool WalletBatch::WriteRescanProgress(const CBlockLocator& locator)
+{
+    return WriteIC(std::string("rescanprogress"), locator);
+}
+
+bool WalletBatch::ReadRescanProgress(CBlockLocator& locator)
+{
+    return m_batch->Read(std::string("rescanprogress"), locator) && !locator.vHave.empty();
+}
+
+bool WalletBatch::EraseRescanProgress()
+{
+    return EraseIC(std::string("rescanprogress"));
 }
 
 bool WalletBatch::WriteOrderPosNext(int64_t nOrderPosNext)
@@ -154,7 +226,7 @@ bool WalletBatch::WriteOrderPosNext(int64_t nOrderPosNext)
 
 bool WalletBatch::ReadPool(int64_t nPool, CKeyPool& keypool)
 {
-    return m_batch.Read(std::make_pair(std::string("pool"), nPool), keypool);
+    return m_batch->Read(std::make_pair(std::string("pool"), nPool), keypool);
 }
 
 bool WalletBatch::WritePool(int64_t nPool, const CKeyPool& keypool)
@@ -175,7 +247,7 @@ bool WalletBatch::WriteMinVersion(int nVersion)
 bool WalletBatch::ReadAccount(const std::string& strAccount, CAccount& account)
 {
     account.SetNull();
-    return m_batch.Read(std::make_pair(std::string("acc"), strAccount), account);
+    return m_batch->Read(std::make_pair(std::string("acc"), strAccount), account);
 }
 
 bool WalletBatch::WriteAccount(const std::string& strAccount, const CAccount& account)
@@ -209,8 +281,7 @@ void WalletBatch::ListAccountCreditDebit(const std::string& strAccount, std::lis
 {
     bool fAllAccounts = (strAccount == "*");
 
-    Dbc* pcursor = m_batch.GetCursor();
-    if (!pcursor)
+    if (!m_batch->StartCursor())
         throw std::runtime_error(std::string(__func__) + ": cannot create DB cursor");
     bool setRange = true;
     while (true)
@@ -220,13 +291,14 @@ void WalletBatch::ListAccountCreditDebit(const std::string& strAccount, std::lis
         if (setRange)
             ssKey << std::make_pair(std::string("acentry"), std::make_pair((fAllAccounts ? std::string("") : strAccount), uint64_t(0)));
         CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-        int ret = m_batch.ReadAtCursor(pcursor, ssKey, ssValue, setRange);
+        bool complete;
+        bool ret = m_batch->ReadAtCursor(ssKey, ssValue, complete, setRange);
         setRange = false;
-        if (ret == DB_NOTFOUND)
+        if (complete)
             break;
-        else if (ret != 0)
+        else if (!ret)
         {
-            pcursor->close();
+            m_batch->CloseCursor();
             throw std::runtime_error(std::string(__func__) + ": error scanning DB");
         }
 
@@ -245,7 +317,7 @@ void WalletBatch::ListAccountCreditDebit(const std::string& strAccount, std::lis
         entries.push_back(acentry);
     }
 
-    pcursor->close();
+    m_batch->CloseCursor();
 }
 
 class CWalletScanState {
@@ -550,7 +622,8 @@ ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
                 strErr = "Error reading wallet database: SetHDChain failed";
                 return false;
             }
-        } else if (strType != "bestblock" && strType != "bestblock_nomerkle"){
+        } else if (strType != "bestblock" && strType != "bestblock_nomerkle" && strType != "rescanprogress" &&
+                   strType != "sxout" && strType != "sxephem") { // stealth indexes are read on demand
             wss.m_unknown_records++;
         }
     } catch (...)
@@ -575,7 +648,7 @@ DBErrors WalletBatch::LoadWallet(CWallet* pwallet)
     LOCK(pwallet->cs_wallet);
     try {
         int nMinVersion = 0;
-        if (m_batch.Read((std::string)"minversion", nMinVersion))
+        if (m_batch->Read((std::string)"minversion", nMinVersion))
         {
             if (nMinVersion > CLIENT_VERSION)
                 return DBErrors::TOO_NEW;
@@ -583,8 +656,7 @@ DBErrors WalletBatch::LoadWallet(CWallet* pwallet)
         }
 
         // Get cursor
-        Dbc* pcursor = m_batch.GetCursor();
-        if (!pcursor)
+        if (!m_batch->StartCursor())
         {
             LogPrintf("Error getting wallet database cursor\n");
             return DBErrors::CORRUPT;
@@ -595,11 +667,13 @@ DBErrors WalletBatch::LoadWallet(CWallet* pwallet)
             // Read next record
             CDataStream ssKey(SER_DISK, CLIENT_VERSION);
             CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-            int ret = m_batch.ReadAtCursor(pcursor, ssKey, ssValue);
-            if (ret == DB_NOTFOUND)
+            bool complete;
+            bool ret = m_batch->ReadAtCursor(ssKey, ssValue, complete);
+            if (complete)
                 break;
-            else if (ret != 0)
+            else if (!ret)
             {
+                m_batch->CloseCursor();
                 LogPrintf("Error reading next record from wallet database\n");
                 return DBErrors::CORRUPT;
             }
@@ -624,7 +698,7 @@ DBErrors WalletBatch::LoadWallet(CWallet* pwallet)
             if (!strErr.empty())
                 LogPrintf("%s\n", strErr);
         }
-        pcursor->close();
+        m_batch->CloseCursor();
     }
     catch (const boost::thread_interrupted&) {
         throw;
@@ -678,15 +752,14 @@ DBErrors WalletBatch::FindWalletTx(std::vector<uint256>& vTxHash, std::vector<CW
 
     try {
         int nMinVersion = 0;
-        if (m_batch.Read((std::string)"minversion", nMinVersion))
+        if (m_batch->Read((std::string)"minversion", nMinVersion))
         {
             if (nMinVersion > CLIENT_VERSION)
                 return DBErrors::TOO_NEW;
         }
 
         // Get cursor
-        Dbc* pcursor = m_batch.GetCursor();
-        if (!pcursor)
+        if (!m_batch->StartCursor())
         {
             LogPrintf("Error getting wallet database cursor\n");
             return DBErrors::CORRUPT;
@@ -697,11 +770,13 @@ DBErrors WalletBatch::FindWalletTx(std::vector<uint256>& vTxHash, std::vector<CW
             // Read next record
             CDataStream ssKey(SER_DISK, CLIENT_VERSION);
             CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-            int ret = m_batch.ReadAtCursor(pcursor, ssKey, ssValue);
-            if (ret == DB_NOTFOUND)
+            bool complete;
+            bool ret = m_batch->ReadAtCursor(ssKey, ssValue, complete);
+            if (complete)
                 break;
-            else if (ret != 0)
+            else if (!ret)
             {
+                m_batch->CloseCursor();
                 LogPrintf("Error reading next record from wallet database\n");
                 return DBErrors::CORRUPT;
             }
@@ -719,7 +794,7 @@ DBErrors WalletBatch::FindWalletTx(std::vector<uint256>& vTxHash, std::vector<CW
                 vWtx.push_back(wtx);
             }
         }
-        pcursor->close();
+        m_batch->CloseCursor();
     }
     catch (const boost::thread_interrupted&) {
         throw;
@@ -807,7 +882,7 @@ void MaybeCompactWalletDB()
         }
 
         if (dbh.nLastFlushed != nUpdateCounter && GetTime() - dbh.nLastWalletUpdate >= 2) {
-            if (BerkeleyBatch::PeriodicFlush(dbh)) {
+            if (dbh.PeriodicFlush()) {
                 dbh.nLastFlushed = nUpdateCounter;
             }
         }
@@ -821,6 +896,10 @@ void MaybeCompactWalletDB()
 //
 bool WalletBatch::Recover(const fs::path& wallet_path, void *callbackDataIn, bool (*recoverKVcallback)(void* callbackData, CDataStream ssKey, CDataStream ssValue), std::string& out_backup_filename)
 {
+    if (IsLevelDBWallet(wallet_path)) {
+        LogPrintf("Salvaging wallet %s is only supported for BerkeleyDB wallets\n", wallet_path.string());
+        return false;
+    }
     return BerkeleyBatch::Recover(wallet_path, callbackDataIn, recoverKVcallback, out_backup_filename);
 }
 
@@ -856,14 +935,26 @@ bool WalletBatch::RecoverKeysOnlyFilter(void *callbackData, CDataStream ssKey, C
 
 bool WalletBatch::VerifyEnvironment(const fs::path& wallet_path, std::string& errorStr)
 {
+    if (IsLevelDBWallet(wallet_path))
+        return true;
     return BerkeleyBatch::VerifyEnvironment(wallet_path, errorStr);
 }
 
 bool WalletBatch::VerifyDatabaseFile(const fs::path& wallet_path, std::string& warningStr, std::string& errorStr)
 {
+    // LevelDB checks its own tables as it reads them
+    if (IsLevelDBWallet(wallet_path))
+        return true;
     return BerkeleyBatch::VerifyDatabaseFile(wallet_path, warningStr, errorStr, WalletBatch::Recover);
 }
 
+bool WalletBatch::MigrateDatabase(const fs::path& wallet_path, std::string& warningStr, std::string& errorStr)
+{
+    if (gArgs.GetArg("-walletbackend", DEFAULT_WALLET_BACKEND) != "leveldb" || IsLevelDBWallet(wallet_path))
+        return true;
+    return LevelDBDatabase::Migrate(wallet_path, warningStr, errorStr);
+}
+
 bool WalletBatch::WriteDestData(const std::string &address, const std::string &key, const std::string &value)
 {
     return WriteIC(std::make_pair(std::string("destdata"), std::make_pair(address, key)), value);
@@ -882,25 +973,25 @@ bool WalletBatch::WriteHDChain(const CHDChain& chain)
 
 bool WalletBatch::TxnBegin()
 {
-    return m_batch.TxnBegin();
+    return m_batch->TxnBegin();
 }
 
 bool WalletBatch::TxnCommit()
 {
-    return m_batch.TxnCommit();
+    return m_batch->TxnCommit();
 }
 
 bool WalletBatch::TxnAbort()
 {
-    return m_batch.TxnAbort();
+    return m_batch->TxnAbort();
 }
 
 bool WalletBatch::ReadVersion(int& nVersion)
 {
-    return m_batch.ReadVersion(nVersion);
+    return m_batch->ReadVersion(nVersion);
 }
 
 bool WalletBatch::WriteVersion(int nVersion)
 {
-    return m_batch.WriteVersion(nVersion);
+    return m_batch->WriteVersion(nVersion);
 }
@@ -25,10 +25,12 @@
  * - WalletBatch is an abstract modifier object for the wallet database, and encapsulates a database
  *   batch update as well as methods to act on the database. It should be agnostic to the database implementation.
  *
- * The following classes are implementation specific:
+ * - WalletDatabase represents a wallet database, and DatabaseBatch is a low-level database batch
+ *   update on it. Both are implemented by a backend, picked per wallet:
+ *
  * - BerkeleyEnvironment is an environment in which the database exists.
- * - BerkeleyDatabase represents a wallet database.
- * - BerkeleyBatch is a low-level database batch update.
+ * - BerkeleyDatabase and BerkeleyBatch keep the wallet in a BerkeleyDB wallet.dat file.
+ * - LevelDBDatabase and LevelDBBatch keep it in a LevelDB store (-walletbackend=leveldb).
  */
 
 static const bool DEFAULT_FLUSHWALLET = true;
@@ -44,9 +46,6 @@ class CWalletTx;
 class uint160;
 class uint256;
 
-/** Backend-agnostic database type. */
-using WalletDatabase = BerkeleyDatabase;
-
 /** Error statuses for the wallet database */
 enum class DBErrors
 {
@@ -171,7 +170,7 @@ private:
     template <typename K, typename T>
     bool WriteIC(const K& key, const T& value, bool fOverwrite = true)
     {
-        if (!m_batch.Write(key, value, fOverwrite)) {
+        if (!m_batch->Write(key, value, fOverwrite)) {
             return false;
         }
         m_database.IncrementUpdateCounter();
@@ -181,7 +180,7 @@ private:
     template <typename K>
     bool EraseIC(const K& key)
     {
-        if (!m_batch.Erase(key)) {
+        if (!m_batch->Erase(key)) {
             return false;
         }
         m_database.IncrementUpdateCounter();
@@ -190,7 +189,7 @@ private:
 
 public:
     explicit WalletBatch(WalletDatabase& database, const char* pszMode = "r+", bool _fFlushOnClose = true) :
-        m_batch(database, pszMode, _fFlushOnClose),
+        m_batch(database.MakeBatch(pszMode, _fFlushOnClose)),
         m_database(database)
     {
     }
@@ -215,6 +214,13 @@ public:
     bool WriteStealthAddress(const CStealthAddress& sxAddr);
     bool ReadStealthAddress(CStealthAddress& sxAddr);
 
+    /// Index the output a stealth address was paid by, by address and by ephemeral key.
+    /// Not read by LoadWallet, only looked up on demand.
+    bool WriteStealthOutput(const CStealthAddress& sxAddr, const COutPoint& outpoint, const CPubKey& pkEphem);
+    /// Outputs paid to a stealth address, with the ephemeral key of each
+    bool ListStealthOutputs(const CStealthAddress& sxAddr, std::vector<std::pair<COutPoint, CPubKey>>& vOutputs);
+    bool ReadStealthEphemeral(const CPubKey& pkEphem, COutPoint& outpoint);
+
     bool WriteCScript(const uint160& hash, const CScript& redeemScript);
 
     bool WriteWatchOnly(const CScript &script, const CKeyMetadata &keymeta);
@@ -223,6 +229,11 @@ public:
     bool WriteBestBlock(const CBlockLocator& locator);
     bool ReadBestBlock(CBlockLocator& locator);
 
+    /// Where a rescan that has not finished yet has to pick up again
+    bool WriteRescanProgress(const CBlockLocator& locator);
+    bool ReadRescanProgress(CBlockLocator& locator);
+    bool EraseRescanProgress();
+
     bool WriteOrderPosNext(int64_t nOrderPosNext);
 
     bool ReadPool(int64_t nPool, CKeyPool& keypool);
@@ -262,6 +273,8 @@ public:
     static bool VerifyEnvironment(const fs::path& wallet_path, std::string& errorStr);
     /* verifies the database file */
     static bool VerifyDatabaseFile(const fs::path& wallet_path, std::string& warningStr, std::string& errorStr);
+    /* moves a BerkeleyDB wallet over to LevelDB, if -walletbackend asks for that */
+    static bool MigrateDatabase(const fs::path& wallet_path, std::string& warningStr, std::string& errorStr);
 
     //! write the hdchain model (external chain child index counter)
     bool WriteHDChain(const CHDChain& chain);
@@ -277,11 +290,11 @@ public:
     //! Write wallet version
     bool WriteVersion(int nVersion);
 private:
-    BerkeleyBatch m_batch;
+    std::unique_ptr<DatabaseBatch> m_batch;
     WalletDatabase& m_database;
 };
 
-//! Compacts BDB state so that wallet.dat is self-contained (if there are changes)
+//! Flushes the wallet databases (if there are changes), which for BDB makes wallet.dat self-contained
 void MaybeCompactWalletDB();
 
 #endif // VERGE_WALLET_WALLETDB_H